@@ -42,6 +42,7 @@ macro(mergeforest_sim_setup_options)
   option(mergeforest_sim_ENABLE_CPPCHECK "Enable cpp-check analysis" OFF)
   option(mergeforest_sim_ENABLE_PCH "Enable precompiled headers" OFF)
   option(mergeforest_sim_ENABLE_CACHE "Enable ccache" OFF)
+  option(mergeforest_sim_BUILD_BENCHMARKS "Build the simulator benchmarks" OFF)
 
   if(NOT PROJECT_IS_TOP_LEVEL)
     mark_as_advanced(
@@ -0,0 +1,73 @@
+#ifndef MERGEFOREST_SIM_BENCH_UTILS_HPP
+#define MERGEFOREST_SIM_BENCH_UTILS_HPP
+
+#include <mergeforest-sim/gen_matrix.hpp>
+#include <mergeforest-sim/matrix_data.hpp>
+#include <mergeforest-sim/matrix_IO.hpp>
+#include <mergeforest-sim/sparse_matrix.hpp>
+
+#include <toml.hpp>
+
+#include <filesystem>
+#include <string>
+
+namespace mergeforest_sim::bench {
+
+inline std::string source_path(const std::string& path) {
+  return (std::filesystem::path(MERGEFOREST_SIM_SOURCE_DIR) / path).string();
+}
+
+inline std::string wiki_vote_file() {
+  return source_path("matrices/wiki-Vote.mtx");
+}
+
+// R-MAT graph with the Graph500 parameters, generated once per run in the
+// temporary directory
+inline const std::string& rmat_file() {
+  static const std::string filename = [] {
+    const auto path = std::filesystem::temp_directory_path() / "mergeforest_sim_bench_rmat.mtx";
+    gen_RMat(path.string(), 1U << 13, 1U << 16, 0.57, 0.19, 0.19, 1);
+    return path.string();
+  }();
+  return filename;
+}
+
+// the matrices are parsed without the binary cache, so the benchmarks don't
+// write files next to the sample matrices
+inline const Spmat_Csr& wiki_vote() {
+  static const Spmat_Csr mtx = read_matrix_market_file(wiki_vote_file());
+  return mtx;
+}
+
+inline const Spmat_Csr& rmat() {
+  static const Spmat_Csr mtx = read_matrix_market_file(rmat_file());
+  return mtx;
+}
+
+inline const toml::value& mergeforest_config() {
+  static const toml::value config = toml::parse(source_path("configs/mergeforest.toml"));
+  return config;
+}
+
+inline const toml::value& gamma_config() {
+  static const toml::value config = toml::parse(source_path("configs/gamma.toml"));
+  return config;
+}
+
+// data of wiki-Vote squared, preprocessed as at the start of a simulation
+inline Matrix_Data& wiki_vote_data() {
+  static Matrix_Data data = [] {
+    Matrix_Data matrix_data;
+    matrix_data.A = &wiki_vote();
+    matrix_data.B = &wiki_vote();
+    matrix_data.verbose = false;
+    matrix_data.preprocess_mats();
+    matrix_data.set_physical_addrs();
+    return matrix_data;
+  }();
+  return data;
+}
+
+} // namespace mergeforest_sim::bench
+
+#endif // MERGEFOREST_SIM_BENCH_UTILS_HPP
@@ -0,0 +1,40 @@
+#include <bench/bench_utils.hpp>
+#include <mergeforest-sim/simulator.hpp>
+#include <mergeforest-sim/sparse_matrix.hpp>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+
+namespace mergeforest_sim {
+
+namespace {
+
+// runs a whole simulation of A*A without computing the result, the stats are
+// written to the temporary directory
+void simulate(const Spmat_Csr& A, const std::string& config) {
+  const auto out_path =
+    std::filesystem::temp_directory_path() / "mergeforest_sim_bench_results.txt";
+  Simulator simulator(bench::source_path(config), out_path.string());
+  simulator.set_verbose(false);
+  simulator.set_mats(A, A);
+  simulator.run_simulation(false);
+}
+
+} // namespace
+
+TEST_CASE("simulation of wiki-Vote", "[macro]") {
+  const auto& A = bench::wiki_vote();
+  BENCHMARK("MergeForest") { simulate(A, "configs/mergeforest.toml"); };
+  BENCHMARK("GAMMA") { simulate(A, "configs/gamma.toml"); };
+}
+
+TEST_CASE("simulation of R-MAT", "[macro]") {
+  const auto& A = bench::rmat();
+  BENCHMARK("MergeForest") { simulate(A, "configs/mergeforest.toml"); };
+  BENCHMARK("GAMMA") { simulate(A, "configs/gamma.toml"); };
+}
+
+} // namespace mergeforest_sim
@@ -0,0 +1,265 @@
+#include <bench/bench_utils.hpp>
+#include <mergeforest-sim/array_fetcher.hpp>
+#include <mergeforest-sim/gamma/fiber_cache.hpp>
+#include <mergeforest-sim/matrix_IO.hpp>
+#include <mergeforest-sim/mergeforest/linked_list_cache.hpp>
+#include <mergeforest-sim/mergeforest/merge_tree_manager.hpp>
+#include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/sparse_matrix.hpp>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+#include <climits>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+struct Benchmark_Access {
+  static unsigned do_merge_add(mergeforest::Merge_Tree_Manager& manager,
+                               mergeforest::Fiber_Buffer& dest, mergeforest::Fiber_Buffer& src1,
+                               mergeforest::Fiber_Buffer& src2)
+  {
+    return manager.do_merge_add(dest, src1, src2, true);
+  }
+
+  static unsigned add_new_row(mergeforest::Linked_List_Cache& cache, uint32_t B_row_ptr,
+                              uint32_t B_row_end)
+  {
+    return cache.add_new_row(B_row_ptr, B_row_end);
+  }
+
+  static std::size_t cache_search(gamma::Fiber_Cache& cache, Address address) {
+    return cache.cache_search(address);
+  }
+
+  static void cache_insert(gamma::Fiber_Cache& cache, Address address, unsigned num_uses) {
+    cache.cache_insert(address, num_uses, false);
+  }
+};
+
+namespace {
+
+using mergeforest::Fiber_Buffer;
+
+// fiber with num_elements sorted random column indexes
+Fiber_Buffer random_fiber(std::mt19937& rng, unsigned num_elements, bool values) {
+  std::uniform_int_distribution<uint32_t> col_dist(0, 1U << 20);
+  std::vector<uint32_t> cols(num_elements);
+  std::ranges::generate(cols, [&] { return col_dist(rng); });
+  std::ranges::sort(cols);
+  Fiber_Buffer fiber;
+  for (const auto col : cols) {
+    if (values) {
+      fiber.push_back(col, 1.0);
+    } else {
+      fiber.push_back(col);
+    }
+  }
+  return fiber;
+}
+
+// addresses of the blocks of the B rows in the order they are prefetched
+std::vector<Address> B_block_addresses(const Matrix_Data& data, std::size_t max_blocks) {
+  std::vector<Address> addresses;
+  for (const auto& [B_row_ptr, B_row_end] : data.preproc_B_row_ptr_end) {
+    for (auto ptr = B_row_ptr; ptr < B_row_end; ptr += block_size) {
+      addresses.push_back(data.B_elements_addr + ptr * element_size);
+      if (addresses.size() == max_blocks) { return addresses; }
+    }
+  }
+  return addresses;
+}
+
+void merge_add_benchmark(bool compute_result) {
+  auto& data = bench::wiki_vote_data();
+  data.compute_result = compute_result;
+  mergeforest::Merge_Tree_Manager manager(bench::mergeforest_config(), data);
+  std::mt19937 rng(1);
+  const auto fiber1 = random_fiber(rng, 256, compute_result);
+  const auto fiber2 = random_fiber(rng, 256, compute_result);
+  BENCHMARK_ADVANCED("merge two fibers of 256 elements")(Catch::Benchmark::Chronometer meter) {
+    std::vector<Fiber_Buffer> src1(static_cast<std::size_t>(meter.runs()), fiber1);
+    std::vector<Fiber_Buffer> src2(static_cast<std::size_t>(meter.runs()), fiber2);
+    Fiber_Buffer dest;
+    meter.measure([&](int run) {
+      const auto i = static_cast<std::size_t>(run);
+      unsigned num_elements {};
+      while (!src1[i].empty() && !src2[i].empty()) {
+        num_elements += Benchmark_Access::do_merge_add(manager, dest, src1[i], src2[i]);
+        dest.clear();
+      }
+      return num_elements;
+    });
+  };
+  data.compute_result = false;
+}
+
+} // namespace
+
+TEST_CASE("Merge_Tree_Manager::do_merge_add", "[micro]") {
+  SECTION("without values") { merge_add_benchmark(false); }
+  SECTION("with values") { merge_add_benchmark(true); }
+}
+
+TEST_CASE("fiber_buffer_transfer", "[micro]") {
+  std::mt19937 rng(1);
+  const auto fiber = random_fiber(rng, 1024, true);
+  BENCHMARK_ADVANCED("transfer 1024 elements 16 at a time")(Catch::Benchmark::Chronometer meter) {
+    std::vector<Fiber_Buffer> src(static_cast<std::size_t>(meter.runs()), fiber);
+    Fiber_Buffer dest;
+    meter.measure([&](int run) {
+      const auto i = static_cast<std::size_t>(run);
+      unsigned num_elements {};
+      while (!src[i].empty()) {
+        num_elements += mergeforest::fiber_buffer_transfer(src[i], dest, 16);
+        dest.clear();
+      }
+      return num_elements;
+    });
+  };
+}
+
+TEST_CASE("Linked_List_Cache::add_new_row", "[micro]") {
+  const auto& data = bench::wiki_vote_data();
+  mergeforest::Linked_List_Cache cache(bench::mergeforest_config(), data);
+  const auto& rows = data.preproc_B_row_ptr_end;
+  // adds the prefetched rows until the cache can't accept more
+  const auto fill_cache = [&] {
+    cache.reset();
+    std::size_t num_rows = 0;
+    while (num_rows < rows.size()
+           && Benchmark_Access::add_new_row(cache, rows[num_rows].first,
+                                            rows[num_rows].second) != UINT_MAX)
+    {
+      ++num_rows;
+    }
+    return num_rows;
+  };
+  BENCHMARK("reset and fill the cache") { return fill_cache(); };
+  const auto num_rows = fill_cache();
+  BENCHMARK("reuse the active rows") {
+    unsigned ptr_sum {};
+    for (std::size_t i = 0; i < num_rows; ++i) {
+      ptr_sum += Benchmark_Access::add_new_row(cache, rows[i].first, rows[i].second);
+    }
+    return ptr_sum;
+  };
+}
+
+TEST_CASE("Fiber_Cache::cache_search and cache_insert", "[micro]") {
+  const auto& data = bench::wiki_vote_data();
+  gamma::Fiber_Cache cache(bench::gamma_config(), data);
+  cache.reset();
+  const auto addresses = B_block_addresses(data, 1U << 16);
+  BENCHMARK("search and insert on miss") {
+    std::size_t num_hits {};
+    for (std::size_t i = 0; i < addresses.size(); ++i) {
+      if (Benchmark_Access::cache_search(cache, addresses[i]) != UINT_MAX) {
+        ++num_hits;
+      } else {
+        Benchmark_Access::cache_insert(cache, addresses[i], 1 + i % 4);
+      }
+    }
+    return num_hits;
+  };
+  BENCHMARK("search") {
+    std::size_t num_hits {};
+    for (const auto address : addresses) {
+      num_hits += Benchmark_Access::cache_search(cache, address) != UINT_MAX;
+    }
+    return num_hits;
+  };
+}
+
+TEST_CASE("Array_Fetcher::receive_data", "[micro]") {
+  std::vector<uint32_t> array(1U << 16);
+  std::iota(array.begin(), array.end(), 0U);
+  Array_Fetcher<uint32_t> fetcher(array);
+  fetcher.buffer_size = 256;
+  std::vector<Address> addresses;
+  // the responses of each batch of requests arrive in reverse order
+  BENCHMARK("fetch 64K elements with out of order responses") {
+    fetcher.reset();
+    fetcher.base_addr = 0;
+    std::size_t num_elements {};
+    while (!fetcher.finished()) {
+      addresses.clear();
+      for (auto address = fetcher.get_fetch_address(); address != invalid_address;
+           address = fetcher.get_fetch_address())
+      {
+        addresses.push_back(address);
+      }
+      for (auto it = addresses.rbegin(); it != addresses.rend(); ++it) {
+        num_elements += fetcher.receive_data(*it);
+      }
+      while (fetcher.num_elements > 0) { fetcher.pop(); }
+    }
+    return num_elements;
+  };
+}
+
+TEST_CASE("Port::transfer", "[micro]") {
+  SECTION("memory requests") {
+    Port<Mem_Request, Mem_Response> src;
+    Port<Mem_Response, Mem_Request> dest;
+    src.connect(&dest);
+    BENCHMARK("transfer 1024 requests") {
+      Address address_sum {};
+      for (Address address = 0; address < 1024 * mem_transaction_size;
+           address += mem_transaction_size)
+      {
+        src.add_msg_send(Mem_Request{.address = address});
+        src.transfer();
+        address_sum += dest.get_msg_received().address;
+        dest.clear_msg_received();
+      }
+      return address_sum;
+    };
+  }
+  SECTION("prefetched rows") {
+    using Rows = std::vector<mergeforest::Prefetched_Row>;
+    Port<Rows, Empty_Msg> src;
+    Port<Empty_Msg, Rows> dest;
+    src.connect(&dest);
+    const Rows rows(16);
+    BENCHMARK("transfer 1024 messages of 16 rows") {
+      std::size_t num_rows {};
+      for (unsigned i = 0; i < 1024; ++i) {
+        src.add_msg_send(rows);
+        src.transfer();
+        num_rows += dest.get_msg_received().size();
+        dest.clear_msg_received();
+      }
+      return num_rows;
+    };
+  }
+}
+
+TEST_CASE("read_matrix_market_file", "[micro]") {
+  const auto wiki_vote_file = bench::wiki_vote_file();
+  const auto& rmat_file = bench::rmat_file();
+  BENCHMARK("wiki-Vote") { return read_matrix_market_file(wiki_vote_file).nnz; };
+  BENCHMARK("R-MAT") { return read_matrix_market_file(rmat_file).nnz; };
+}
+
+TEST_CASE("spGEMM_symbolic_phase", "[micro]") {
+  const auto& wiki_vote = bench::wiki_vote();
+  const auto& rmat = bench::rmat();
+  BENCHMARK("wiki-Vote") {
+    Spmat_Csr C;
+    spGEMM_symbolic_phase(wiki_vote, wiki_vote, C);
+    return C.nnz;
+  };
+  BENCHMARK("R-MAT") {
+    Spmat_Csr C;
+    spGEMM_symbolic_phase(rmat, rmat, C);
+    return C.nnz;
+  };
+}
+
+} // namespace mergeforest_sim
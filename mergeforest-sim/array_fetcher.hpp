@@ -1,24 +1,38 @@
 #ifndef MERGEFOREST_SIM_ARRAY_FETCHER_HPP
 #define MERGEFOREST_SIM_ARRAY_FETCHER_HPP
 
+#include <mergeforest-sim/math_utils.hpp>
 #include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/ring_queue.hpp>
 
+#include <algorithm>
 #include <vector>
-#include <deque>
 #include <cassert>
 
 namespace mergeforest_sim {
 
+// The elements of a fetched array from begin onwards are stored in memory
+// from the element source_begin of the array at base_addr
+struct Fetch_Segment {
+  std::size_t begin {};
+  std::size_t source_begin {};
+};
+
 template<typename T>
 class Array_Fetcher {
 public:
-  Array_Fetcher(const std::vector<T>& vec_)
+  // without segments, or with an empty list of segments, the array is stored
+  // as is at base_addr. The segments are sorted by begin and can be added
+  // while fetching, together with the elements of the array.
+  Array_Fetcher(const std::vector<T>& vec_, const std::vector<Fetch_Segment>* segments_ = nullptr)
     : vec {vec_}
+    , segments {segments_}
   {}
 
   void reset() {
     idx = 0;
     idx_fetch = 0;
+    segment = 0;
     num_elements = 0;
     pending_reqs.clear();
   }
@@ -26,9 +40,22 @@ public:
   Address get_fetch_address() {
     if (idx_fetch >= vec.size()) return invalid_address;
     if (idx_fetch - idx > buffer_size - mem_transaction_size / sizeof(T)) return invalid_address;
-    Address address = base_addr + idx_fetch * sizeof(T);
-    pending_reqs.emplace_back(address, false);
-    idx_fetch += mem_transaction_size / sizeof(T);
+    // a request doesn't cross the end of its transaction nor of its segment
+    auto fetch_end = vec.size();
+    auto source_idx = idx_fetch;
+    if (segments != nullptr && !segments->empty()) {
+      while (segment + 1 < segments->size() && (*segments)[segment + 1].begin <= idx_fetch) {
+        ++segment;
+      }
+      source_idx = (*segments)[segment].source_begin + idx_fetch - (*segments)[segment].begin;
+      if (segment + 1 < segments->size()) { fetch_end = (*segments)[segment + 1].begin; }
+    }
+    const Address element_address = base_addr + source_idx * sizeof(T);
+    const Address address = round_down_multiple(element_address, Address{mem_transaction_size});
+    const auto num_elements_fetched = std::min<std::size_t>(
+      (address + mem_transaction_size - element_address) / sizeof(T), fetch_end - idx_fetch);
+    pending_reqs.push_back({address, num_elements_fetched, false});
+    idx_fetch += num_elements_fetched;
     return address;
   }
 
@@ -36,21 +63,17 @@ public:
     if (address == invalid_address) return 0;
     assert(!pending_reqs.empty());
     for (auto& req : pending_reqs) {
-      if (req.first == address) {
-        req.second = true;
+      if (req.address == address && !req.received) {
+        req.received = true;
         break;
       }
     }
     std::size_t total_elements_received {};
-    while (!pending_reqs.empty()) {
-      if (pending_reqs.front().second) {
-        const auto num_elements_received = 
-          std::min(mem_transaction_size / sizeof(T), vec.size() - num_elements - idx);
-        num_elements += num_elements_received;
-	total_elements_received += num_elements_received;
-        assert(num_elements <= buffer_size);
-        pending_reqs.pop_front();
-      } else break;
+    while (!pending_reqs.empty() && pending_reqs.front().received) {
+      num_elements += pending_reqs.front().num_elements;
+      total_elements_received += pending_reqs.front().num_elements;
+      assert(num_elements <= buffer_size);
+      pending_reqs.pop_front();
     }
     return total_elements_received;
   }
@@ -77,10 +100,19 @@ public:
   Address base_addr {invalid_address};
   std::size_t num_elements {};
 private:
+  struct Request {
+    Address address {};
+    std::size_t num_elements {};
+    bool received {};
+  };
+
   const std::vector<T>& vec;
+  const std::vector<Fetch_Segment>* segments;
   std::size_t idx {};
   std::size_t idx_fetch {};
-  std::deque<std::pair<Address, bool>> pending_reqs;
+  // segment of idx_fetch
+  std::size_t segment {};
+  Ring_Queue<Request> pending_reqs;
 };
 
 } // namespace mergeforest_sim
@@ -0,0 +1,76 @@
+#ifndef MERGEFOREST_SIM_CSR_ARRAY_HPP
+#define MERGEFOREST_SIM_CSR_ARRAY_HPP
+
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+namespace mergeforest_sim {
+
+// Contiguous array of a sparse matrix. It either owns its elements in a
+// std::vector or views memory kept alive by a shared owner (e.g. a mapped
+// cache file). Copies of a viewed array share the same memory.
+template<typename T>
+class Csr_Array {
+public:
+  Csr_Array() = default;
+  Csr_Array(std::vector<T>&& vec) : storage{std::move(vec)} { update_view(); }
+  Csr_Array(T* data_, std::size_t size_, std::shared_ptr<const void> owner_)
+    : owner{std::move(owner_)}, ptr{data_}, len{size_} {}
+
+  Csr_Array(const Csr_Array& other)
+    : storage{other.storage}, owner{other.owner}, ptr{other.ptr}, len{other.len}
+  {
+    if (!owner) { update_view(); }
+  }
+  Csr_Array(Csr_Array&& other) noexcept
+    : storage{std::move(other.storage)}, owner{std::move(other.owner)},
+      ptr{std::exchange(other.ptr, nullptr)}, len{std::exchange(other.len, 0)} {}
+  Csr_Array& operator=(Csr_Array other) noexcept {
+    swap(other);
+    return *this;
+  }
+  ~Csr_Array() = default;
+
+  void swap(Csr_Array& other) noexcept {
+    storage.swap(other.storage);
+    owner.swap(other.owner);
+    std::swap(ptr, other.ptr);
+    std::swap(len, other.len);
+  }
+
+  bool owns_data() const { return !owner; }
+  std::size_t size() const { return len; }
+  bool empty() const { return len == 0; }
+  T* data() { return ptr; }
+  const T* data() const { return ptr; }
+  T& operator[](std::size_t idx) { return ptr[idx]; }
+  const T& operator[](std::size_t idx) const { return ptr[idx]; }
+  T& back() { return ptr[len - 1]; }
+  const T& back() const { return ptr[len - 1]; }
+  T* begin() { return ptr; }
+  T* end() { return ptr + len; }
+  const T* begin() const { return ptr; }
+  const T* end() const { return ptr + len; }
+
+  void clear() {
+    storage.clear();
+    owner.reset();
+    update_view();
+  }
+private:
+  void update_view() {
+    ptr = storage.data();
+    len = storage.size();
+  }
+
+  std::vector<T> storage;
+  std::shared_ptr<const void> owner;
+  T* ptr {nullptr};
+  std::size_t len {0};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_CSR_ARRAY_HPP
@@ -0,0 +1,319 @@
+#include <mergeforest-sim/dram.hpp>
+#include <mergeforest-sim/math_utils.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace mergeforest_sim {
+
+Dram::Dram(const toml::value& parsed_config) {
+  get_config_params(parsed_config);
+  channels.resize(num_channels);
+  reset();
+}
+
+void Dram::reset() {
+  for (unsigned i = 0; i < num_channels; ++i) {
+    auto& channel = channels[i];
+    channel.queue.clear();
+    channel.queue.reserve(queue_size);
+    channel.banks.assign(bank_groups * banks_per_group, Bank{});
+    channel.next_column_bank_group.assign(bank_groups, 0);
+    channel.next_column = 0;
+    // the refreshes of the channels are staggered
+    channel.next_refresh = tREFI + std::size_t{i} * tREFI / num_channels;
+  }
+  for (auto& region : regions) {
+    region.accesses = 0;
+    region.row_hits = 0;
+  }
+  writes_issued = 0;
+  activates = 0;
+  precharges = 0;
+  refreshes = 0;
+  row_hits = 0;
+  row_misses = 0;
+  row_conflicts = 0;
+  read_latency_sum = 0;
+  reads_issued = 0;
+}
+
+bool Dram::can_accept(Address address) const {
+  return channels[address_field(address, ch)].queue.size() < queue_size;
+}
+
+void Dram::add_request(const Mem_Request& request, std::size_t port, std::size_t cycle) {
+  auto& channel = channels[address_field(request.address, ch)];
+  Request dram_request {
+    .request = request,
+    .port = port,
+    .arrival = cycle,
+    .row = address_field(request.address, ro),
+    .bank = address_field(request.address, bg) * banks_per_group
+      + address_field(request.address, ba),
+    .bank_group = address_field(request.address, bg),
+  };
+  if (!regions.empty()) {
+    const auto it = std::upper_bound(regions.begin(), regions.end(), request.address,
+                                     [](Address address, const Region& region) {
+                                       return address < region.begin;
+                                     });
+    dram_request.region =
+      static_cast<unsigned>(std::max<std::ptrdiff_t>(it - regions.begin(), 1) - 1);
+  }
+  const auto open_row = channel.banks[dram_request.bank].open_row;
+  if (open_row == dram_request.row) {
+    dram_request.arrival_state = Row_State::hit;
+  } else if (open_row == Bank::no_row) {
+    dram_request.arrival_state = Row_State::miss;
+  } else {
+    dram_request.arrival_state = Row_State::conflict;
+  }
+  channel.queue.push_back(dram_request);
+}
+
+bool Dram::update(std::size_t cycle, std::vector<Dram_Read>& reads) {
+  bool issued = false;
+  for (auto& channel : channels) {
+    if (issue_command(channel, cycle, reads)) { issued = true; }
+  }
+  return issued;
+}
+
+std::size_t Dram::cycles_to_next_event(std::size_t cycle) const {
+  auto next = SIZE_MAX;
+  for (const auto& channel : channels) {
+    if (cycle >= channel.next_refresh) {
+      std::size_t refresh_cycle {};
+      for (const auto& bank : channel.banks) {
+        if (bank.open_row != Bank::no_row) {
+          refresh_cycle = std::max(refresh_cycle, bank.next_pre);
+        }
+      }
+      next = std::min(next, refresh_cycle);
+      continue;
+    }
+    next = std::min(next, channel.next_refresh);
+    for (const auto& request : channel.queue) {
+      const auto& bank = channel.banks[request.bank];
+      if (bank.open_row == request.row) {
+        next = std::min(next, column_ready(channel, request));
+      } else if (bank.open_row == Bank::no_row) {
+        next = std::min(next, bank.next_act);
+      } else {
+        next = std::min(next, bank.next_pre);
+      }
+    }
+  }
+  return next > cycle ? next - cycle : 0;
+}
+
+void Dram::set_address_regions(const std::vector<std::pair<std::string, Address>>& regions_) {
+  regions.clear();
+  for (const auto& [name, begin] : regions_) {
+    regions.push_back(Region{.name = name, .begin = begin});
+  }
+}
+
+void Dram::print_stats(std::ostream& os, std::size_t cycles) const {
+  const auto accesses = row_hits + row_misses + row_conflicts;
+  const auto bus_utilization = ratio(accesses * tBURST, cycles * num_channels) * 100.0;
+  fmt::print(os, "*---DRAM---*\n");
+  fmt::print(os, "DRAM row hits: {} ({:.4f}%)\n", row_hits, ratio(row_hits, accesses) * 100.0);
+  fmt::print(os, "DRAM row misses: {} ({:.4f}%)\n", row_misses,
+             ratio(row_misses, accesses) * 100.0);
+  fmt::print(os, "DRAM row conflicts: {} ({:.4f}%)\n", row_conflicts,
+             ratio(row_conflicts, accesses) * 100.0);
+  fmt::print(os, "DRAM activates: {}\n", activates);
+  fmt::print(os, "DRAM precharges: {}\n", precharges);
+  fmt::print(os, "DRAM refreshes: {}\n", refreshes);
+  fmt::print(os, "DRAM average read latency: {:.4f} cycles\n",
+             ratio(read_latency_sum, reads_issued));
+  fmt::print(os, "DRAM data bus utilization: {:.4f}%\n", bus_utilization);
+  for (const auto& region : regions) {
+    fmt::print(os, "DRAM {} accesses: {} ({:.4f}% row hits)\n", region.name, region.accesses,
+               ratio(region.row_hits, region.accesses) * 100.0);
+  }
+}
+
+void Dram::get_config_params(const toml::value& parsed_config) {
+  num_channels = toml::find_or(parsed_config, "mem", "channels", 8u);
+  bank_groups = toml::find_or(parsed_config, "mem", "bank_groups", 4u);
+  banks_per_group = toml::find_or(parsed_config, "mem", "banks_per_group", 4u);
+  row_size = toml::find_or(parsed_config, "mem", "row_size", 1024u);
+  queue_size = toml::find_or(parsed_config, "mem", "queue_size", 32u);
+  controller_latency = toml::find_or(parsed_config, "mem", "controller_latency", 40u);
+  const auto page_policy = toml::find_or<std::string>(parsed_config, "mem", "page_policy", "open");
+  if (page_policy != "open" && page_policy != "closed") {
+    throw std::runtime_error(fmt::format("Unknown DRAM page policy {}", page_policy));
+  }
+  open_page = page_policy == "open";
+  tRCD = toml::find_or(parsed_config, "mem", "tRCD", 14u);
+  tRP = toml::find_or(parsed_config, "mem", "tRP", 14u);
+  tCAS = toml::find_or(parsed_config, "mem", "tCAS", 14u);
+  tRAS = toml::find_or(parsed_config, "mem", "tRAS", 33u);
+  tWR = toml::find_or(parsed_config, "mem", "tWR", 16u);
+  tBURST = toml::find_or(parsed_config, "mem", "tBURST", 2u);
+  // the data bus can't transfer two bursts at the same time
+  tCCD_S = std::max(toml::find_or(parsed_config, "mem", "tCCD_S", 2u), tBURST);
+  tCCD_L = std::max(toml::find_or(parsed_config, "mem", "tCCD_L", 4u), tCCD_S);
+  tRFC = toml::find_or(parsed_config, "mem", "tRFC", 260u);
+  tREFI = toml::find_or(parsed_config, "mem", "tREFI", 3900u);
+  if (num_channels == 0 || queue_size == 0 || tREFI <= tRFC) {
+    throw std::runtime_error("Invalid DRAM config");
+  }
+  parse_address_mapping(toml::find_or<std::string>(parsed_config, "mem", "address_mapping",
+                                                   "robabgcoch"));
+}
+
+void Dram::parse_address_mapping(const std::string& mapping) {
+  const std::array<std::string, num_fields> names {"ro", "ba", "bg", "co", "ch"};
+  const std::array<unsigned, num_fields> sizes {
+    0, banks_per_group, bank_groups, row_size / mem_transaction_size, num_channels
+  };
+  if (mapping.size() != 2 * num_fields || mapping.substr(0, 2) != "ro") {
+    throw std::runtime_error(fmt::format("Invalid DRAM address mapping {}: it must list the "
+                                         "fields ro, ba, bg, co and ch once, starting with ro",
+                                         mapping));
+  }
+  std::array<bool, num_fields> found {};
+  unsigned offset {};
+  // from the least significant field
+  for (auto pos = mapping.size(); pos > 0; pos -= 2) {
+    const auto name = mapping.substr(pos - 2, 2);
+    const auto it = std::find(names.begin(), names.end(), name);
+    if (it == names.end()) {
+      throw std::runtime_error(fmt::format("Unknown field {} in DRAM address mapping", name));
+    }
+    const auto field = static_cast<std::size_t>(it - names.begin());
+    if (found[field]) {
+      throw std::runtime_error(fmt::format("Repeated field {} in DRAM address mapping", name));
+    }
+    found[field] = true;
+    if (field != ro && (sizes[field] == 0 || !std::has_single_bit(sizes[field]))) {
+      throw std::runtime_error(fmt::format("The DRAM address field {} must have a power of "
+                                           "two number of values", name));
+    }
+    const auto width = field == ro ? 0 : static_cast<unsigned>(std::countr_zero(sizes[field]));
+    fields[field] = {offset, width};
+    offset += width;
+  }
+}
+
+unsigned Dram::address_field(Address address, Address_Field field) const {
+  const auto transaction = address / mem_transaction_size;
+  const auto [offset, width] = fields[field];
+  if (field == ro) {
+    return static_cast<unsigned>(transaction >> offset);
+  }
+  return static_cast<unsigned>((transaction >> offset) & ((Address{1} << width) - 1));
+}
+
+bool Dram::issue_command(Channel& channel, std::size_t cycle, std::vector<Dram_Read>& reads) {
+  if (cycle >= channel.next_refresh) {
+    return refresh(channel, cycle);
+  }
+  auto& queue = channel.queue;
+  // first ready: the oldest request to an open row
+  for (std::size_t i = 0; i < queue.size(); ++i) {
+    if (channel.banks[queue[i].bank].open_row == queue[i].row
+        && column_ready(channel, queue[i]) <= cycle)
+    {
+      issue_column(channel, i, cycle, reads);
+      return true;
+    }
+  }
+  // first come first served: the oldest request that needs a row
+  for (const auto& request : queue) {
+    auto& bank = channel.banks[request.bank];
+    if (bank.open_row == request.row) { continue; }
+    if (bank.open_row == Bank::no_row) {
+      if (bank.next_act > cycle) { continue; }
+      bank.open_row = request.row;
+      bank.act_cycle = cycle;
+      bank.next_column = cycle + tRCD;
+      bank.next_pre = std::max(bank.next_pre, cycle + tRAS);
+      ++activates;
+      return true;
+    }
+    // the open row is kept while there are requests to it
+    const auto row_hits_pending = std::ranges::any_of(queue, [&](const Request& other) {
+      return other.bank == request.bank && other.row == bank.open_row;
+    });
+    if (bank.next_pre > cycle || row_hits_pending) { continue; }
+    bank.open_row = Bank::no_row;
+    bank.next_act = cycle + tRP;
+    ++precharges;
+    return true;
+  }
+  return false;
+}
+
+bool Dram::refresh(Channel& channel, std::size_t cycle) {
+  const auto banks_ready = std::ranges::all_of(channel.banks, [&](const Bank& bank) {
+    return bank.open_row == Bank::no_row || bank.next_pre <= cycle;
+  });
+  if (!banks_ready) { return false; }
+  for (auto& bank : channel.banks) {
+    bank.open_row = Bank::no_row;
+    bank.next_act = std::max(bank.next_act, cycle + tRP + tRFC);
+  }
+  channel.next_refresh += tREFI;
+  ++refreshes;
+  return true;
+}
+
+std::size_t Dram::column_ready(const Channel& channel, const Request& request) const {
+  return std::max({channel.banks[request.bank].next_column, channel.next_column,
+                   channel.next_column_bank_group[request.bank_group]});
+}
+
+void Dram::issue_column(Channel& channel, std::size_t idx, std::size_t cycle,
+                        std::vector<Dram_Read>& reads)
+{
+  const auto request = channel.queue[idx];
+  auto& bank = channel.banks[request.bank];
+  auto row_state = Row_State::hit;
+  if (bank.act_cycle >= request.arrival) {
+    // the row was opened for this request or a younger one after a precharge
+    row_state = request.arrival_state == Row_State::miss ? Row_State::miss
+      : Row_State::conflict;
+  }
+  switch (row_state) {
+  case Row_State::hit: ++row_hits; break;
+  case Row_State::miss: ++row_misses; break;
+  case Row_State::conflict: ++row_conflicts; break;
+  }
+  if (!regions.empty()) {
+    auto& region = regions[request.region];
+    ++region.accesses;
+    if (row_state == Row_State::hit) { ++region.row_hits; }
+  }
+  channel.next_column = cycle + tCCD_S;
+  channel.next_column_bank_group[request.bank_group] = cycle + tCCD_L;
+  const auto data_cycle = cycle + tCAS + tBURST;
+  if (request.request.is_write) {
+    bank.next_pre = std::max(bank.next_pre, data_cycle + tWR);
+    ++writes_issued;
+  } else {
+    bank.next_pre = std::max(bank.next_pre, cycle + tBURST);
+    reads.push_back(Dram_Read{
+      .response = Mem_Response{.address = request.request.address, .id = request.request.id},
+      .port = request.port,
+      .data_cycle = data_cycle});
+    read_latency_sum += data_cycle + controller_latency - request.arrival;
+    ++reads_issued;
+  }
+  if (!open_page) {
+    bank.open_row = Bank::no_row;
+    bank.next_act = bank.next_pre + tRP;
+    ++precharges;
+  }
+  channel.queue.erase(channel.queue.begin() + static_cast<std::ptrdiff_t>(idx));
+}
+
+} // namespace mergeforest_sim
@@ -0,0 +1,144 @@
+#ifndef MERGEFOREST_SIM_DRAM_HPP
+#define MERGEFOREST_SIM_DRAM_HPP
+
+#include <mergeforest-sim/port.hpp>
+
+#include <toml.hpp>
+
+#include <array>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+// read whose data leaves the DRAM in data_cycle
+struct Dram_Read {
+  Mem_Response response;
+  std::size_t port {};
+  std::size_t data_cycle {};
+};
+
+// Cycle level model of a DRAM/HBM device with one FR-FCFS controller per
+// channel. Each channel has bank groups of banks with a row buffer each and
+// issues at most one command per cycle: ACT opens a row after tRP from the
+// last PRE, a RD or WR to the open row can follow tRCD after the ACT and
+// tCCD_S/tCCD_L after the last column command to another/the same bank group,
+// and its data occupies the bus tCAS cycles later for tBURST cycles. Banks
+// are precharged after tRAS from the ACT and tWR after the write data. With
+// the closed page policy every column command precharges its bank. Every
+// tREFI cycles a channel precharges all its banks and refreshes for tRFC
+// cycles. tRRD, tFAW and the read/write turnaround aren't modeled.
+//
+// The transaction addresses are split into row, bank, bank group, column and
+// channel fields in the order of address_mapping, from the most to the least
+// significant bits, e.g. "robabgcoch" interleaves consecutive transactions
+// across channels and then along the columns of a row.
+class Dram {
+public:
+  explicit Dram(const toml::value& parsed_config);
+  void reset();
+  // false if the queue of the channel of the address is full
+  bool can_accept(Address address) const;
+  void add_request(const Mem_Request& request, std::size_t port, std::size_t cycle);
+  // issues the commands of the cycle, appending the reads issued to reads.
+  // Returns true if any command was issued
+  bool update(std::size_t cycle, std::vector<Dram_Read>& reads);
+  // lower bound of the cycles until a command can be issued, 0 if unknown
+  std::size_t cycles_to_next_event(std::size_t cycle) const;
+  // the accesses and row hits are also reported for each of these regions,
+  // given as their names and start addresses in increasing order
+  void set_address_regions(const std::vector<std::pair<std::string, Address>>& regions);
+  void print_stats(std::ostream& os, std::size_t cycles) const;
+
+  // config parameters
+  unsigned controller_latency {};
+  // stats
+  std::size_t writes_issued {};
+  std::size_t activates {};
+  std::size_t precharges {};
+  std::size_t refreshes {};
+  std::size_t row_hits {};
+  std::size_t row_misses {};
+  std::size_t row_conflicts {};
+  std::size_t read_latency_sum {};
+  std::size_t reads_issued {};
+private:
+  enum class Row_State : uint8_t { hit, miss, conflict };
+
+  enum Address_Field : std::size_t { ro, ba, bg, co, ch, num_fields };
+
+  struct Request {
+    Mem_Request request;
+    std::size_t port {};
+    std::size_t arrival {};
+    uint32_t row {};
+    unsigned bank {};
+    unsigned bank_group {};
+    unsigned region {};
+    Row_State arrival_state {};
+  };
+
+  struct Bank {
+    static constexpr uint32_t no_row = UINT32_MAX;
+
+    uint32_t open_row {no_row};
+    std::size_t act_cycle {};
+    std::size_t next_act {};
+    std::size_t next_pre {};
+    std::size_t next_column {};
+  };
+
+  struct Channel {
+    std::vector<Request> queue;
+    std::vector<Bank> banks;
+    std::vector<std::size_t> next_column_bank_group;
+    std::size_t next_column {};
+    std::size_t next_refresh {};
+  };
+
+  struct Region {
+    std::string name;
+    Address begin {};
+    std::size_t accesses {};
+    std::size_t row_hits {};
+  };
+
+  void get_config_params(const toml::value& parsed_config);
+  void parse_address_mapping(const std::string& mapping);
+  unsigned address_field(Address address, Address_Field field) const;
+  bool issue_command(Channel& channel, std::size_t cycle, std::vector<Dram_Read>& reads);
+  bool refresh(Channel& channel, std::size_t cycle);
+  std::size_t column_ready(const Channel& channel, const Request& request) const;
+  void issue_column(Channel& channel, std::size_t idx, std::size_t cycle,
+                    std::vector<Dram_Read>& reads);
+
+  std::vector<Channel> channels;
+  std::vector<Region> regions;
+  // bit offset and width of each address field
+  std::array<std::pair<unsigned, unsigned>, num_fields> fields {};
+  // config parameters
+  unsigned num_channels {};
+  unsigned bank_groups {};
+  unsigned banks_per_group {};
+  unsigned row_size {};
+  unsigned queue_size {};
+  bool open_page {};
+  unsigned tRCD {};
+  unsigned tRP {};
+  unsigned tCAS {};
+  unsigned tRAS {};
+  unsigned tWR {};
+  unsigned tBURST {};
+  unsigned tCCD_S {};
+  unsigned tCCD_L {};
+  unsigned tRFC {};
+  unsigned tREFI {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_DRAM_HPP
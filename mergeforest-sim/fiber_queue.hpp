@@ -0,0 +1,123 @@
+#ifndef MERGEFOREST_SIM_FIBER_QUEUE_HPP
+#define MERGEFOREST_SIM_FIBER_QUEUE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+// FIFO of fiber elements stored in a ring buffer, with the column indexes and
+// the values in separate contiguous arrays. The capacity is a power of two
+// that doubles when an element doesn't fit, so a queue reserved with the size
+// of the hardware buffer it models never reallocates. The values array is only
+// allocated when the first value is pushed, so simulations that don't compute
+// the result only move column indexes.
+class Fiber_Queue {
+public:
+  bool empty() const { return num_elements == 0; }
+  std::size_t size() const { return num_elements; }
+  bool has_values() const { return !values_buf.empty(); }
+
+  void reserve(std::size_t capacity) {
+    if (capacity > col_idx_buf.size()) { grow(capacity); }
+  }
+
+  void clear() {
+    head = 0;
+    num_elements = 0;
+  }
+
+  uint32_t front_col_idx() const {
+    assert(!empty());
+    return col_idx_buf[head];
+  }
+
+  double front_value() const {
+    assert(!empty() && has_values());
+    return values_buf[head];
+  }
+
+  void push_back(uint32_t col_idx) {
+    if (num_elements == col_idx_buf.size()) { grow(num_elements + 1); }
+    col_idx_buf[(head + num_elements) & mask] = col_idx;
+    ++num_elements;
+  }
+
+  void push_back(uint32_t col_idx, double value) {
+    if (num_elements == col_idx_buf.size()) { grow(num_elements + 1); }
+    if (!has_values()) { values_buf.resize(col_idx_buf.size()); }
+    const auto idx = (head + num_elements) & mask;
+    col_idx_buf[idx] = col_idx;
+    values_buf[idx] = value;
+    ++num_elements;
+  }
+
+  void pop_front() {
+    assert(!empty());
+    head = (head + 1) & mask;
+    --num_elements;
+  }
+
+  void pop_front(std::size_t n) {
+    assert(n <= num_elements);
+    head = (head + n) & mask;
+    num_elements -= n;
+  }
+
+  // moves the first n elements of src to the back of the queue, copying at
+  // most three contiguous chunks of each array
+  void transfer(Fiber_Queue& src, std::size_t n) {
+    assert(n <= src.size());
+    reserve(num_elements + n);
+    if (src.has_values() && !has_values()) { values_buf.resize(col_idx_buf.size()); }
+    std::size_t src_idx = src.head;
+    std::size_t dest_idx = (head + num_elements) & mask;
+    for (std::size_t left = n; left > 0;) {
+      const auto chunk = std::min({left, src.col_idx_buf.size() - src_idx,
+                                   col_idx_buf.size() - dest_idx});
+      std::copy_n(src.col_idx_buf.begin() + static_cast<std::ptrdiff_t>(src_idx), chunk,
+                  col_idx_buf.begin() + static_cast<std::ptrdiff_t>(dest_idx));
+      if (src.has_values()) {
+        std::copy_n(src.values_buf.begin() + static_cast<std::ptrdiff_t>(src_idx), chunk,
+                    values_buf.begin() + static_cast<std::ptrdiff_t>(dest_idx));
+      }
+      src_idx = (src_idx + chunk) & src.mask;
+      dest_idx = (dest_idx + chunk) & mask;
+      left -= chunk;
+    }
+    num_elements += n;
+    src.pop_front(n);
+  }
+
+private:
+  static constexpr std::size_t min_capacity {16};
+
+  void grow(std::size_t capacity) {
+    capacity = std::max(std::bit_ceil(capacity), min_capacity);
+    std::vector<uint32_t> new_col_idx(capacity);
+    std::vector<double> new_values(has_values() ? capacity : 0);
+    for (std::size_t i = 0; i < num_elements; ++i) {
+      new_col_idx[i] = col_idx_buf[(head + i) & mask];
+      if (has_values()) { new_values[i] = values_buf[(head + i) & mask]; }
+    }
+    col_idx_buf = std::move(new_col_idx);
+    values_buf = std::move(new_values);
+    head = 0;
+    mask = capacity - 1;
+  }
+
+  std::vector<uint32_t> col_idx_buf;
+  std::vector<double> values_buf;
+  std::size_t head {};
+  std::size_t num_elements {};
+  std::size_t mask {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_FIBER_QUEUE_HPP
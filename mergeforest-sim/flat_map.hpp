@@ -0,0 +1,128 @@
+#ifndef MERGEFOREST_SIM_FLAT_MAP_HPP
+#define MERGEFOREST_SIM_FLAT_MAP_HPP
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+// Hash map with open addressing and linear probing for integer keys. The
+// slots are stored in a single array with a power of two size, at most half
+// full, so lookups usually read one or two contiguous slots. Erasing shifts
+// back the following slots of the probe sequence instead of leaving
+// tombstones. empty_key marks the empty slots and can't be used as a key.
+template<typename Key, typename Value, Key empty_key>
+class Flat_Map {
+public:
+  explicit Flat_Map(std::size_t capacity = 8) { reserve(capacity); }
+
+  bool empty() const { return num_elements == 0; }
+  std::size_t size() const { return num_elements; }
+
+  // allocates the slots for capacity elements
+  void reserve(std::size_t capacity) {
+    const auto num_slots = std::bit_ceil(std::max<std::size_t>(2 * capacity, 8));
+    if (num_slots > slots.size()) { rehash(num_slots); }
+  }
+
+  void clear() {
+    if (num_elements == 0) { return; }
+    for (auto& slot : slots) {
+      if (slot.first != empty_key) { slot = {empty_key, Value{}}; }
+    }
+    num_elements = 0;
+  }
+
+  // nullptr if the key isn't in the map
+  Value* find(Key key) {
+    for (auto idx = home(key); ; idx = (idx + 1) & mask()) {
+      if (slots[idx].first == key) { return &slots[idx].second; }
+      if (slots[idx].first == empty_key) { return nullptr; }
+    }
+  }
+  const Value* find(Key key) const {
+    return const_cast<Flat_Map*>(this)->find(key);
+  }
+  bool contains(Key key) const { return find(key) != nullptr; }
+
+  // inserts a default constructed value if the key isn't in the map
+  Value& operator[](Key key) {
+    auto idx = probe(key);
+    if (slots[idx].first == key) { return slots[idx].second; }
+    if (2 * (num_elements + 1) > slots.size()) {
+      rehash(2 * slots.size());
+      idx = probe(key);
+    }
+    slots[idx].first = key;
+    ++num_elements;
+    return slots[idx].second;
+  }
+
+  Value& insert(Key key, Value value) {
+    auto& slot_value = (*this)[key];
+    slot_value = std::move(value);
+    return slot_value;
+  }
+
+  // returns false if the key isn't in the map
+  bool erase(Key key) {
+    auto idx = probe(key);
+    if (slots[idx].first != key) { return false; }
+    // moves back the slots that would be unreachable after emptying idx
+    for (auto next = (idx + 1) & mask(); slots[next].first != empty_key;
+         next = (next + 1) & mask())
+    {
+      const auto next_home = home(slots[next].first);
+      // the element in next stays if its home is cyclically in (idx, next]
+      const bool stays = idx <= next ? (idx < next_home && next_home <= next)
+                                     : (idx < next_home || next_home <= next);
+      if (stays) { continue; }
+      slots[idx] = std::move(slots[next]);
+      idx = next;
+    }
+    slots[idx] = {empty_key, Value{}};
+    --num_elements;
+    return true;
+  }
+
+private:
+  std::size_t mask() const { return slots.size() - 1; }
+
+  // Fibonacci hashing, the keys are often consecutive or aligned addresses
+  std::size_t home(Key key) const {
+    const auto hash = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<std::size_t>(hash >> (64 - std::countr_zero(slots.size())));
+  }
+
+  // slot of the key or the empty slot where it would be inserted
+  std::size_t probe(Key key) const {
+    assert(key != empty_key);
+    auto idx = home(key);
+    while (slots[idx].first != key && slots[idx].first != empty_key) {
+      idx = (idx + 1) & mask();
+    }
+    return idx;
+  }
+
+  void rehash(std::size_t num_slots) {
+    auto old_slots = std::exchange(slots, std::vector<std::pair<Key, Value>>(
+      num_slots, std::pair<Key, Value>{empty_key, Value{}}));
+    for (auto& slot : old_slots) {
+      if (slot.first == empty_key) { continue; }
+      const auto idx = probe(slot.first);
+      slots[idx] = std::move(slot);
+    }
+  }
+
+  std::vector<std::pair<Key, Value>> slots;
+  std::size_t num_elements {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_FLAT_MAP_HPP
@@ -5,6 +5,7 @@
 #include <mergeforest-sim/gamma/fiber_cache.hpp>
 #include <mergeforest-sim/main_memory.hpp>
 #include <mergeforest-sim/sparse_matrix.hpp>
+#include <mergeforest-sim/time_series.hpp>
 #include <mergeforest-sim/matrix_data.hpp>
 
 #include <toml.hpp>
@@ -16,12 +17,14 @@ public:
   Gamma(const toml::value& parsed_config, Matrix_Data& matrix_data_,
 	const std::string& out_path_);
   Spmat_Csr run_simulation(bool compute_result);
+  void print_stats(std::ostream& os);
 private:
   void reset();
+  template<bool profile> void simulation_loop();
+  void skip_idle_cycles();
   void print_progress();
   void check_valid_simulation();
   void print_stats();
-  void print_stats_impl(std::ostream& os);
 
   const std::size_t progress_interval = 10000;
   const toml::value& parsed_config;
@@ -31,6 +34,7 @@ private:
   gamma::PE_Manager PE_manager;
   gamma::Fiber_Cache fiber_cache;
   Main_Memory main_mem;
+  Time_Series_Writer time_series;
   std::size_t cycles {};
 };
 
@@ -10,7 +10,14 @@ bool C_Partial_Fiber::empty() const {
 }
 
 bool C_Partial_Fiber::is_finished() const {
-  return finished && col_idx.empty();
+  return finished && data.empty();
+}
+
+void C_Partial_Fiber::clear() {
+  data.clear();
+  begin = invalid_address;
+  end = invalid_address;
+  finished = false;
 }
 
 bool Input_Fiber::finished() const {
@@ -22,7 +29,10 @@ bool Input_Fiber::finished() const {
 
 bool Task::valid() const { return !inputs.empty(); }
 
-PE::PE(Matrix_Data& matrix_data_) : matrix_data{ matrix_data_ } {
+PE::PE(Matrix_Data& matrix_data_, PE_Context& context_)
+  : matrix_data{ matrix_data_ }
+  , context{ context_ }
+{
   reset();
 }
 
@@ -32,7 +42,8 @@ void PE::reset() {
   cur_task_finished = false;
   C_col_idx = UINT_MAX;
   C_value = 0.0;
-  input_buffers = std::vector<Input_Buffer>(PE::radix);
+  input_buffers = std::vector<Input_Buffer>(context.radix);
+  for (auto& buffer : input_buffers) { buffer.data.reserve(context.input_buffer_size); }
   read_arbiter = UINT64_MAX;
   write_address = invalid_address;
   num_bytes_write = 0;
@@ -56,7 +67,7 @@ Mem_Request PE::get_cache_request() {
     auto& buffer = input_buffers[read_arbiter];
     unsigned num_elements_fetch {};
     if (in_fiber->C_partial_fiber) {
-      const unsigned C_num_elements = static_cast<unsigned>(in_fiber->C_partial_fiber->col_idx.size());
+      const unsigned C_num_elements = static_cast<unsigned>(in_fiber->C_partial_fiber->data.size());
       if (C_num_elements == 0) continue;
       if (C_num_elements >= block_size) {
 	num_elements_fetch = block_size;
@@ -68,7 +79,7 @@ Mem_Request PE::get_cache_request() {
     } else {
       num_elements_fetch = std::min(in_fiber->B_row_end - in_fiber->B_row_ptr, block_size - in_fiber->B_row_ptr % block_size);
     }
-    if (buffer.col_idx.size() + num_elements_fetch > Input_Buffer::buffer_size) continue;
+    if (buffer.data.size() + num_elements_fetch > context.input_buffer_size) continue;
     Mem_Request req{.id = static_cast<unsigned>(read_arbiter), .is_write = false};
     // put data in buffers and set request address
     if (in_fiber->C_partial_fiber) {
@@ -77,30 +88,27 @@ Mem_Request PE::get_cache_request() {
       in_fiber->C_partial_fiber->begin += num_elements_fetch * element_size;
       assert(in_fiber->C_partial_fiber->end >= in_fiber->C_partial_fiber->begin);
       // transfer data from C_partial fiber to buffer
-      auto& C_partial_col_idx = in_fiber->C_partial_fiber->col_idx;
-      buffer.col_idx.insert(buffer.col_idx.end(), C_partial_col_idx.begin(), C_partial_col_idx.begin() + num_elements_fetch); 
-      C_partial_col_idx.erase(C_partial_col_idx.begin(), C_partial_col_idx.begin() + num_elements_fetch);
-      if (matrix_data.compute_result) {
-	auto& C_partial_values = in_fiber->C_partial_fiber->values;
-	buffer.values.insert(buffer.values.end(), C_partial_values.begin(), C_partial_values.begin() + num_elements_fetch); 
-	C_partial_values.erase(C_partial_values.begin(), C_partial_values.begin() + num_elements_fetch);
-      }
+      buffer.data.transfer(in_fiber->C_partial_fiber->data, num_elements_fetch);
       if (in_fiber->C_partial_fiber->is_finished()) {
-	assert(C_Partial_Fiber::num_fibers > 0);
-	--C_Partial_Fiber::num_fibers;
-	*in_fiber->C_partial_fiber = C_Partial_Fiber{};
+	assert(context.num_C_partial_fibers > 0);
+	--context.num_C_partial_fibers;
+	in_fiber->C_partial_fiber->clear();
 	in_fiber->C_partial_fiber = nullptr;
       }
     } else {
       req.address = matrix_data.B_elements_addr + in_fiber->B_row_ptr * element_size;
-      for (unsigned j = 0; j < num_elements_fetch; ++j) {
-	buffer.col_idx.push_back(matrix_data.B->col_idx[in_fiber->B_row_ptr + j]);
-	if (matrix_data.compute_result) {
-	  buffer.values.push_back(matrix_data.B->values[in_fiber->B_row_ptr + j]);
+      const auto B_row_ptr = in_fiber->B_row_ptr;
+      if (matrix_data.compute_result) {
+	for (unsigned j = B_row_ptr; j < B_row_ptr + num_elements_fetch; ++j) {
+	  buffer.data.push_back(matrix_data.B->col_idx[j], matrix_data.B->values[j]);
+	}
+      } else {
+	for (unsigned j = B_row_ptr; j < B_row_ptr + num_elements_fetch; ++j) {
+	  buffer.data.push_back(matrix_data.B->col_idx[j]);
 	}
       }
       in_fiber->B_row_ptr += num_elements_fetch;
-      PE::num_mults += num_elements_fetch;
+      context.num_mults += num_elements_fetch;
       assert(in_fiber->B_row_end >= in_fiber->B_row_ptr);
     }
     req.address = round_down_multiple(req.address, static_cast<std::size_t>(block_size_bytes));
@@ -128,18 +136,19 @@ void PE::receive_cache_response(Mem_Response mem_response) {
     buffer.num_elements_received += std::get<1>(buffer.pending_reqs.front());
     buffer.pending_reqs.pop_front();
   }     
-  assert(buffer.num_elements_received <= buffer.col_idx.size());
+  assert(buffer.num_elements_received <= buffer.data.size());
 }
 
-void PE::update() {
+template<bool compute_result>
+bool PE::update() {
   if (!cur_task.valid()) {
-    ++PE::idle_cycles;
-    return;
+    ++context.idle_cycles;
+    return false;
   }
-  if (cur_task_finished) return;
-  if (num_bytes_write + element_size > PE::output_buffer_size * element_size) {
-    ++PE::write_stalls;
-    return;
+  if (cur_task_finished) return false;
+  if (num_bytes_write + element_size > context.output_buffer_size * element_size) {
+    ++context.write_stalls;
+    return false;
   }
   unsigned min_col_idx = {UINT_MAX};
   unsigned min_idx = {UINT_MAX};
@@ -154,8 +163,8 @@ void PE::update() {
       stall = true;
       continue;
     };
-    if (input_buffers[i].col_idx.front() < min_col_idx) {
-      min_col_idx = input_buffers[i].col_idx.front();
+    if (input_buffers[i].data.front_col_idx() < min_col_idx) {
+      min_col_idx = input_buffers[i].data.front_col_idx();
       min_idx = i;
     }
   }
@@ -164,75 +173,75 @@ void PE::update() {
     cur_task_finished = true;
     assert(C_col_idx != UINT_MAX);
     if (cur_task.C_partial_fiber) {
-      cur_task.C_partial_fiber->col_idx.push_back(C_col_idx);
-      if (matrix_data.compute_result) {
-	cur_task.C_partial_fiber->values.push_back(C_value);
+      if constexpr (compute_result) {
+	cur_task.C_partial_fiber->data.push_back(C_col_idx, C_value);
+      } else {
+	cur_task.C_partial_fiber->data.push_back(C_col_idx);
       }
       cur_task.C_partial_fiber->finished = true;
-      ++PE::num_C_partial_elements;
-      ++PE::num_C_partial_rows;
+      ++context.num_C_partial_elements;
+      ++context.num_C_partial_rows;
     } else {
-      if (matrix_data.compute_result) {
+      if constexpr (compute_result) {
 	matrix_data.C.col_idx[cur_task.C_row_ptr] = C_col_idx;
 	matrix_data.C.values[cur_task.C_row_ptr] = C_value;
       }
       ++cur_task.C_row_ptr;
       matrix_data.C.row_end[cur_task.C_row_idx] = cur_task.C_row_ptr;
       ++matrix_data.C.nnz;
-      ++PE::num_finished_rows;
+      ++context.num_finished_rows;
     }
     num_bytes_write += element_size;
-    PE::max_bytes_write = std::max(PE::max_bytes_write, num_bytes_write);
+    context.max_bytes_write = std::max(context.max_bytes_write, num_bytes_write);
     C_col_idx = UINT_MAX;
     C_value = 0.0;
-    return;
+    return true;
   }
   if (stall) {
-    ++PE::B_data_stalls;
-    return;
+    ++context.B_data_stalls;
+    return false;
   }
   assert(min_idx != UINT_MAX);
   // execute one multiply add
   if (C_col_idx == UINT_MAX) {
     C_col_idx = min_col_idx;
-    if (matrix_data.compute_result) {
-      C_value = cur_task.inputs[min_idx].A_value * input_buffers[min_idx].values.front();
+    if constexpr (compute_result) {
+      C_value = cur_task.inputs[min_idx].A_value * input_buffers[min_idx].data.front_value();
     }
   } else if (min_col_idx > C_col_idx) {
     if (cur_task.C_partial_fiber) {
-      ++PE::num_C_partial_elements;
-      cur_task.C_partial_fiber->col_idx.push_back(C_col_idx);
-      if (matrix_data.compute_result) {
-	cur_task.C_partial_fiber->values.push_back(C_value);
+      ++context.num_C_partial_elements;
+      if constexpr (compute_result) {
+	cur_task.C_partial_fiber->data.push_back(C_col_idx, C_value);
+      } else {
+	cur_task.C_partial_fiber->data.push_back(C_col_idx);
       }
     } else {
       ++matrix_data.C.nnz;
-      if (matrix_data.compute_result) {
+      if constexpr (compute_result) {
 	matrix_data.C.values[cur_task.C_row_ptr] = C_value;
 	matrix_data.C.col_idx[cur_task.C_row_ptr] = C_col_idx;
       }
       ++cur_task.C_row_ptr;
     }
     num_bytes_write += element_size;
-    PE::max_bytes_write = std::max(PE::max_bytes_write, num_bytes_write);
+    context.max_bytes_write = std::max(context.max_bytes_write, num_bytes_write);
     C_col_idx = min_col_idx;
-    if (matrix_data.compute_result) {
-      C_value = cur_task.inputs[min_idx].A_value * input_buffers[min_idx].values.front();
+    if constexpr (compute_result) {
+      C_value = cur_task.inputs[min_idx].A_value * input_buffers[min_idx].data.front_value();
     }
   } else {
     assert(min_col_idx == C_col_idx);
-    ++PE::num_adds;
-    if (matrix_data.compute_result) {
-      C_value += cur_task.inputs[min_idx].A_value * input_buffers[min_idx].values.front();
+    ++context.num_adds;
+    if constexpr (compute_result) {
+      C_value += cur_task.inputs[min_idx].A_value * input_buffers[min_idx].data.front_value();
     }
   }
   // pop element from input buffer
   --input_buffers[min_idx].num_elements_received;
   --input_buffers[min_idx].num_elems_fetched_cur_task;
-  input_buffers[min_idx].col_idx.pop_front();
-  if (matrix_data.compute_result) {
-    input_buffers[min_idx].values.pop_front();
-  }
+  input_buffers[min_idx].data.pop_front();
+  return true;
 }
 
 void Task_Tree::reset() {
@@ -245,13 +254,15 @@ void Task_Tree::reset() {
   C_partial_fibers.clear();
 }
 
-void Task_Tree::init(unsigned num_rows, unsigned C_row_idx_, unsigned C_row_ptr_) {
-  unsigned second_level_num_rows = nearest_pow_floor(num_rows, PE::radix);
-  B_rows_first_level = div_ceil((num_rows - second_level_num_rows) * PE::radix, PE::radix - 1); 
+void Task_Tree::init(unsigned num_rows, unsigned radix, unsigned C_row_idx_,
+                     unsigned C_row_ptr_)
+{
+  unsigned second_level_num_rows = nearest_pow_floor(num_rows, radix);
+  B_rows_first_level = div_ceil((num_rows - second_level_num_rows) * radix, radix - 1); 
   B_rows_second_level = num_rows - B_rows_first_level;
-  unsigned num_levels = log_ceil(num_rows, PE::radix); 
+  unsigned num_levels = log_ceil(num_rows, radix); 
   num_C_partials_level = std::vector<unsigned>(num_levels);
-  C_partial_fibers = std::vector<C_Partial_Fiber*>(num_levels * PE::radix);
+  C_partial_fibers = std::vector<C_Partial_Fiber*>(num_levels * radix);
   C_row_idx = C_row_idx_;
   C_row_ptr = C_row_ptr_;
 }
@@ -299,23 +310,29 @@ void PE_Manager::reset() {
   B_row_ptr_end_fetcher.base_addr = matrix_data.preproc_B_row_ptr_end_addr;
   read_arbiter = UINT_MAX;
   num_elements_prefetch = 0;
-  for (auto pe : PEs) { pe.reset(); };
+  for (auto& pe : PEs) { pe.reset(); };
   std::fill(C_partial_fibers.begin(), C_partial_fibers.end(), C_Partial_Fiber{});
-  C_Partial_Fiber::num_fibers = 0;
+  context.num_C_partial_fibers = 0;
   task_tree.reset();
-  PE::num_mults = 0;
-  PE::num_adds = 0;
-  PE::num_finished_rows = 0;
-  PE::num_C_partial_rows = 0;
-  PE::num_C_partial_elements = 0;
-  PE::idle_cycles = 0;
-  PE::B_data_stalls = 0;
-  PE::C_writes = 0;
-  PE::max_bytes_write = 0;
+  active = false;
+  context.num_mults = 0;
+  context.num_adds = 0;
+  context.num_finished_rows = 0;
+  context.num_C_partial_rows = 0;
+  context.num_C_partial_elements = 0;
+  context.idle_cycles = 0;
+  context.B_data_stalls = 0;
+  context.write_stalls = 0;
+  context.C_writes = 0;
+  context.max_bytes_write = 0;
   preproc_A_reads = 0;
 }
 
 void PE_Manager::update() {
+  active = false;
+  cycle_idle_cycles = context.idle_cycles;
+  cycle_B_data_stalls = context.B_data_stalls;
+  cycle_write_stalls = context.write_stalls;
   // send mem request of 1 of the arrays to main memory
   if (!mem_read_ports[0].has_msg_send()) {
     Mem_Request request {};
@@ -339,6 +356,7 @@ void PE_Manager::update() {
 	request.id = read_arbiter;
         mem_read_ports[0].add_msg_send(request);
 	++preproc_A_reads;
+        active = true;
         break;
       }
     }
@@ -350,13 +368,15 @@ void PE_Manager::update() {
     if (request.valid()) {
       mem_read_ports[1].add_msg_send(request);
       ++preproc_A_reads;
+      active = true;
     }
   }
-  // send prefetch request
+  // send prefetch request, a request of zero rows doesn't change any state
   if (!prefetch_port.has_msg_send()) {
     const auto n = std::min(num_elements_prefetch, prefetched_rows_per_cycle);
     num_elements_prefetch -= n;
     prefetch_port.add_msg_send(n);
+    if (n > 0) { active = true; }
   }
   // send cache read requests
   for (unsigned i = 0; i < PEs.size(); ++i) {
@@ -364,25 +384,28 @@ void PE_Manager::update() {
     const auto req = PEs[i].get_cache_request();
     if (req.valid()) { 
       cache_read_ports[i].add_msg_send(req);
+      active = true;
     }
   }
   write_data();
   // update PEs
   for (auto& pe : PEs) {
-    pe.update();
+    const bool pe_active = matrix_data.compute_result ? pe.update<true>()
+      : pe.update<false>();
+    if (pe_active) { active = true; }
   }
   allocate_tasks();
   for (auto& p: mem_read_ports) {
-    p.transfer();
+    if (p.transfer()) { active = true; }
   }
   for (auto& p: mem_write_ports) {
-    p.transfer();
+    if (p.transfer()) { active = true; }
   }
   for (auto& p: cache_read_ports) {
-    p.transfer();
+    if (p.transfer()) { active = true; }
   }
   for (auto& p: cache_write_ports) {
-    p.transfer();
+    if (p.transfer()) { active = true; }
   }
   prefetch_port.transfer();
 }
@@ -390,6 +413,7 @@ void PE_Manager::update() {
 void PE_Manager::apply() {
   // receive mem responses
   if (mem_read_ports[0].msg_received_valid()) {
+    active = true;
     const auto mem_read_resp = mem_read_ports[0].get_msg_received();
     assert(mem_read_resp.id < 4);
     switch (mem_read_resp.id) {
@@ -409,6 +433,7 @@ void PE_Manager::apply() {
     mem_read_ports[0].clear_msg_received();
   }
   if (mem_read_ports[1].msg_received_valid()) {
+    active = true;
     const auto mem_read_resp = mem_read_ports[1].get_msg_received();
     num_elements_prefetch += B_row_ptr_end_fetcher.receive_data(mem_read_resp.address);
     mem_read_ports[1].clear_msg_received();
@@ -418,6 +443,7 @@ void PE_Manager::apply() {
     if (!cache_read_ports[i].msg_received_valid()) continue;
     PEs[i].receive_cache_response(cache_read_ports[i].get_msg_received());
     cache_read_ports[i].clear_msg_received();
+    active = true;
   }
 }
 
@@ -446,7 +472,7 @@ PE_Manager::Prefetch_Port* PE_Manager::get_prefetch_port() {
 }
 
 bool PE_Manager::finished() const {
-  if (PE::num_finished_rows < matrix_data.preproc_A_row_idx.size()) return false;
+  if (context.num_finished_rows < matrix_data.preproc_A_row_idx.size()) return false;
   // check if all PEs finished writing
   for (const auto& pe : PEs) {
     if (pe.num_bytes_write > 0) return false;
@@ -454,19 +480,39 @@ bool PE_Manager::finished() const {
   return true;
 }
 
+bool PE_Manager::idle() const {
+  return !active;
+}
+
+void PE_Manager::skip_cycles(std::size_t num_cycles) {
+  // an idle cycle repeats the stalls of the last cycle
+  context.idle_cycles += num_cycles * (context.idle_cycles - cycle_idle_cycles);
+  context.B_data_stalls += num_cycles * (context.B_data_stalls - cycle_B_data_stalls);
+  context.write_stalls += num_cycles * (context.write_stalls - cycle_write_stalls);
+}
+
+void PE_Manager::add_time_series_columns(Time_Series_Writer& time_series) const {
+  time_series.add_counter("mults", &context.num_mults);
+  time_series.add_counter("adds", &context.num_adds);
+  time_series.add_counter("idle_cycles", &context.idle_cycles);
+  time_series.add_counter("B_data_stalls", &context.B_data_stalls);
+  time_series.add_counter("write_stalls", &context.write_stalls);
+  time_series.add_counter("C_writes", &context.C_writes);
+}
+
 void PE_Manager::get_config_params(const toml::value& parsed_config) {
-  PE::radix = toml::find<unsigned>(parsed_config, "PE_manager", "PE_radix");
-  Input_Buffer::buffer_size = toml::find_or(parsed_config, "PE_manager",
+  context.radix = toml::find<unsigned>(parsed_config, "PE_manager", "PE_radix");
+  context.input_buffer_size = toml::find_or(parsed_config, "PE_manager",
                                             "PE_input_buffer_size", 16ul);
-  PE::output_buffer_size = toml::find_or(parsed_config, "PE_manager",
+  context.output_buffer_size = toml::find_or(parsed_config, "PE_manager",
                                          "PE_output_buffer_size", 16u);
   const auto num_PEs = toml::find<unsigned>(parsed_config, "PE_manager", "num_PEs");
   mem_write_ports = std::vector<Mem_Port>(num_PEs);
   cache_read_ports = std::vector<Mem_Port>(num_PEs);
   cache_write_ports = std::vector<Mem_Port>(num_PEs);
-  PEs = std::vector<PE>(num_PEs, PE{matrix_data});
-  const auto task_tree_max_level = 32u / log2_ceil(PE::radix);
-  const auto max_partial_fibers = std::max(task_tree_max_level * PE::radix, 2 * num_PEs); 
+  PEs = std::vector<PE>(num_PEs, PE{matrix_data, context});
+  const auto task_tree_max_level = 32u / log2_ceil(context.radix);
+  const auto max_partial_fibers = std::max(task_tree_max_level * context.radix, 2 * num_PEs); 
   C_partial_fibers = std::vector<C_Partial_Fiber>(max_partial_fibers);
   prefetched_rows_per_cycle = toml::find_or(parsed_config, "PE_manager", "prefetched_rows_per_cycle", 4u);
   A_row_ptr_fetcher.buffer_size = toml::find_or(parsed_config, "PE_manager", "A_row_ptr_buffer_size", 128u);
@@ -481,6 +527,7 @@ void PE_Manager::write_data() {
     if (!PEs[i].cur_task.valid()) continue;
     // set initial write address
     if (PEs[i].write_address == invalid_address) {
+      active = true;
       if (PEs[i].cur_task.C_partial_fiber) {
 	PEs[i].write_address = PEs[i].cur_task.C_partial_fiber->begin;
       } else {
@@ -497,6 +544,7 @@ void PE_Manager::write_data() {
       if (PEs[i].num_bytes_write < num_bytes_write) continue;
       Mem_Request req{.address = PEs[i].write_address, .is_write = true};
       cache_write_ports[i].add_msg_send(req);
+      active = true;
       PEs[i].write_address += num_bytes_write;
       PEs[i].num_bytes_write -= num_bytes_write;
       PEs[i].cur_task.C_partial_fiber->end += num_bytes_write;
@@ -510,7 +558,8 @@ void PE_Manager::write_data() {
       if (PEs[i].num_bytes_write < num_bytes_write) continue;
       Mem_Request req{.address = PEs[i].write_address, .is_write = true};
       mem_write_ports[i].add_msg_send(req);
-      ++PE::C_writes;
+      active = true;
+      ++context.C_writes;
       PEs[i].write_address += num_bytes_write;
       PEs[i].num_bytes_write -= num_bytes_write;
     }
@@ -526,7 +575,7 @@ void PE_Manager::write_data() {
 	}
 	for (auto& buffer : PEs[i].input_buffers) {
 	  assert(buffer.num_elems_fetched_cur_task == 0);
-	  buffer.num_elems_fetched_cur_task = buffer.col_idx.size();
+	  buffer.num_elems_fetched_cur_task = buffer.data.size();
 	}
 	PEs[i].cur_task_finished = false;
       } else {
@@ -543,10 +592,12 @@ void PE_Manager::allocate_tasks() {
     if (!pe.cur_task.valid()) {
       pe.cur_task = get_new_task();
       if (!pe.cur_task.valid()) return;
+      active = true;
     }
   }
   for (auto& pe : PEs) {
     if (pe.next_task.valid()) {
+      active = true;
       pe.next_task = get_new_task();
       if (!pe.next_task.valid()) return;
     }
@@ -562,7 +613,7 @@ Task PE_Manager::get_new_task() {
     const unsigned A_row_idx = A_row_idx_fetcher.front();
     const unsigned C_row_ptr = C_row_ptr_fetcher.front();
     const unsigned num_rows_merge = A_row_ptr_fetcher.at(1) - A_row_ptr_fetcher.front();
-    if (num_rows_merge <= PE::radix) {
+    if (num_rows_merge <= context.radix) {
       if (A_values_fetcher.num_elements < num_rows_merge || B_row_ptr_end_fetcher.num_elements < num_rows_merge) {
 	return Task{};
       }
@@ -580,7 +631,8 @@ Task PE_Manager::get_new_task() {
       A_row_ptr_fetcher.pop();
       A_row_idx_fetcher.pop();
       C_row_ptr_fetcher.pop();
-      task_tree.init(num_rows_merge, A_row_idx, C_row_ptr);
+      active = true;
+      task_tree.init(num_rows_merge, context.radix, A_row_idx, C_row_ptr);
     }
   }
   assert(task_tree.valid());
@@ -588,10 +640,10 @@ Task PE_Manager::get_new_task() {
   const auto last_level = task_tree.num_C_partials_level.size() - 1;
   if (task_tree.tree_level == 0) {
     assert(task_tree.B_rows_first_level > 0);
-    if (C_Partial_Fiber::num_fibers == C_partial_fibers.size()) {
+    if (context.num_C_partial_fibers == C_partial_fibers.size()) {
       return Task{};
     }
-    unsigned B_rows_merge = std::min(task_tree.B_rows_first_level, PE::radix);
+    unsigned B_rows_merge = std::min(task_tree.B_rows_first_level, context.radix);
     if (A_values_fetcher.num_elements < B_rows_merge || B_row_ptr_end_fetcher.num_elements < B_rows_merge) {
       return Task{};
     }
@@ -606,14 +658,14 @@ Task PE_Manager::get_new_task() {
       task.inputs.push_back(get_B_input_fiber());
     }
     ++task_tree.num_C_partials_level[0];
-    if (task_tree.num_C_partials_level[0] == PE::radix || task_tree.B_rows_first_level == 0) {
+    if (task_tree.num_C_partials_level[0] == context.radix || task_tree.B_rows_first_level == 0) {
       task_tree.tree_level = 1;
     }
     return task;
   }
   if (task_tree.tree_level == 1) {
     if (task_tree.tree_level == last_level) {
-      assert(task_tree.B_rows_second_level + task_tree.num_C_partials_level[0] == PE::radix);
+      assert(task_tree.B_rows_second_level + task_tree.num_C_partials_level[0] == context.radix);
       if (A_values_fetcher.num_elements < task_tree.B_rows_second_level || B_row_ptr_end_fetcher.num_elements < task_tree.B_rows_second_level) {
 	return Task{};
       }
@@ -630,17 +682,17 @@ Task PE_Manager::get_new_task() {
       task_tree.reset();
       return task;
     }
-    if (C_Partial_Fiber::num_fibers == C_partial_fibers.size()) {
+    if (context.num_C_partial_fibers == C_partial_fibers.size()) {
       return Task{};
     }
-    const unsigned B_rows_merge = PE::radix - task_tree.num_C_partials_level[0];
+    const unsigned B_rows_merge = context.radix - task_tree.num_C_partials_level[0];
     if (A_values_fetcher.num_elements < B_rows_merge || B_row_ptr_end_fetcher.num_elements < B_rows_merge) {
       return Task{};
     }
     const auto C_partial_ptr = get_C_partial_ptr();
     assert(C_partial_ptr != nullptr);
-    assert(task_tree.C_partial_fibers[PE::radix + task_tree.num_C_partials_level[1]] == nullptr);
-    task_tree.C_partial_fibers[PE::radix + task_tree.num_C_partials_level[1]] = C_partial_ptr;
+    assert(task_tree.C_partial_fibers[context.radix + task_tree.num_C_partials_level[1]] == nullptr);
+    task_tree.C_partial_fibers[context.radix + task_tree.num_C_partials_level[1]] = C_partial_ptr;
     Task task;
     task.C_partial_fiber = C_partial_ptr;
     for (unsigned i = 0; i < task_tree.num_C_partials_level[0]; ++i) {
@@ -652,7 +704,7 @@ Task PE_Manager::get_new_task() {
     }
     task_tree.num_C_partials_level[0] = 0;
     ++task_tree.num_C_partials_level[1];
-    if (task_tree.num_C_partials_level[1] == PE::radix) {
+    if (task_tree.num_C_partials_level[1] == context.radix) {
       ++task_tree.tree_level;
     } else if (task_tree.B_rows_first_level > 0) {
       task_tree.tree_level = 0;
@@ -660,25 +712,25 @@ Task PE_Manager::get_new_task() {
     return task;
   }
   if (task_tree.tree_level < last_level) {
-    assert(task_tree.num_C_partials_level[task_tree.tree_level-1] == PE::radix);
-    if (C_Partial_Fiber::num_fibers == C_partial_fibers.size()) {
+    assert(task_tree.num_C_partials_level[task_tree.tree_level-1] == context.radix);
+    if (context.num_C_partial_fibers == C_partial_fibers.size()) {
       return Task{};
     }
     const auto C_partial_ptr = get_C_partial_ptr();
-    const auto idx = PE::radix * task_tree.tree_level + task_tree.num_C_partials_level[task_tree.tree_level];
+    const auto idx = context.radix * task_tree.tree_level + task_tree.num_C_partials_level[task_tree.tree_level];
     assert(C_partial_ptr != nullptr);
     assert(task_tree.C_partial_fibers[idx] == nullptr);
     task_tree.C_partial_fibers[idx] = C_partial_ptr;
     Task task;
     task.C_partial_fiber = C_partial_ptr;
-    for (unsigned i = 0; i < PE::radix; ++i) {
-      auto& C_partial = task_tree.C_partial_fibers[(task_tree.tree_level-1) * PE::radix + i];
+    for (unsigned i = 0; i < context.radix; ++i) {
+      auto& C_partial = task_tree.C_partial_fibers[(task_tree.tree_level-1) * context.radix + i];
       task.inputs.push_back(Input_Fiber{ .A_value = 1.0, .C_partial_fiber = C_partial });
       C_partial = nullptr;
     }
     task_tree.num_C_partials_level[task_tree.tree_level-1] = 0;
     ++task_tree.num_C_partials_level[task_tree.tree_level];
-    if (task_tree.num_C_partials_level[task_tree.tree_level] == PE::radix) {
+    if (task_tree.num_C_partials_level[task_tree.tree_level] == context.radix) {
       ++task_tree.tree_level;
     } else if (task_tree.B_rows_first_level > 0) {
       task_tree.tree_level = 0;
@@ -688,12 +740,12 @@ Task PE_Manager::get_new_task() {
     return task;
   }
   // last level
-  assert(task_tree.num_C_partials_level[task_tree.tree_level - 1] == PE::radix);
+  assert(task_tree.num_C_partials_level[task_tree.tree_level - 1] == context.radix);
   Task task;
   task.C_row_idx = task_tree.C_row_idx;
   task.C_row_ptr = task_tree.C_row_ptr;
-  for (unsigned i = 0; i < PE::radix; ++i) {
-    auto& C_partial = task_tree.C_partial_fibers[(task_tree.tree_level - 1) * PE::radix + i];
+  for (unsigned i = 0; i < context.radix; ++i) {
+    auto& C_partial = task_tree.C_partial_fibers[(task_tree.tree_level - 1) * context.radix + i];
     task.inputs.push_back(Input_Fiber{ .A_value = 1.0, .C_partial_fiber = C_partial });
     C_partial = nullptr;
   }
@@ -719,7 +771,7 @@ C_Partial_Fiber* PE_Manager::get_C_partial_ptr() {
       C_partial_fibers[i].begin = matrix_data.C_partials_base_addr + i * C_region_size;
       C_partial_fibers[i].end = C_partial_fibers[i].begin;
       C_partial_fibers[i].finished = false;
-      ++C_Partial_Fiber::num_fibers;
+      ++context.num_C_partial_fibers;
       return &C_partial_fibers[i];
     }
   }
@@ -2,8 +2,10 @@
 #define MERGEFOREST_SIM_GAMMA_PE_MANAGER_HPP
 
 #include <mergeforest-sim/array_fetcher.hpp>
+#include <mergeforest-sim/fiber_queue.hpp>
 #include <mergeforest-sim/matrix_data.hpp>
 #include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/time_series.hpp>
 
 #include <toml.hpp>
 
@@ -14,14 +16,34 @@ namespace mergeforest_sim {
 
 namespace gamma {
 
+// config and stats shared by the PEs of a PE_Manager
+struct PE_Context {
+  //config params
+  unsigned radix {};
+  std::size_t input_buffer_size {};
+  unsigned output_buffer_size {};
+  // number of allocated C partial fibers
+  unsigned num_C_partial_fibers {};
+  // stats
+  std::size_t num_mults {};
+  std::size_t num_adds {};
+  std::size_t num_finished_rows {};
+  std::size_t num_C_partial_rows {};
+  std::size_t num_C_partial_elements {};
+  std::size_t idle_cycles {};
+  std::size_t B_data_stalls {};
+  std::size_t write_stalls {};
+  std::size_t C_writes {};
+  unsigned max_bytes_write {};
+};
+
 struct C_Partial_Fiber {
   bool empty() const;
   bool is_finished() const;
-  
-  inline static unsigned num_fibers;
+  // frees the fiber, keeping the storage of its elements
+  void clear();
 
-  std::deque<uint32_t> col_idx;
-  std::deque<double> values;
+  Fiber_Queue data;
   Address begin {invalid_address};
   Address end {invalid_address};
   bool finished {};
@@ -45,35 +67,22 @@ struct Task {
 };
 
 struct Input_Buffer {
-  inline static std::size_t buffer_size;
   std::size_t num_elements_received {};
   std::size_t num_elems_fetched_cur_task {};
   std::deque<std::tuple<Address, unsigned, bool>> pending_reqs;
-  std::deque<uint32_t> col_idx;
-  std::deque<double> values;
+  Fiber_Queue data;
 };
 
 struct PE {
-  PE(Matrix_Data& matrix_data_);
+  PE(Matrix_Data& matrix_data_, PE_Context& context_);
   void reset();
   Mem_Request get_cache_request();
   void receive_cache_response(Mem_Response mem_response);
-  void update();
-  //config params
-  inline static unsigned radix;
-  inline static unsigned output_buffer_size;
-  // stats
-  inline static std::size_t num_mults;
-  inline static std::size_t num_adds;
-  inline static std::size_t num_finished_rows;
-  inline static std::size_t num_C_partial_rows;
-  inline static std::size_t num_C_partial_elements;
-  inline static std::size_t idle_cycles;
-  inline static std::size_t B_data_stalls;
-  inline static std::size_t write_stalls;
-  inline static std::size_t C_writes;
-  inline static unsigned max_bytes_write;
+  // returns false if the PE only stalled
+  template<bool compute_result>
+  bool update();
   Matrix_Data& matrix_data;
+  PE_Context& context;
   
   Task cur_task;
   Task next_task;
@@ -88,7 +97,7 @@ struct PE {
 
 struct Task_Tree {
   void reset();
-  void init(unsigned num_rows, unsigned C_row_idx_, unsigned C_row_ptr_);
+  void init(unsigned num_rows, unsigned radix, unsigned C_row_idx_, unsigned C_row_ptr_);
   bool valid() const;
   
   unsigned tree_level {};
@@ -106,6 +115,11 @@ public:
   using Prefetch_Port = Port<std::size_t, Empty_Msg>;
   
   PE_Manager(const toml::value& parsed_config, Matrix_Data& matrix_data_); 
+  // the PEs refer to the context of their manager
+  PE_Manager(const PE_Manager&) = delete;
+  PE_Manager& operator=(const PE_Manager&) = delete;
+  PE_Manager(PE_Manager&&) = delete;
+  PE_Manager& operator=(PE_Manager&&) = delete;
   void reset();
   void update();
   void apply();
@@ -115,8 +129,13 @@ public:
   Mem_Port* get_cache_write_port(std::size_t id);
   Prefetch_Port* get_prefetch_port();
   bool finished() const;
+  // true if the last cycle only updated the stall stats
+  bool idle() const;
+  void skip_cycles(std::size_t num_cycles);
+  void add_time_series_columns(Time_Series_Writer& time_series) const;
   // stats
   std::size_t preproc_A_reads {};
+  PE_Context context;
 private:
   void get_config_params(const toml::value& parsed_config);
   void write_data();
@@ -144,6 +163,11 @@ private:
   std::vector<PE> PEs;
   std::vector<C_Partial_Fiber> C_partial_fibers;
   Task_Tree task_tree; 
+  bool active {};
+  // stall stats at the start of the cycle
+  std::size_t cycle_idle_cycles {};
+  std::size_t cycle_B_data_stalls {};
+  std::size_t cycle_write_stalls {};
   // config parameters
   std::size_t prefetched_rows_per_cycle {};
 }; 
@@ -1,6 +1,9 @@
 #include <mergeforest-sim/gamma/fiber_cache.hpp>
 #include <mergeforest-sim/math_utils.hpp>
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -32,9 +35,14 @@ void Fiber_Cache::reset() {
   std::ranges::fill(cache_lines, Cache_Line{});
   pending_reqs.clear();
   for (auto& i : finished_reqs) { i.clear(); }
+  // the B rows are known after preprocessing the matrices
+  if (policy == Replacement_Policy::oracle) { compute_next_uses(); }
+  block_ref_idx = 0;
+  access_clock = 0;
   num_B_blocks = 0;
   num_C_partial_blocks = 0;
   cycles = 0;
+  active = false;
   B_data_reads = 0;
   C_partial_reads = 0;
   C_partial_writes = 0;
@@ -49,13 +57,29 @@ void Fiber_Cache::reset() {
   #endif
 }
 
+void Fiber_Cache::warm_up(const std::vector<std::pair<uint32_t, uint32_t>>& B_row_ptr_end) {
+  for (auto [B_row_ptr, B_row_end] : B_row_ptr_end) {
+    B_row_ptr = round_down_multiple(B_row_ptr, block_size);
+    for (; B_row_ptr < B_row_end; B_row_ptr += block_size) {
+      const Address addr = matrix_data.B_elements_addr + B_row_ptr * element_size;
+      if (cache_search(addr) != UINT_MAX) continue;
+      // inserted for its use and left without uses, as after a prefetch
+      cache_insert(addr, 1, false);
+      const auto idx = cache_search(addr);
+      if (idx != UINT_MAX) { cache_lines[idx].num_uses = 0; }
+    }
+  }
+}
+
 void Fiber_Cache::update() {
+  active = false;
   // send read responses
   for (unsigned i = 0; i < read_ports.size(); ++i) {
     if (read_ports[i].has_msg_send()) continue;
     if (finished_reqs[i].empty()) continue;
     read_ports[i].add_msg_send(finished_reqs[i].front());
     finished_reqs[i].pop_front();
+    active = true;
   }
   // Send memory requests with bank misses having priority over prefetch 
   for (auto& p : mem_ports) {
@@ -65,6 +89,7 @@ void Fiber_Cache::update() {
       if (banks[mem_arbiter].mem_reqs.empty()) continue;
       p.add_msg_send(banks[mem_arbiter].mem_reqs.front());
       banks[mem_arbiter].mem_reqs.pop_front();
+      active = true;
       break;
     }
     if (p.has_msg_send()) continue;
@@ -72,12 +97,13 @@ void Fiber_Cache::update() {
     if (prefetch_reqs.empty()) continue;
     p.add_msg_send(prefetch_reqs.front());
     prefetch_reqs.pop_front();
+    active = true;
   }
   for (auto& p : read_ports) {
-    p.transfer();
+    if (p.transfer()) { active = true; }
   }
   for (auto& p : mem_ports) {
-    p.transfer();
+    if (p.transfer()) { active = true; }
   }
   cycles = inc_mod(cycles, sample_interval);
   if (cycles == 0) {
@@ -96,6 +122,19 @@ bool Fiber_Cache::inactive() {
   return true;
 }
 
+bool Fiber_Cache::idle() const {
+  return !active;
+}
+
+void Fiber_Cache::skip_cycles(std::size_t num_cycles) {
+  // the sampled values don't change in idle cycles
+  const auto num_skipped_samples = (cycles + num_cycles) / sample_interval;
+  for (std::size_t i = 0; i < num_skipped_samples; ++i) {
+    sample_cache_utilization();
+  }
+  cycles = static_cast<unsigned>((cycles + num_cycles) % sample_interval);
+}
+
 Fiber_Cache::Mem_Port* Fiber_Cache::get_mem_port(std::size_t id) {
   if (id >= mem_ports.size()) return nullptr;
   return &mem_ports[id];
@@ -115,6 +154,28 @@ Fiber_Cache::Prefetch_Port* Fiber_Cache::get_prefetch_port() {
   return &prefetch_port;
 }
 
+void Fiber_Cache::add_time_series_columns(Time_Series_Writer& time_series) const {
+  time_series.add_counter("cache_reads", &reads);
+  time_series.add_counter("cache_writes", &writes);
+  time_series.add_counter("cache_read_hits", &read_hits);
+  // in memory transactions, as in the stats
+  time_series.add_counter("B_data_reads", &B_data_reads, transactions_per_request);
+  time_series.add_counter("C_partial_reads", &C_partial_reads, transactions_per_request);
+  time_series.add_counter("C_partial_writes", &C_partial_writes, transactions_per_request);
+  time_series.add_gauge("B_blocks", &num_B_blocks);
+  time_series.add_gauge("C_partial_blocks", &num_C_partial_blocks);
+}
+
+std::string_view Fiber_Cache::policy_name() const {
+  switch (policy) {
+  case Replacement_Policy::uses: return "uses";
+  case Replacement_Policy::lru: return "lru";
+  case Replacement_Policy::srrip: return "srrip";
+  case Replacement_Policy::oracle: return "oracle";
+  }
+  return "";
+}
+
 void Fiber_Cache::get_config_params(const toml::value& parsed_config) {
   const auto num_mem_ports = toml::find<std::size_t>(parsed_config, "fiber_cache", "num_mem_ports");
   mem_ports = std::vector<Mem_Port>(num_mem_ports);
@@ -124,10 +185,52 @@ void Fiber_Cache::get_config_params(const toml::value& parsed_config) {
   finished_reqs = std::vector<std::deque<Mem_Response>>(num_slave_ports);
   num_blocks = toml::find<std::size_t>(parsed_config, "fiber_cache", "size") / block_size_bytes;
   cache_lines = std::vector<Cache_Line>(num_blocks);
+  // the table grows if more blocks are pending
+  pending_reqs.reserve(std::min<std::size_t>(num_blocks, 4096));
   const auto num_banks = toml::find<std::size_t>(parsed_config, "fiber_cache", "num_banks"); 
   banks = std::vector<Bank>(num_banks);
   assoc = toml::find<unsigned>(parsed_config, "fiber_cache", "assoc");
   sample_interval = toml::find_or(parsed_config, "fiber_cache", "sample_interval", 10000U);
+  const auto policy_str = toml::find_or<std::string>(parsed_config, "fiber_cache", "policy", "uses");
+  if (policy_str == "uses") {
+    policy = Replacement_Policy::uses;
+  } else if (policy_str == "lru") {
+    policy = Replacement_Policy::lru;
+  } else if (policy_str == "srrip") {
+    policy = Replacement_Policy::srrip;
+  } else if (policy_str == "oracle") {
+    policy = Replacement_Policy::oracle;
+  } else {
+    throw std::runtime_error("Unknown fiber cache policy " + policy_str + "\n");
+  }
+}
+
+void Fiber_Cache::compute_next_uses() {
+  const auto& B_rows = matrix_data.preproc_B_row_ptr_end;
+  std::size_t num_block_refs = 0;
+  for (const auto& [B_row_ptr, B_row_end] : B_rows) {
+    num_block_refs += (round_up_multiple(B_row_end, block_size)
+                       - round_down_multiple(B_row_ptr, block_size)) / block_size;
+  }
+  block_next_uses.assign(num_block_refs, UINT32_MAX);
+  // walks the blocks backwards, next_block_uses ends with their first use
+  next_block_uses.clear();
+  auto ref = num_block_refs;
+  for (auto i = B_rows.size(); i-- > 0;) {
+    const auto begin = round_down_multiple(B_rows[i].first, block_size);
+    for (auto ptr = round_up_multiple(B_rows[i].second, block_size); ptr > begin;) {
+      ptr -= block_size;
+      --ref;
+      const Address addr = matrix_data.B_elements_addr + ptr * element_size;
+      if (auto* next = next_block_uses.find(addr)) {
+        block_next_uses[ref] = *next;
+        *next = static_cast<uint32_t>(i);
+      } else {
+        next_block_uses.insert(addr, static_cast<uint32_t>(i));
+      }
+    }
+  }
+  assert(ref == 0);
 }
 
 void Fiber_Cache::receive_mem_responses() {
@@ -136,17 +239,18 @@ void Fiber_Cache::receive_mem_responses() {
     const auto response = p.get_msg_received();
     const auto addr = round_down_multiple(response.address, static_cast<Address>(block_size_bytes));
     p.clear_msg_received();
-    auto it = pending_reqs.find(addr);
-    assert(it != pending_reqs.end());
-    ++it->second.num_arrived_reqs;
-    if (it->second.num_arrived_reqs == 3) {
-      for (auto& i : it->second.dest_ids) {
+    active = true;
+    auto* pending_read = pending_reqs.find(addr);
+    assert(pending_read != nullptr);
+    ++pending_read->num_arrived_reqs;
+    if (pending_read->num_arrived_reqs == 3) {
+      for (auto& i : pending_read->dest_ids) {
 	finished_reqs[i.first].push_back(Mem_Response{.address = addr, .id = i.second});
       }
-      if (!it->second.C_partial) {
-	cache_insert(addr, it->second.num_uses, false);
+      if (!pending_read->C_partial) {
+	cache_insert(addr, pending_read->num_uses, false);
       }
-      pending_reqs.erase(it);
+      pending_reqs.erase(addr);
     } 
   }
 }
@@ -162,6 +266,7 @@ void Fiber_Cache::receive_read_requests() {
       if (address_to_bank(req.address) != i) continue;
       process_read_request(p);
       ++reads;
+      active = true;
       read_ports[p].clear_msg_received();
     }
   }
@@ -191,20 +296,20 @@ void Fiber_Cache::process_read_request(std::size_t port) {
       assert(req.address >= matrix_data.C_partials_base_addr);
       cache_lines[idx] = Cache_Line{};
       --num_C_partial_blocks;
-    } else if (cache_lines[idx].num_uses > 0) {
-      --cache_lines[idx].num_uses;
+    } else {
+      if (cache_lines[idx].num_uses > 0) { --cache_lines[idx].num_uses; }
+      update_rank_on_hit(cache_lines[idx]);
     }
     finished_reqs[port].push_back(Mem_Response{ .address = req.address, .id = req.id });
     ++read_hits;
     return;
   }
-  auto it = pending_reqs.find(req.address);
-  if (it != pending_reqs.end()) {
-    it->second.dest_ids.emplace_back(port, req.id);
-    if (it->second.num_uses > 0) --it->second.num_uses;
+  if (auto* pending_read = pending_reqs.find(req.address)) {
+    pending_read->dest_ids.emplace_back(port, req.id);
+    if (pending_read->num_uses > 0) --pending_read->num_uses;
     return;
   }
-  Pending_Read pending_read;
+  auto& pending_read = pending_reqs[req.address];
   pending_read.dest_ids.emplace_back(port, req.id);
   if (req.address >= matrix_data.C_partials_base_addr) {
     pending_read.C_partial = true;
@@ -212,7 +317,6 @@ void Fiber_Cache::process_read_request(std::size_t port) {
   } else {
     ++B_data_reads;
   }
-  pending_reqs.emplace(req.address, pending_read);
   for (unsigned k = 0; k < 3; ++k) {
     const auto b = address_to_bank(req.address);
     banks[b].mem_reqs.push_back(Mem_Request{ .address = req.address, .is_write = false });
@@ -235,6 +339,7 @@ void Fiber_Cache::receive_write_requests() {
       cache_insert(req.address, 1, true);
       write_ports[p].clear_msg_received();
       ++writes;
+      active = true;
       break;
     }
   }
@@ -244,6 +349,7 @@ void Fiber_Cache::receive_prefetch_data() {
   if (!prefetch_port.msg_received_valid()) return;
   auto prefetch_num_elements = prefetch_port.get_msg_received();
   prefetch_port.clear_msg_received();
+  if (prefetch_num_elements > 0) { active = true; }
   while (prefetch_num_elements > 0) {
     auto [B_row_ptr, B_row_end] = matrix_data.preproc_B_row_ptr_end[prefetch_idx];
     ++prefetch_idx;
@@ -255,19 +361,20 @@ void Fiber_Cache::receive_prefetch_data() {
     while (B_row_ptr < B_row_end) {
       Address addr = matrix_data.B_elements_addr + B_row_ptr * element_size;
       B_row_ptr += block_size;
+      if (policy == Replacement_Policy::oracle) {
+        next_block_uses.insert(addr, block_next_uses[block_ref_idx]);
+        ++block_ref_idx;
+      }
       const auto cache_idx = cache_search(addr);
       if (cache_idx != UINT_MAX) {
 	++cache_lines[cache_idx].num_uses;
 	continue;
       }
-      const auto it = pending_reqs.find(addr);
-      if (it != pending_reqs.end()) {
-	++it->second.num_uses;
+      if (auto* pending_read = pending_reqs.find(addr)) {
+	++pending_read->num_uses;
 	continue;
       }
-      Pending_Read pending_read;
-      pending_read.num_uses = 1;
-      pending_reqs.emplace(addr, pending_read);
+      pending_reqs[addr].num_uses = 1;
       for (unsigned i = 0; i < 3; ++i) {
 	prefetch_reqs.push_back(Mem_Request{.address = addr, .is_write = false});
 	addr += mem_transaction_size;
@@ -289,14 +396,13 @@ std::size_t Fiber_Cache::cache_search(Address address) {
 
 void Fiber_Cache::cache_insert(Address address, unsigned num_uses, bool C_partial) {
   const auto index = (address / block_size_bytes) % (cache_lines.size() / assoc);
-  unsigned min_num_uses = UINT_MAX;
-  std::size_t min_idx = 0;
   for (unsigned i = 0; i < assoc; ++i) {
     const auto idx = index * assoc + i;
     if (!cache_lines[idx].valid()) {
       cache_lines[idx].address = address;
       cache_lines[idx].num_uses = num_uses;
       cache_lines[idx].C_partial = C_partial;
+      cache_lines[idx].rank = insertion_rank();
       if (C_partial) {
         ++num_C_partial_blocks;
       } else {
@@ -304,14 +410,11 @@ void Fiber_Cache::cache_insert(Address address, unsigned num_uses, bool C_partia
       }
       return;
     }
-    if (min_num_uses > cache_lines[idx].num_uses) {
-      min_num_uses = cache_lines[idx].num_uses;
-      min_idx = idx;
-    }
   }
-  if (num_uses > min_num_uses || (C_partial && min_num_uses <= 1)) {
-    if (cache_lines[min_idx].C_partial) {
-      cache_evict(cache_lines[min_idx].address);
+  auto& victim = cache_lines[find_victim(index)];
+  if (replaces(victim, address, num_uses, C_partial)) {
+    if (victim.C_partial) {
+      cache_evict(victim.address);
       if (!C_partial) {
         ++num_B_blocks;
         --num_C_partial_blocks;
@@ -320,14 +423,95 @@ void Fiber_Cache::cache_insert(Address address, unsigned num_uses, bool C_partia
       ++num_C_partial_blocks;
       --num_B_blocks;
     }
-    cache_lines[min_idx].address = address;
-    cache_lines[min_idx].num_uses = num_uses;
-    cache_lines[min_idx].C_partial = C_partial;
+    victim.address = address;
+    victim.num_uses = num_uses;
+    victim.C_partial = C_partial;
+    victim.rank = insertion_rank();
   } else if (C_partial) {
     cache_evict(address);
   }
 }
 
+std::size_t Fiber_Cache::find_victim(std::size_t index) {
+  const auto begin = index * assoc;
+  const auto end = begin + assoc;
+  std::size_t victim = begin;
+  switch (policy) {
+  case Replacement_Policy::uses:
+    for (auto idx = begin + 1; idx < end; ++idx) {
+      if (cache_lines[idx].num_uses < cache_lines[victim].num_uses) { victim = idx; }
+    }
+    break;
+  case Replacement_Policy::lru:
+    for (auto idx = begin + 1; idx < end; ++idx) {
+      if (cache_lines[idx].rank < cache_lines[victim].rank) { victim = idx; }
+    }
+    break;
+  case Replacement_Policy::srrip:
+    // ages the set until a line is predicted to be re-referenced last
+    while (true) {
+      for (auto idx = begin; idx < end; ++idx) {
+        if (cache_lines[idx].rank >= srrip_max_rrpv) { return idx; }
+      }
+      for (auto idx = begin; idx < end; ++idx) { ++cache_lines[idx].rank; }
+    }
+  case Replacement_Policy::oracle: {
+    // the fewest pending uses first, as with uses, and then the line used
+    // furthest in the future
+    auto victim_next_use = next_use(cache_lines[begin].address);
+    for (auto idx = begin + 1; idx < end; ++idx) {
+      const auto& line = cache_lines[idx];
+      if (line.num_uses > cache_lines[victim].num_uses) continue;
+      const auto line_next_use = next_use(line.address);
+      if (line.num_uses < cache_lines[victim].num_uses
+          || (line.num_uses == 0 && line_next_use > victim_next_use)) {
+        victim = idx;
+        victim_next_use = line_next_use;
+      }
+    }
+    break;
+  }
+  }
+  return victim;
+}
+
+bool Fiber_Cache::replaces(const Cache_Line& victim, Address address, unsigned num_uses,
+                           bool C_partial) const
+{
+  switch (policy) {
+  case Replacement_Policy::oracle:
+    if (num_uses == 0 && !C_partial && victim.num_uses == 0) {
+      return next_use(address) < next_use(victim.address);
+    }
+    [[fallthrough]];
+  case Replacement_Policy::uses:
+    return num_uses > victim.num_uses || (C_partial && victim.num_uses <= 1);
+  default:
+    return true;
+  }
+}
+
+std::size_t Fiber_Cache::insertion_rank() {
+  switch (policy) {
+  case Replacement_Policy::lru: return ++access_clock;
+  case Replacement_Policy::srrip: return srrip_max_rrpv - 1;
+  default: return 0;
+  }
+}
+
+void Fiber_Cache::update_rank_on_hit(Cache_Line& line) {
+  if (policy == Replacement_Policy::lru) {
+    line.rank = ++access_clock;
+  } else if (policy == Replacement_Policy::srrip) {
+    line.rank = 0;
+  }
+}
+
+uint32_t Fiber_Cache::next_use(Address address) const {
+  const auto* next = next_block_uses.find(address);
+  return next == nullptr ? UINT32_MAX : *next;
+}
+
 void Fiber_Cache::cache_evict(Address address) {
   const auto bank = address_to_bank(address);
   for (unsigned i = 0; i < 3; ++i) {
@@ -3,22 +3,28 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <mergeforest-sim/flat_map.hpp>
 #include <mergeforest-sim/matrix_data.hpp>
 #include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/small_vector.hpp>
+#include <mergeforest-sim/time_series.hpp>
 
 #include <toml.hpp>
 
 #include <unordered_set>
+#include <string_view>
 #include <vector>
 #include <deque>
-#include <unordered_map>
+#include <utility>
 
 namespace mergeforest_sim {
 
+struct Benchmark_Access;
+
 namespace gamma {
 
 struct Pending_Read {
-  std::vector<std::pair<std::size_t, unsigned>> dest_ids;
+  Small_Vector<std::pair<std::size_t, unsigned>, 4> dest_ids;
   unsigned num_arrived_reqs {};
   unsigned num_uses {};
   bool C_partial {false};
@@ -30,33 +36,61 @@ struct Bank {
   std::size_t write_arbiter {UINT64_MAX};
 };
 
+// replacement policies of the fiber cache:
+// - uses: replaces the line with the fewest pending uses of the prefetched
+//   rows, and bypasses the blocks with fewer uses than it
+// - lru: replaces the least recently read line
+// - srrip: static re-reference interval prediction with 2 bit counters
+// - oracle: as uses, but the lines without pending uses are replaced in the
+//   order of their next use, known from the order of the prefetched rows, and
+//   the blocks used after them are bypassed
+enum class Replacement_Policy { uses, lru, srrip, oracle };
+
+inline constexpr unsigned srrip_max_rrpv = 3;
+
 struct Cache_Line {
   bool valid() const;
   
   Address address {invalid_address};
   unsigned num_uses {};
   bool C_partial {false};
+  // last read with lru, re-reference prediction value with srrip
+  std::size_t rank {};
 };
 
 class Fiber_Cache {
 public:
+  friend Benchmark_Access;
+
   using Mem_Port = Port<Mem_Request, Mem_Response>;
   using Slave_Port = Port<Mem_Response, Mem_Request>;
   using Prefetch_Port = Port<Empty_Msg, std::size_t>;
 
   Fiber_Cache(const toml::value& parsed_config, const Matrix_Data& matrix_data_);
   void reset();
+  // fills the cache with the blocks of the B rows as if they had been
+  // prefetched and used in this order, without timing nor stats
+  void warm_up(const std::vector<std::pair<uint32_t, uint32_t>>& B_row_ptr_end);
   void update();
   void apply();
   bool inactive();
+  // true if the last cycle didn't change the state of the cache
+  bool idle() const;
+  void skip_cycles(std::size_t num_cycles);
   Mem_Port* get_mem_port(std::size_t id);
   Slave_Port* get_read_port(std::size_t id);
   Slave_Port* get_write_port(std::size_t id);
   Prefetch_Port* get_prefetch_port();
+  void add_time_series_columns(Time_Series_Writer& time_series) const;
+  std::string_view policy_name() const;
   // config params
   std::size_t num_blocks {};
   unsigned assoc {};
   unsigned sample_interval {};
+  Replacement_Policy policy {Replacement_Policy::uses};
+  // the memory requests of B data and C partials move a whole block, and are
+  // counted as this many memory transactions in the stats
+  static constexpr std::size_t transactions_per_request = block_size_bytes / mem_transaction_size;
   // stats
   std::size_t B_data_reads {};
   std::size_t C_partial_reads {};
@@ -79,6 +113,15 @@ private:
   void receive_prefetch_data();
   std::size_t cache_search(Address address);
   void cache_insert(Address address, unsigned num_uses, bool C_partial);
+  std::size_t find_victim(std::size_t index);
+  bool replaces(const Cache_Line& victim, Address address, unsigned num_uses,
+                bool C_partial) const;
+  std::size_t insertion_rank();
+  void update_rank_on_hit(Cache_Line& line);
+  // index of the first row not prefetched yet that uses the block, only with
+  // the oracle policy
+  uint32_t next_use(Address address) const;
+  void compute_next_uses();
   void cache_evict(Address address);
   std::size_t address_to_bank(Address address); 
   void sample_cache_utilization();
@@ -95,11 +138,19 @@ private:
   std::deque<Mem_Request> prefetch_reqs;
   std::vector<Bank> banks;
   std::vector<Cache_Line> cache_lines;
-  std::unordered_map<Address, Pending_Read> pending_reqs;
+  Flat_Map<Address, Pending_Read, invalid_address> pending_reqs;
+  // oracle policy: index of the next prefetched row that uses each block
+  // read by the prefetcher, in prefetch order, and the next use of each block
+  // after the last prefetched row
+  std::vector<uint32_t> block_next_uses;
+  std::size_t block_ref_idx {};
+  Flat_Map<Address, uint32_t, invalid_address> next_block_uses;
+  std::size_t access_clock {};
   std::vector<std::deque<Mem_Response>> finished_reqs;
   std::size_t num_B_blocks {};
   std::size_t num_C_partial_blocks {};
   unsigned cycles {};
+  bool active {};
 }; 
 
 } // namespace gamma
@@ -1,10 +1,12 @@
 #include <mergeforest-sim/gamma.hpp>
 #include <mergeforest-sim/math_utils.hpp>
+#include <mergeforest-sim/host_metrics.hpp>
 
 #include <spdlog/spdlog.h>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include <array>
 #include <iostream>
 
 namespace mergeforest_sim {
@@ -38,13 +40,17 @@ Gamma::Gamma(const toml::value& parsed_config_,
     PE_manager.get_cache_read_port(i)->connect(fiber_cache.get_read_port(i));
     PE_manager.get_cache_write_port(i)->connect(fiber_cache.get_write_port(i));
   }
+  main_mem.add_time_series_columns(time_series);
+  PE_manager.add_time_series_columns(time_series);
+  fiber_cache.add_time_series_columns(time_series);
 }
 
 void Gamma::print_progress() {
-  if (gamma::PE::num_mults == 0) {
+  if (!matrix_data.verbose) { return; }
+  if (PE_manager.context.num_mults == 0) {
     fmt::print("progress:   0.00%\r");
   } else {
-    const auto progress = static_cast<double>(gamma::PE::num_mults) /
+    const auto progress = static_cast<double>(PE_manager.context.num_mults) /
       static_cast<double>(matrix_data.num_mults) * 100.0;
     fmt::print("progress: {:6.2f}%\r", progress);
   }
@@ -52,37 +58,77 @@ void Gamma::print_progress() {
 } 
 
 Spmat_Csr Gamma::run_simulation(bool compute_result) {
+  auto& host_metrics = matrix_data.host_metrics;
+  auto start = Host_Clock::now();
   matrix_data.compute_result = compute_result;
   matrix_data.preprocess_mats();
   matrix_data.set_physical_addrs();
+  host_metrics.preprocess_time = elapsed_seconds(start);
+  start = Host_Clock::now();
+  main_mem.set_address_regions(matrix_data.address_regions());
   reset();
-  // simulation loop
+  fiber_cache.warm_up(matrix_data.warmup_B_row_ptr_end);
+  open_time_series(time_series, parsed_config, out_path);
+  if (toml::find_or(parsed_config, "profile_components", false)) {
+    simulation_loop<true>();
+  } else {
+    simulation_loop<false>();
+  }
+  time_series.close(cycles);
+  host_metrics.simulate_time = elapsed_seconds(start);
+  if (matrix_data.verbose) { fmt::print("progress: 100.00%\n"); }
+  fiber_cache.B_data_reads *= gamma::Fiber_Cache::transactions_per_request;
+  fiber_cache.C_partial_reads *= gamma::Fiber_Cache::transactions_per_request;
+  fiber_cache.C_partial_writes *= gamma::Fiber_Cache::transactions_per_request;
+  // a measured window isn't simulated to the end
+  if (!matrix_data.measured.finished()) { check_valid_simulation(); }
+  if (compute_result) {
+    start = Host_Clock::now();
+    matrix_data.spGEMM_check_result();
+    host_metrics.verify_time = elapsed_seconds(start);
+  }
+  if (matrix_data.print_results) { print_stats(); }
+  return compute_result ? matrix_data.C : Spmat_Csr{};
+}
+
+template<bool profile>
+void Gamma::simulation_loop() {
+  const bool fast_forward = toml::find_or(parsed_config, "fast_forward", true);
+  // wall time of the update and apply calls of each component
+  std::array<double, 5> times {};
   for (;;) {
-    PE_manager.update();
-    fiber_cache.update();
-    main_mem.update();
-    fiber_cache.apply();
-    PE_manager.apply();
+    profiled_call<profile>(times[0], [&] { PE_manager.update(); });
+    profiled_call<profile>(times[1], [&] { fiber_cache.update(); });
+    profiled_call<profile>(times[2], [&] { main_mem.update(); });
+    profiled_call<profile>(times[3], [&] { fiber_cache.apply(); });
+    profiled_call<profile>(times[4], [&] { PE_manager.apply(); });
     if (cycles % progress_interval == 0) {
       print_progress();
     }
     ++cycles;
+    time_series.sample(cycles);
+    if (PE_manager.context.num_mults >= matrix_data.measured.next_mults) {
+      matrix_data.measured.record(PE_manager.context.num_mults, {cycles, main_mem.read_requests,
+                                       main_mem.write_requests});
+      // the rows after a measured window only keep the hardware busy
+      if (matrix_data.measured.finished()) { break; }
+    }
     if (PE_manager.finished() && fiber_cache.inactive() && main_mem.inactive()) {
       break;
     }
+    if (fast_forward && PE_manager.idle() && fiber_cache.idle() && main_mem.idle()) {
+      skip_idle_cycles();
+    }
   }
-  fmt::print("progress: 100.00%\n");
-  fiber_cache.B_data_reads *= 3;
-  fiber_cache.C_partial_reads *= 3;
-  fiber_cache.C_partial_writes *= 3;
-  check_valid_simulation();
-  if (compute_result) {
-    matrix_data.spGEMM_check_result();
-    print_stats();
-    return matrix_data.C;
+  auto& component_times = matrix_data.host_metrics.component_times;
+  component_times.clear();
+  if constexpr (profile) {
+    component_times = {{"PE_Manager::update", times[0]},
+                       {"Fiber_Cache::update", times[1]},
+                       {"Main_Memory::update", times[2]},
+                       {"Fiber_Cache::apply", times[3]},
+                       {"PE_Manager::apply", times[4]}};
   }
-  print_stats();
-  return Spmat_Csr{};
 }
 
 void Gamma::reset() {
@@ -92,16 +138,34 @@ void Gamma::reset() {
   cycles = 0;
 }
 
+// A cycle in which no component changed its state is repeated until main
+// memory can answer the oldest pending read, so those cycles are only
+// accounted, not simulated.
+void Gamma::skip_idle_cycles() {
+  const auto num_cycles = main_mem.cycles_to_next_event();
+  if (num_cycles == 0) { return; }
+  PE_manager.skip_cycles(num_cycles);
+  fiber_cache.skip_cycles(num_cycles);
+  main_mem.skip_cycles(num_cycles);
+  if (div_ceil(cycles + num_cycles, progress_interval)
+      != div_ceil(cycles, progress_interval)) {
+    print_progress();
+  }
+  cycles += num_cycles;
+}
+
 void Gamma::check_valid_simulation() {
-  if (matrix_data.num_mults != gamma::PE::num_mults) {
+  if (matrix_data.num_mults != PE_manager.context.num_mults) {
     spdlog::error(R"(Error in simulation: number of multiplications doesn't
       match the expected value\n)");
   }
-  if (gamma::PE::num_mults - gamma::PE::num_adds != matrix_data.C.nnz) {
+  if (PE_manager.context.num_mults - PE_manager.context.num_adds != matrix_data.C.nnz) {
     spdlog::error(R"(Error in simulation: number of multiplications and
       additions doesn'tmatch the nnz of the result\n)");
   }
-  if (fiber_cache.B_data_reads < matrix_data.B_data_min_reads_fiber_cache) {
+  // a warmed up cache may hold B blocks that are then never read
+  if (matrix_data.warmup_B_row_ptr_end.empty()
+      && fiber_cache.B_data_reads < matrix_data.B_data_min_reads_fiber_cache) {
     spdlog::error("Error in simulation: number of B bytes read too small\n");
   }
   if (fiber_cache.B_data_reads > matrix_data.B_data_max_reads_fiber_cache) {
@@ -120,7 +184,7 @@ void Gamma::check_valid_simulation() {
       and fiber cache reads\n)");
   }
   if (main_mem.write_requests !=
-      gamma::PE::C_writes + fiber_cache.C_partial_writes)
+      PE_manager.context.C_writes + fiber_cache.C_partial_writes)
   {
     spdlog::error(R"(Error in simulation: memory reads don't match PE manager
       and fiber cache reads\n)");
@@ -129,15 +193,15 @@ void Gamma::check_valid_simulation() {
 
 void Gamma::print_stats() {
   if (out_path.empty()) {
-    print_stats_impl(std::cout);
+    print_stats(std::cout);
   } else {
     std::ofstream of;
     of.open(out_path.data());
-    print_stats_impl(of);
+    print_stats(of);
   }
 }
 
-void Gamma::print_stats_impl(std::ostream& os) {
+void Gamma::print_stats(std::ostream& os) {
   const double period_ns = toml::find_or(parsed_config, "clock_period_ns", 1.0);
   const auto exec_time_ns = static_cast<double>(cycles) * period_ns;
   const auto exec_time_ms = exec_time_ns * 1e-6;
@@ -145,9 +209,9 @@ void Gamma::print_stats_impl(std::ostream& os) {
   const auto num_PEs = toml::find<std::size_t>(parsed_config,
 					       "PE_manager",
 					       "num_PEs");
-  const auto idle_cycles_ratio = ratio(gamma::PE::idle_cycles, cycles * num_PEs) * 100.0;
-  const auto B_data_stalls_ratio = ratio(gamma::PE::B_data_stalls, cycles * num_PEs) * 100.0;
-  const auto write_stalls_ratio = ratio(gamma::PE::write_stalls, cycles * num_PEs) * 100.0;
+  const auto idle_cycles_ratio = ratio(PE_manager.context.idle_cycles, cycles * num_PEs) * 100.0;
+  const auto B_data_stalls_ratio = ratio(PE_manager.context.B_data_stalls, cycles * num_PEs) * 100.0;
+  const auto write_stalls_ratio = ratio(PE_manager.context.write_stalls, cycles * num_PEs) * 100.0;
 
   const auto mem_traffic = main_mem.read_requests + main_mem.write_requests;
   const auto mem_traffic_bytes = static_cast<double>(mem_traffic * mem_transaction_size);
@@ -182,7 +246,7 @@ void Gamma::print_stats_impl(std::ostream& os) {
 						   mem_bytes_write);
   const auto unused_A_bytes_ratio = unused_bytes_ratio(PE_manager.preproc_A_reads,
 					       preproc_A_bytes_read);
-  const auto unused_C_bytes_ratio = unused_bytes_ratio(gamma::PE::C_writes,
+  const auto unused_C_bytes_ratio = unused_bytes_ratio(PE_manager.context.C_writes,
 					       C_data_bytes_write);
   const auto total_unused_bytes_ratio = unused_bytes_ratio(mem_traffic,
 					     mem_bytes_read + mem_bytes_write);
@@ -198,18 +262,19 @@ void Gamma::print_stats_impl(std::ostream& os) {
   fmt::print(os, "GFlops: {:.4f}\n", Gflops);
   fmt::print(os, "*---Processing Elements---*\n");
   fmt::print(os, "Number flops (mults): {}\n", matrix_data.num_mults);
-  fmt::print(os, "Number adds : {}\n", gamma::PE::num_adds);
-  fmt::print(os, "Idle cycles: {} ({:.4f}%)\n", gamma::PE::idle_cycles,
+  fmt::print(os, "Number adds : {}\n", PE_manager.context.num_adds);
+  fmt::print(os, "Idle cycles: {} ({:.4f}%)\n", PE_manager.context.idle_cycles,
 	     idle_cycles_ratio);
-  fmt::print(os, "B data stalls: {} ({:.4f}%)\n", gamma::PE::B_data_stalls,
+  fmt::print(os, "B data stalls: {} ({:.4f}%)\n", PE_manager.context.B_data_stalls,
 	     B_data_stalls_ratio);
-  fmt::print(os, "Write stalls: {} ({:.4f}%)\n", gamma::PE::write_stalls,
+  fmt::print(os, "Write stalls: {} ({:.4f}%)\n", PE_manager.context.write_stalls,
 	     write_stalls_ratio);
-  fmt::print(os, "C partial rows: {}\n", gamma::PE::num_C_partial_rows);
+  fmt::print(os, "C partial rows: {}\n", PE_manager.context.num_C_partial_rows);
   fmt::print(os, "C partial elements: {}\n",
-	     gamma::PE::num_C_partial_elements);
-  fmt::print(os, "Max bytes write: {}\n", gamma::PE::max_bytes_write);
+	     PE_manager.context.num_C_partial_elements);
+  fmt::print(os, "Max bytes write: {}\n", PE_manager.context.max_bytes_write);
   fmt::print(os, "*---Fiber Cache---*\n");
+  fmt::print(os, "Fiber cache policy: {}\n", fiber_cache.policy_name());
   fmt::print(os, "Fiber cache reads: {}\n", fiber_cache.reads);
   fmt::print(os, "Fiber cache writes: {}\n", fiber_cache.writes);
   fmt::print(os, "Fiber cache read hits: {} ({:.4f}% hit rate)\n",
@@ -248,10 +313,13 @@ void Gamma::print_stats_impl(std::ostream& os) {
 	     fiber_cache.C_partial_reads,
 	     reqs_to_MB(fiber_cache.C_partial_reads));
   fmt::print(os, "C data writes: {} ({:.4f} MB) ({:.4f}% unused)\n",
-	     gamma::PE::C_writes,
-	     reqs_to_MB(gamma::PE::C_writes), unused_C_bytes_ratio);
+	     PE_manager.context.C_writes,
+	     reqs_to_MB(PE_manager.context.C_writes), unused_C_bytes_ratio);
   fmt::print(os, "A data bytes read: {}\n", preproc_A_bytes_read);
   fmt::print(os, "C data bytes written: {}\n", C_data_bytes_write);
+  main_mem.print_dram_stats(os, cycles);
+  matrix_data.print_row_order(os);
+  matrix_data.host_metrics.print(os, cycles);
 }
 
 } // namespace mergeforest_sim
@@ -0,0 +1,49 @@
+#ifndef MERGEFOREST_SIM_HASH_HPP
+#define MERGEFOREST_SIM_HASH_HPP
+
+#include <mergeforest-sim/parallel.hpp>
+
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace mergeforest_sim {
+
+// FNV-1a variant that consumes 8 bytes per step
+inline uint64_t hash_bytes(const char* data, std::size_t size) {
+  constexpr uint64_t prime = 0x100000001b3;
+  uint64_t hash = 0xcbf29ce484222325;
+  std::size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word = 0;
+    std::memcpy(&word, data + i, sizeof(uint64_t));
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 32;
+  }
+  for (; i < size; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+  }
+  return hash;
+}
+
+// Hash of large buffers computed in parallel. The buffer is hashed in fixed
+// size blocks, so the result doesn't depend on the number of threads.
+inline uint64_t hash_bytes_parallel(const char* data, std::size_t size) {
+  constexpr std::size_t hash_block_size = std::size_t{1} << 20;
+  const std::size_t num_blocks = size / hash_block_size + 1;
+  std::vector<uint64_t> block_hashes(num_blocks);
+  parallel_blocks(num_blocks, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      const std::size_t offset = i * hash_block_size;
+      block_hashes[i] = hash_bytes(data + offset, std::min(hash_block_size, size - offset));
+    }
+  });
+  return hash_bytes(reinterpret_cast<const char*>(block_hashes.data()),
+                    block_hashes.size() * sizeof(uint64_t));
+}
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_HASH_HPP
@@ -0,0 +1,40 @@
+#include <mergeforest-sim/host_metrics.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <sys/resource.h>
+
+namespace mergeforest_sim {
+
+std::size_t peak_rss_bytes() {
+  struct rusage usage {};
+  if (::getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+  // ru_maxrss is in kilobytes on Linux
+  return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+}
+
+void Host_Metrics::print(std::ostream& os, std::size_t cycles) const {
+  const auto total_time = load_time + preprocess_time + simulate_time + verify_time;
+  const auto cycles_per_second = simulate_time > 0.0
+    ? static_cast<double>(cycles) / simulate_time : 0.0;
+  fmt::print(os, "*---Host---*\n");
+  fmt::print(os, "Host load time: {:.4f} s\n", load_time);
+  fmt::print(os, "Host preprocess time: {:.4f} s\n", preprocess_time);
+  fmt::print(os, "Host simulate time: {:.4f} s\n", simulate_time);
+  fmt::print(os, "Host verify time: {:.4f} s\n", verify_time);
+  fmt::print(os, "Host total time: {:.4f} s\n", total_time);
+  fmt::print(os, "Host simulated cycles per second: {:.1f}\n", cycles_per_second);
+  const auto peak_rss_MB = static_cast<double>(peak_rss_bytes()) / (1024.0 * 1024.0);
+  if (concurrent_runs > 1) {
+    fmt::print(os, "Host process peak RSS: {:.2f} MB ({} concurrent simulations)\n",
+               peak_rss_MB, concurrent_runs);
+  } else {
+    fmt::print(os, "Host peak RSS: {:.2f} MB\n", peak_rss_MB);
+  }
+  for (const auto& [name, time] : component_times) {
+    fmt::print(os, "Host {} time: {:.4f} s\n", name, time);
+  }
+}
+
+} // namespace mergeforest_sim
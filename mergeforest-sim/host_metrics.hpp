@@ -0,0 +1,58 @@
+#ifndef MERGEFOREST_SIM_HOST_METRICS_HPP
+#define MERGEFOREST_SIM_HOST_METRICS_HPP
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace mergeforest_sim {
+
+using Host_Clock = std::chrono::steady_clock;
+
+inline double elapsed_seconds(Host_Clock::time_point start) {
+  return std::chrono::duration<double>(Host_Clock::now() - start).count();
+}
+
+// peak resident set size of the process in bytes
+std::size_t peak_rss_bytes();
+
+// Performance of the simulator itself on the host, as opposed to the
+// performance of the simulated architecture
+struct Host_Metrics {
+  struct Component_Time {
+    std::string name;
+    double time {};
+  };
+
+  void print(std::ostream& os, std::size_t cycles) const;
+
+  // wall time of each phase of the simulation in seconds
+  double load_time {};
+  double preprocess_time {};
+  double simulate_time {};
+  double verify_time {};
+  // simulations running at the same time in the process, the peak RSS is
+  // then the one of all of them
+  std::size_t concurrent_runs {1};
+  // wall time of the update and apply calls of each component, only
+  // measured when the profile_components config option is set
+  std::vector<Component_Time> component_times;
+};
+
+// calls func and, if profile is set, adds its wall time to seconds
+template<bool profile, typename Func>
+void profiled_call(double& seconds, Func&& func) {
+  if constexpr (profile) {
+    const auto start = Host_Clock::now();
+    func();
+    seconds += elapsed_seconds(start);
+  } else {
+    func();
+  }
+}
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_HOST_METRICS_HPP
@@ -2,12 +2,18 @@
 #include <mergeforest-sim/matrix_IO.hpp>
 #include <mergeforest-sim/gen_matrix.hpp>
 #include <mergeforest-sim/simulator.hpp>
+#include <mergeforest-sim/sweep.hpp>
+#include <mergeforest-sim/host_metrics.hpp>
+#include <mergeforest-sim/time_series.hpp>
 
 #include <CLI/CLI.hpp>
 #include <spdlog/spdlog.h>
 
 #include <string>
+#include <vector>
 #include <filesystem>
+#include <fstream>
+#include <iostream>
 
 using namespace mergeforest_sim;
 namespace fs = std::filesystem;
@@ -19,6 +25,8 @@ int run_sim_app(CLI::App& app) {
   fs::path output_path;
   std::string out_filename;
   bool compute_result {true};
+  bool use_matrix_cache {true};
+  std::string preproc_cache_dir;
 
   app.add_option("-m,--matrix,--matrix1", matrix_file1, "matrix file")
     ->required()->check(CLI::ExistingFile);
@@ -32,6 +40,10 @@ int run_sim_app(CLI::App& app) {
     ->needs(sim_outdir_opt);
   app.add_flag("--compute-result,--no-compute-result{false}",
                compute_result, "compute result");
+  app.add_flag("--matrix-cache,--no-matrix-cache{false}",
+               use_matrix_cache, "read and write binary matrix caches");
+  app.add_option("--preproc-cache", preproc_cache_dir,
+                 "directory of the cache of preprocessed matrix data");
 
   try {
     app.parse(app.remaining_for_passthrough());
@@ -49,9 +61,10 @@ int run_sim_app(CLI::App& app) {
     output_path /= out_filename;
   }
 
+  const auto load_start = Host_Clock::now();
   fmt::print("Loading matrix A: {}... ", matrix_file1.string());
   fflush(stdout);
-  Spmat_Csr A(matrix_file1);
+  Spmat_Csr A(matrix_file1, use_matrix_cache);
   fmt::print("Done\n");
   Spmat_Csr B;
   if (matrix_file2.empty()) {
@@ -65,10 +78,13 @@ int run_sim_app(CLI::App& app) {
   } else {
     fmt::print("Loading matrix B: {}... ", matrix_file2.string());
     fflush(stdout);
-    B = read_matrix_market_file(matrix_file2);
+    B = load_matrix(matrix_file2, use_matrix_cache);
     fmt::print("Done\n");
   }
+  const auto load_time = elapsed_seconds(load_start);
   Simulator simulator(config_file, output_path);
+  simulator.set_preproc_cache_dir(preproc_cache_dir);
+  simulator.set_load_time(load_time);
   simulator.set_mats(A, B);
   fmt::print("Starting simulation...\n");
   simulator.run_simulation(compute_result);
@@ -84,6 +100,8 @@ int run_stats_app(CLI::App& app) {
   fs::path config_file;
   fs::path output_path;
   std::string out_filename;
+  bool use_matrix_cache {true};
+  std::vector<std::size_t> cache_sizes;
 
   app.add_option("-m,--matrix,--matrix1", matrix_file1, "matrix file")->required()
     ->check(CLI::ExistingFile);
@@ -91,6 +109,10 @@ int run_stats_app(CLI::App& app) {
   const auto outdir_opt = app.add_option("-o,--outdir", output_path,
                                                "output directory");
   app.add_option("--outname", out_filename, "output filename")->needs(outdir_opt);
+  app.add_flag("--matrix-cache,--no-matrix-cache{false}",
+               use_matrix_cache, "read and write binary matrix caches");
+  app.add_option("--cache-size", cache_sizes,
+                 "cache sizes in bytes at which the B traffic is predicted");
 
   try {
     app.parse(app.remaining_for_passthrough());
@@ -110,7 +132,7 @@ int run_stats_app(CLI::App& app) {
 
   fmt::print("Loading matrix A: {}... ", matrix_file1.string());
   fflush(stdout);
-  Spmat_Csr A(matrix_file1);
+  Spmat_Csr A(matrix_file1, use_matrix_cache);
   fmt::print("Done\n");
   Spmat_Csr B;
   if (matrix_file2.empty()) {
@@ -124,17 +146,74 @@ int run_stats_app(CLI::App& app) {
   } else {
     fmt::print("Loading matrix B: {}... ", matrix_file2.string());
     fflush(stdout);
-    B = read_matrix_market_file(matrix_file2);
+    B = load_matrix(matrix_file2, use_matrix_cache);
     fmt::print("Done\n");
   }
   fmt::print("Computing spGEMM_stats...\n");
-  print_spGEMM_stats(A, B, output_path.string());
+  print_spGEMM_stats(A, B, output_path.string(), cache_sizes);
   if (!output_path.empty()) {
     fmt::print("Stats written to {}\n", output_path.c_str());
   }
   return 0;
 }
 
+int run_sweep_app(CLI::App& app) {
+  std::vector<std::string> matrix_files;
+  std::vector<std::string> config_files;
+  std::string output_path;
+  std::string out_filename {"sweep_results.csv"};
+  std::string preproc_cache_dir;
+  unsigned num_workers {0};
+  bool compute_result {false};
+  bool use_matrix_cache {true};
+
+  app.add_option("-m,--matrix", matrix_files, "matrix files")->required()
+    ->check(CLI::ExistingFile);
+  app.add_option("-c,--config", config_files, "config files")->required()
+    ->check(CLI::ExistingFile);
+  app.add_option("-o,--outdir", output_path, "output directory")->required();
+  app.add_option("--outname", out_filename, "results table filename");
+  app.add_option("-j,--threads", num_workers,
+                 "number of parallel simulations (0 uses all hardware threads)");
+  app.add_flag("--compute-result,--no-compute-result{false}",
+               compute_result, "compute result");
+  app.add_flag("--matrix-cache,--no-matrix-cache{false}",
+               use_matrix_cache, "read and write binary matrix caches");
+  app.add_option("--preproc-cache", preproc_cache_dir,
+                 "directory of the cache of preprocessed matrix data");
+
+  try {
+    app.parse(app.remaining_for_passthrough());
+  } catch(const CLI::ParseError& e) { return app.exit(e); }
+
+  run_sweep(matrix_files, config_files, output_path, out_filename, compute_result,
+            use_matrix_cache, num_workers, preproc_cache_dir);
+  fmt::print("Sweep results written to {}\n", (fs::path(output_path) / out_filename).string());
+  return 0;
+}
+
+int run_time_series_app(CLI::App& app) {
+  fs::path input_file;
+  fs::path output_file;
+
+  app.add_option("-i,--input", input_file, "time series file")->required()
+    ->check(CLI::ExistingFile);
+  app.add_option("-o,--output", output_file, "CSV file, printed to stdout if not set");
+
+  try {
+    app.parse(app.remaining_for_passthrough());
+  } catch(const CLI::ParseError& e) { return app.exit(e); }
+
+  const auto time_series = read_time_series(input_file);
+  if (output_file.empty()) {
+    print_time_series_csv(time_series, std::cout);
+  } else {
+    std::ofstream of(output_file);
+    print_time_series_csv(time_series, of);
+  }
+  return 0;
+}
+
 int run_gen_app(CLI::App& app) {
   unsigned num_nodes {};
   unsigned num_edges {};
@@ -176,8 +255,14 @@ int main(int argc, char* argv[]) {
     app.require_subcommand(1);
     auto stats_app = app.add_subcommand("stats", "Print SpGEMM stats")->prefix_command();
     auto sim_app = app.add_subcommand("simulate", "Run simulation")->prefix_command();
+    auto sweep_app = app.add_subcommand("sweep",
+                                        "Run simulations of several matrices and configs")
+      ->prefix_command();
     auto gen_app = app.add_subcommand("generate", "Generate random sparse matrix")
       ->prefix_command();
+    auto time_series_app = app.add_subcommand("time-series",
+                                              "Convert a time series file to CSV")
+      ->prefix_command();
 
     CLI11_PARSE(app, argc, argv);
 
@@ -185,8 +270,12 @@ int main(int argc, char* argv[]) {
       return run_sim_app(*sim_app);
     } else if (*stats_app) {
       return run_stats_app(*stats_app);
+    } else if (*sweep_app) {
+      return run_sweep_app(*sweep_app);
     } else if (*gen_app) {
       return run_gen_app(*gen_app);
+    } else if (*time_series_app) {
+      return run_time_series_app(*time_series_app);
     }
   } catch (const std::exception& e) {
     spdlog::error("Unhandled exception in main: {}", e.what());
@@ -1,5 +1,6 @@
 #include <mergeforest-sim/main_memory.hpp>
 
+#include <algorithm>
 #include <functional>
 #include <cassert>
 
@@ -7,6 +8,7 @@ namespace mergeforest_sim {
 
 Main_Memory::Main_Memory(const toml::value& parsed_config) {
   get_config_params(parsed_config);
+  pending_reqs = Timing_Wheel<Pending_Response>(latency + 1);
 }
 
 void Main_Memory::reset() {
@@ -14,15 +16,39 @@ void Main_Memory::reset() {
     port.reset();
   }
   pending_reqs.clear();
+  for (auto& responses : ready_responses) {
+    responses.clear();
+  }
   arbiter = UINT64_MAX;
   cycle = 0;
+  active = false;
   read_requests = 0;
   write_requests = 0;
   reads_completed = 0;
   writes_completed = 0;
+  if (dram) {
+    dram->reset();
+    dram_reads.clear();
+  }
 }
 
 void Main_Memory::update() {
+  active = false;
+  receive_requests();
+  if (dram && dram->update(cycle, dram_reads)) {
+    add_dram_reads();
+    // the writes are completed when the DRAM issues them
+    writes_completed = dram->writes_issued;
+    active = true;
+  }
+  send_responses();
+  ++cycle;
+  for (auto& port : slave_ports) {
+    if (port.transfer()) { active = true; }
+  }
+}
+
+void Main_Memory::receive_requests() {
   // add requests with round robin arbitration and respecting the maximum bandwidth
   unsigned count {0};
   for (unsigned i = 0; i < slave_ports.size(); ++i) {
@@ -30,35 +56,58 @@ void Main_Memory::update() {
     if (!slave_ports[arbiter].msg_received_valid()) continue;
     const auto request = slave_ports[arbiter].get_msg_received();
     assert(request.valid());
-    if (request.is_write) {
+    if (dram) {
+      // the request waits in the port while the queue of its channel is full
+      if (!dram->can_accept(request.address)) continue;
+      dram->add_request(request, arbiter, cycle);
+      if (request.is_write) {
+        ++write_requests;
+      } else {
+        ++read_requests;
+      }
+    } else if (request.is_write) {
       ++write_requests;
       ++writes_completed;
     } else {
-      pending_reqs.emplace_back(Mem_Response{.address = request.address, .id = request.id},
-        cycle + latency, arbiter);
+      pending_reqs.push(cycle + latency, Pending_Response{
+          .response = Mem_Response{.address = request.address, .id = request.id},
+          .port = arbiter});
       ++read_requests;
     }
     slave_ports[arbiter].clear_msg_received();
+    active = true;
     ++count;
     if (count == requests_per_cycle) break;
   }
-  // send responses that have waited the specified latency
-  while (!pending_reqs.empty()) {
-    auto [resp, req_cycle, idx] = pending_reqs.front();
-    if (req_cycle <= cycle && !slave_ports[idx].has_msg_send()) {
-      slave_ports[idx].add_msg_send(resp);
-      pending_reqs.pop_front();
-      ++reads_completed;
-    } else break;
+}
+
+// the reads are answered in the order their data arrives
+void Main_Memory::add_dram_reads() {
+  for (const auto& [response, port, data_cycle] : dram_reads) {
+    pending_reqs.push(data_cycle + dram->controller_latency,
+                      Pending_Response{.response = response, .port = port});
   }
-  ++cycle;
-  for (auto& port : slave_ports) {
-    port.transfer();
+  dram_reads.clear();
+}
+
+// sends the responses that have waited their latency, one per port and cycle
+void Main_Memory::send_responses() {
+  pending_reqs.pop_ready(cycle, [this](Pending_Response&& pending) {
+    ready_responses[pending.port].push_back(pending.response);
+  });
+  for (std::size_t i = 0; i < slave_ports.size(); ++i) {
+    auto& responses = ready_responses[i];
+    if (responses.empty() || slave_ports[i].has_msg_send()) continue;
+    slave_ports[i].add_msg_send(responses.front());
+    responses.pop_front();
+    ++reads_completed;
+    active = true;
   }
 }
 
 void Main_Memory::set_num_ports(std::size_t num_ports) {
   slave_ports = std::vector<Mem_Port>(num_ports);
+  ready_responses = std::vector<Ring_Queue<Mem_Response>>(num_ports);
 }
 
 Main_Memory::Mem_Port* Main_Memory::get_port(std::size_t id) {
@@ -66,14 +115,56 @@ Main_Memory::Mem_Port* Main_Memory::get_port(std::size_t id) {
   return &slave_ports[id];
 }
 
+void Main_Memory::add_time_series_columns(Time_Series_Writer& time_series) const {
+  time_series.add_counter("mem_reads", &read_requests);
+  time_series.add_counter("mem_writes", &write_requests);
+}
+
 bool Main_Memory::inactive() const {
   return read_requests == reads_completed
     && write_requests == writes_completed;
 };
 
+bool Main_Memory::idle() const {
+  return !active;
+}
+
+std::size_t Main_Memory::cycles_to_next_event() const {
+  // a response waiting for its port is sent as soon as the port is free
+  const auto responses_ready = std::ranges::any_of(ready_responses, [](const auto& responses) {
+    return !responses.empty();
+  });
+  if (responses_ready) { return 0; }
+  if (pending_reqs.empty()) {
+    return dram ? dram->cycles_to_next_event(cycle) : 0;
+  }
+  const auto req_cycle = pending_reqs.next_ready();
+  const auto num_cycles = (req_cycle > cycle) ? req_cycle - cycle : 0;
+  return dram ? std::min(num_cycles, dram->cycles_to_next_event(cycle)) : num_cycles;
+}
+
+void Main_Memory::skip_cycles(std::size_t num_cycles) {
+  cycle += num_cycles;
+  // otherwise the next push would be more than a turn ahead of the wheel
+  pending_reqs.advance(cycle);
+}
+
+void Main_Memory::set_address_regions(
+  const std::vector<std::pair<std::string, Address>>& regions)
+{
+  if (dram) { dram->set_address_regions(regions); }
+}
+
+void Main_Memory::print_dram_stats(std::ostream& os, std::size_t cycles) const {
+  if (dram) { dram->print_stats(os, cycles); }
+}
+
 void Main_Memory::get_config_params(const toml::value& parsed_config) {
   latency = toml::find_or(parsed_config, "mem", "latency", 80u);
   requests_per_cycle = toml::find_or(parsed_config, "mem", "bandwidth", 128u) / mem_transaction_size;
+  if (!toml::find_or(parsed_config, "mem", "simple", true)) {
+    dram.emplace(parsed_config);
+  }
 }
 
 } // namespace mergeforest_sim
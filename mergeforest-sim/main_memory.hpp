@@ -1,21 +1,27 @@
 #ifndef MERGEFOREST_SIM_MAIN_MEM_HPP
 #define MERGEFOREST_SIM_MAIN_MEM_HPP
 
+#include <mergeforest-sim/dram.hpp>
 #include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/ring_queue.hpp>
 #include <mergeforest-sim/math_utils.hpp>
+#include <mergeforest-sim/timing_wheel.hpp>
+#include <mergeforest-sim/time_series.hpp>
 
 #include <toml.hpp>
 
 #include <string>
-#include <deque>
 #include <vector>
-#include <tuple>
 #include <unordered_map>
 #include <memory>
+#include <optional>
+#include <ostream>
 #include <cstdint>
 
 namespace mergeforest_sim {
 
+// Main memory with a fixed latency and bandwidth or, with [mem] simple =
+// false, the cycle level DRAM model
 class Main_Memory {
 public:
   using Mem_Port = Port<Mem_Response, Mem_Request>;
@@ -26,7 +32,17 @@ public:
   void set_num_ports(std::size_t num_ports);
   Mem_Port* get_port(std::size_t id);
   bool inactive() const;
-  void print_dramsim3_stats() const;
+  // true if the last update didn't accept, send or transfer any message
+  bool idle() const;
+  // number of cycles until the next pending read can be answered or the
+  // DRAM can issue a command
+  std::size_t cycles_to_next_event() const;
+  void skip_cycles(std::size_t num_cycles);
+  // names and start addresses of the regions of the DRAM stats
+  void set_address_regions(const std::vector<std::pair<std::string, Address>>& regions);
+  // prints nothing with the simple model
+  void print_dram_stats(std::ostream& os, std::size_t cycles) const;
+  void add_time_series_columns(Time_Series_Writer& time_series) const;
 
   // stats
   std::size_t read_requests {};
@@ -34,12 +50,27 @@ public:
   std::size_t reads_completed {};
   std::size_t writes_completed {};
 private:
+  struct Pending_Response {
+    Mem_Response response;
+    std::size_t port {};
+  };
+
   void get_config_params(const toml::value& parsed_config);
+  void receive_requests();
+  void add_dram_reads();
+  void send_responses();
 
   std::vector<Mem_Port> slave_ports;
-  std::deque<std::tuple<Mem_Response, std::size_t, std::size_t>> pending_reqs;
+  // reads waiting for their latency
+  Timing_Wheel<Pending_Response> pending_reqs;
+  // answered reads waiting for their port, a port that can't send doesn't
+  // block the responses of the rest
+  std::vector<Ring_Queue<Mem_Response>> ready_responses;
   std::size_t arbiter {UINT64_MAX};
   std::size_t cycle {};
+  bool active {};
+  std::optional<Dram> dram;
+  std::vector<Dram_Read> dram_reads;
   // config parameters
   unsigned latency {};
   unsigned requests_per_cycle {};
@@ -0,0 +1,40 @@
+#include <mergeforest-sim/mapped_file.hpp>
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mergeforest_sim {
+
+Mapped_File::Mapped_File(const std::string& filename, bool copy_on_write) {
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("unable to open file \"" + filename + "\" for reading");
+  }
+  struct stat file_stat {};
+  if (::fstat(fd, &file_stat) != 0) {
+    ::close(fd);
+    throw std::runtime_error("unable to stat file \"" + filename + "\"");
+  }
+  length = static_cast<std::size_t>(file_stat.st_size);
+  if (length > 0) {
+    const int prot = copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* ptr = ::mmap(nullptr, length, prot, MAP_PRIVATE, fd, 0);
+    if (ptr == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("unable to map file \"" + filename + "\"");
+    }
+    ::madvise(ptr, length, copy_on_write ? MADV_WILLNEED : MADV_SEQUENTIAL);
+    addr = static_cast<char*>(ptr);
+  }
+  ::close(fd);
+}
+
+Mapped_File::~Mapped_File() {
+  if (addr != nullptr) { ::munmap(addr, length); }
+}
+
+} // namespace mergeforest_sim
@@ -0,0 +1,30 @@
+#ifndef MERGEFOREST_SIM_MAPPED_FILE_HPP
+#define MERGEFOREST_SIM_MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace mergeforest_sim {
+
+// private memory mapping of a whole file, read-only by default. With
+// copy_on_write the pages can be modified without changing the file.
+class Mapped_File {
+public:
+  explicit Mapped_File(const std::string& filename, bool copy_on_write = false);
+  ~Mapped_File();
+  Mapped_File(const Mapped_File&) = delete;
+  Mapped_File& operator=(const Mapped_File&) = delete;
+
+  char* data() { return addr; }
+  const char* data() const { return addr; }
+  std::size_t size() const { return length; }
+  std::string_view view() const { return {addr, length}; }
+private:
+  char* addr {nullptr};
+  std::size_t length {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_MAPPED_FILE_HPP
@@ -1,14 +1,27 @@
 #include <mergeforest-sim/matrix_IO.hpp>
+#include <mergeforest-sim/mapped_file.hpp>
+#include <mergeforest-sim/hash.hpp>
+#include <mergeforest-sim/parallel.hpp>
+#include <mergeforest-sim/math_utils.hpp>
+
+#include <spdlog/spdlog.h>
 
-#include <iostream>
-#include <fstream>
 #include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <memory>
 #include <vector>
 #include <tuple>
 #include <algorithm>
+#include <numeric>
 #include <string>
+#include <string_view>
 #include <stdexcept>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
+
+#include <unistd.h>
 
 namespace mergeforest_sim {
 
@@ -37,13 +50,11 @@ struct Matrix_Market_Header {
   Symmetry symmetry;
 };
 
-Matrix_Market_Header read_matrix_market_header(std::ifstream& input_stream) {
+Matrix_Market_Header read_matrix_market_header(std::string_view line) {
   Matrix_Market_Header header;
   std::stringstream stream;
-  std::string buffer;
   // tokenize header
-  std::getline(input_stream, buffer);
-  stream << buffer;
+  stream << line;
   std::string identifier, object, format, type, symmetry;
   stream >> identifier >> object >> format >> type >> symmetry;
   // check if header is valid
@@ -92,72 +103,376 @@ Matrix_Market_Header read_matrix_market_header(std::ifstream& input_stream) {
   return header;
 }
 
-Spmat_Csr read_matrix_market_file(const std::string& filename) {
-  Spmat_Csr mtx;
-  std::ifstream input_stream(filename);
-  if (!input_stream)
-    throw std::runtime_error("unable to open file \"" + filename + "\" for reading");
-  // read header
-  Matrix_Market_Header header = read_matrix_market_header(input_stream);
-  std::string line;
-  // skip over comments
-  do {
-    std::getline(input_stream, line);
-  } while (line[0] == '%');
-  // tokenize size line
-  std::istringstream(line) >> mtx.num_rows >> mtx.num_cols >> mtx.nnz;
-  
-  std::vector<std::tuple<uint32_t, uint32_t, double>> coo;
-  
-  for (unsigned i = 0; i < mtx.nnz; ++i) {
-    // tokenize each data line
-    std::getline(input_stream, line);
-    std::stringstream stream(line);
-    unsigned row_idx = 0;
-    unsigned col_idx = 0;
-    double value = 1.0;
-    stream >> row_idx >> col_idx;
-    if (row_idx < 1 || col_idx < 1 || row_idx > mtx.num_rows || col_idx > mtx.num_cols) {
-      throw std::runtime_error("MatrixMarket invalid index");
+namespace {
+
+// hand-written scanner for the data lines of a Matrix Market file
+class Line_Scanner {
+public:
+  Line_Scanner(const char* begin, const char* end_) : cur{begin}, end{end_} {}
+
+  // skips blank and comment lines, returns false at the end of the input
+  bool next_data_line() {
+    while (cur != end) {
+      skip_blanks();
+      if (cur == end) { return false; }
+      if (*cur != '\n' && *cur != '%') { return true; }
+      skip_line();
     }
-    if (header.type == Type::real || header.type == Type::integer) {
-      stream >> value;
+    return false;
+  }
+
+  bool read_index(uint32_t& value) {
+    skip_blanks();
+    if (cur == end || *cur < '0' || *cur > '9') { return false; }
+    uint64_t result = 0;
+    while (cur != end && *cur >= '0' && *cur <= '9') {
+      result = result * 10 + static_cast<uint64_t>(*cur - '0');
+      if (result > UINT32_MAX) { return false; }
+      ++cur;
     }
-    if (stream.fail()) {
+    value = static_cast<uint32_t>(result);
+    return true;
+  }
+
+  bool read_value(double& value) {
+    skip_blanks();
+    if (cur != end && *cur == '+') { ++cur; }
+    const auto [ptr, ec] = std::from_chars(cur, end, value);
+    if (ec != std::errc{}) { return false; }
+    cur = ptr;
+    return true;
+  }
+
+  void skip_line() {
+    const auto* newline = static_cast<const char*>(
+      std::memchr(cur, '\n', static_cast<std::size_t>(end - cur)));
+    cur = (newline == nullptr) ? end : newline + 1;
+  }
+private:
+  void skip_blanks() {
+    while (cur != end && (*cur == ' ' || *cur == '\t' || *cur == '\r')) { ++cur; }
+  }
+
+  const char* cur;
+  const char* end;
+};
+
+std::string_view next_line(std::string_view text, std::size_t& pos) {
+  const auto line_end = std::min(text.find('\n', pos), text.size());
+  const auto line = text.substr(pos, line_end - pos);
+  pos = std::min(line_end + 1, text.size());
+  return line;
+}
+
+// Parses the data lines in [begin, end), calls add_entry(row, col, value)
+// for each entry (and its mirror in symmetric matrices) and returns the number
+// of lines read. Without read_values only the indices are parsed.
+template<bool read_values, typename Func>
+std::size_t parse_entries(const char* begin, const char* end,
+                          const Matrix_Market_Header& header,
+                          uint32_t num_rows, uint32_t num_cols, Func&& add_entry)
+{
+  Line_Scanner scanner(begin, end);
+  std::size_t num_lines = 0;
+  while (scanner.next_data_line()) {
+    uint32_t row_idx = 0;
+    uint32_t col_idx = 0;
+    double value = 1.0;
+    if (!scanner.read_index(row_idx) || !scanner.read_index(col_idx)) {
       throw std::runtime_error("MatrixMarket invalid data");
     }
-    coo.push_back(std::make_tuple(row_idx - 1, col_idx - 1, value));
+    if (row_idx < 1 || col_idx < 1 || row_idx > num_rows || col_idx > num_cols) {
+      throw std::runtime_error("MatrixMarket invalid index");
+    }
+    if (read_values && (header.type == Type::real || header.type == Type::integer)) {
+      if (!scanner.read_value(value)) {
+        throw std::runtime_error("MatrixMarket invalid data");
+      }
+    }
+    scanner.skip_line();
+    ++num_lines;
+    add_entry(row_idx - 1, col_idx - 1, value);
     if (row_idx != col_idx) {
       if (header.symmetry == Symmetry::symmetric) {
-        coo.push_back(std::make_tuple(col_idx - 1, row_idx - 1, value));
+        add_entry(col_idx - 1, row_idx - 1, value);
       }
       else if (header.symmetry == Symmetry::skew_symmetric) {
-        coo.push_back(std::make_tuple(col_idx - 1, row_idx - 1, -value));
+        add_entry(col_idx - 1, row_idx - 1, -value);
       }
     }
   }
-  std::sort(coo.begin(), coo.end());
+  return num_lines;
+}
+
+// sorts the entries of each row by column (and value, for duplicates)
+void sort_rows(Spmat_Csr& mtx) {
+  parallel_blocks(mtx.num_rows, [&](std::size_t, std::size_t begin, std::size_t end) {
+    std::vector<std::pair<uint32_t, double>> row;
+    for (std::size_t i = begin; i != end; ++i) {
+      const auto row_begin = mtx.row_ptr[i];
+      const auto row_end = mtx.row_ptr[i + 1];
+      bool sorted = true;
+      for (auto j = row_begin; j + 1 < row_end && sorted; ++j) {
+        sorted = mtx.col_idx[j] < mtx.col_idx[j + 1]
+          || (mtx.col_idx[j] == mtx.col_idx[j + 1] && mtx.values[j] <= mtx.values[j + 1]);
+      }
+      if (sorted) { continue; }
+      row.clear();
+      for (auto j = row_begin; j != row_end; ++j) {
+        row.emplace_back(mtx.col_idx[j], mtx.values[j]);
+      }
+      std::sort(row.begin(), row.end());
+      for (auto j = row_begin; j != row_end; ++j) {
+        std::tie(mtx.col_idx[j], mtx.values[j]) = row[j - row_begin];
+      }
+    }
+  }, std::size_t{1} << 12);
+}
+
+} // namespace
+
+Spmat_Csr read_matrix_market_file(const std::string& filename) {
+  // files are split in chunks of at least this size to be parsed in parallel
+  constexpr std::size_t min_chunk_size = std::size_t{1} << 20;
+  Spmat_Csr mtx;
+  const Mapped_File file(filename);
+  const std::string_view text = file.view();
+  std::size_t pos = 0;
+  // read header
+  Matrix_Market_Header header = read_matrix_market_header(next_line(text, pos));
+  std::string_view line;
+  // skip over comments
+  do {
+    line = next_line(text, pos);
+  } while (pos < text.size() && (line.empty() || line[0] == '%'));
+  // tokenize size line
+  Line_Scanner size_scanner(line.data(), line.data() + line.size());
+  uint32_t size_nnz = 0;
+  if (!size_scanner.read_index(mtx.num_rows) || !size_scanner.read_index(mtx.num_cols)
+      || !size_scanner.read_index(size_nnz))
+  {
+    throw std::runtime_error("MatrixMarket invalid size line");
+  }
+  // split the data section in line aligned chunks
+  const std::string_view data = text.substr(pos);
+  const std::size_t num_chunks = num_parallel_blocks(
+    data.size(), min_chunk_size, max_histogram_blocks(size_nnz, mtx.num_rows));
+  std::vector<std::size_t> chunk_begin(num_chunks + 1, data.size());
+  chunk_begin[0] = 0;
+  for (std::size_t i = 1; i < num_chunks; ++i) {
+    const auto newline = data.find('\n', std::max(chunk_begin[i - 1], data.size() / num_chunks * i));
+    chunk_begin[i] = (newline == std::string_view::npos) ? data.size() : newline + 1;
+  }
+  // count the entries of each row in each chunk
+  std::vector<std::vector<uint32_t>> histograms(num_chunks);
+  std::vector<std::size_t> chunk_lines(num_chunks);
+  parallel_blocks(num_chunks, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      auto& histogram = histograms[i];
+      histogram.assign(mtx.num_rows, 0);
+      chunk_lines[i] = parse_entries<false>(
+        data.data() + chunk_begin[i], data.data() + chunk_begin[i + 1], header,
+        mtx.num_rows, mtx.num_cols, [&](uint32_t row, uint32_t, double) { ++histogram[row]; });
+    }
+  });
+  if (std::accumulate(chunk_lines.begin(), chunk_lines.end(), std::size_t{0}) != size_nnz) {
+    throw std::runtime_error("MatrixMarket invalid number of entries");
+  }
   // nnz might change with symmetry
-  mtx.nnz = coo.size();
-  mtx.row_ptr = std::vector<uint32_t>(mtx.num_rows + 1);
+  mtx.nnz = 0;
+  for (const auto& histogram : histograms) {
+    mtx.nnz = std::accumulate(histogram.begin(), histogram.end(), mtx.nnz);
+  }
+  if (mtx.nnz > UINT32_MAX) {
+    throw std::runtime_error("MatrixMarket matrix has too many entries");
+  }
+  mtx.row_ptr = histograms_to_offsets(histograms, mtx.num_rows);
   mtx.col_idx = std::vector<uint32_t>(mtx.nnz);
   mtx.values = std::vector<double>(mtx.nnz);
-  mtx.row_ptr[0] = 0;
-  uint32_t prev_row = 0;
-  for (unsigned i = 0; i < mtx.nnz; ++i) {
-    const auto [row, col_idx, value] = coo[i];
-    mtx.col_idx[i] = col_idx;
-    mtx.values[i] = value;
-    for (unsigned j = prev_row; j < row; ++j) {
-      mtx.row_ptr[j + 1] = i;
-    }
-    prev_row = row;
-  }
-  for (unsigned i = prev_row; i < mtx.num_rows; ++i) {
-    mtx.row_ptr[i + 1] = static_cast<unsigned>(mtx.nnz);
-  }
-  mtx.col_idx[mtx.nnz - 1] = std::get<1>(coo[mtx.nnz - 1]);
-  mtx.values[mtx.nnz - 1] = std::get<2>(coo[mtx.nnz - 1]);
+  // place the entries of each chunk after the ones of the previous chunks
+  parallel_blocks(num_chunks, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      auto& offsets = histograms[i];
+      parse_entries<true>(
+        data.data() + chunk_begin[i], data.data() + chunk_begin[i + 1], header,
+        mtx.num_rows, mtx.num_cols, [&](uint32_t row, uint32_t col, double value) {
+          const auto entry_idx = offsets[row]++;
+          mtx.col_idx[entry_idx] = col;
+          mtx.values[entry_idx] = value;
+        });
+    }
+  });
+  sort_rows(mtx);
+  return mtx;
+}
+
+namespace {
+
+constexpr char cache_magic[8] = {'M', 'F', 'S', 'I', 'M', 'C', 'S', 'R'};
+constexpr uint32_t cache_version = 1;
+constexpr std::size_t cache_alignment = 64;
+
+struct Cache_Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t num_rows;
+  uint32_t num_cols;
+  uint64_t nnz;
+  // size and modification time of the Matrix Market file
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t row_ptr_offset;
+  uint64_t col_idx_offset;
+  uint64_t values_offset;
+  uint64_t file_size;
+  // checksum of everything after the header
+  uint64_t checksum;
+};
+
+std::pair<uint64_t, int64_t> source_stamp(const std::string& filename) {
+  namespace fs = std::filesystem;
+  return {fs::file_size(filename), fs::last_write_time(filename).time_since_epoch().count()};
+}
+
+// sets the array offsets and file size from the matrix dimensions
+void set_cache_layout(Cache_Header& header) {
+  header.row_ptr_offset = round_up_multiple<uint64_t>(sizeof(Cache_Header), cache_alignment);
+  header.col_idx_offset = round_up_multiple<uint64_t>(
+    header.row_ptr_offset + (uint64_t{header.num_rows} + 1) * sizeof(uint32_t), cache_alignment);
+  header.values_offset = round_up_multiple<uint64_t>(
+    header.col_idx_offset + header.nnz * sizeof(uint32_t), cache_alignment);
+  header.file_size = header.values_offset + header.nnz * sizeof(double);
+}
+
+} // namespace
+
+std::string matrix_cache_filename(const std::string& filename) {
+  return std::filesystem::path(filename).replace_extension(".csr").string();
+}
+
+bool read_matrix_cache(const std::string& filename, Spmat_Csr& mtx) {
+  const auto cache_filename = matrix_cache_filename(filename);
+  if (cache_filename == filename || !std::filesystem::exists(cache_filename)) {
+    return false;
+  }
+  try {
+    auto file = std::make_shared<Mapped_File>(cache_filename, true);
+    Cache_Header header {};
+    if (file->size() < sizeof(Cache_Header)) {
+      throw std::runtime_error("truncated header");
+    }
+    std::memcpy(&header, file->data(), sizeof(Cache_Header));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0
+        || header.header_size != sizeof(Cache_Header))
+    {
+      throw std::runtime_error("invalid header");
+    }
+    if (header.version != cache_version) {
+      return false;
+    }
+    const auto [source_size, source_mtime] = source_stamp(filename);
+    if (header.source_size != source_size || header.source_mtime != source_mtime) {
+      return false;
+    }
+    Cache_Header expected = header;
+    set_cache_layout(expected);
+    if (header.row_ptr_offset != expected.row_ptr_offset
+        || header.col_idx_offset != expected.col_idx_offset
+        || header.values_offset != expected.values_offset
+        || header.file_size != expected.file_size || file->size() != header.file_size)
+    {
+      throw std::runtime_error("invalid array offsets");
+    }
+    const auto* data_begin = file->data() + header.row_ptr_offset;
+    const auto data_size = header.file_size - header.row_ptr_offset;
+    if (hash_bytes_parallel(data_begin, data_size) != header.checksum) {
+      throw std::runtime_error("checksum mismatch");
+    }
+    auto* row_ptr = reinterpret_cast<uint32_t*>(file->data() + header.row_ptr_offset);
+    auto* col_idx = reinterpret_cast<uint32_t*>(file->data() + header.col_idx_offset);
+    auto* values = reinterpret_cast<double*>(file->data() + header.values_offset);
+    mtx = Spmat_Csr{};
+    mtx.num_rows = header.num_rows;
+    mtx.num_cols = header.num_cols;
+    mtx.nnz = header.nnz;
+    mtx.row_ptr = Csr_Array<uint32_t>(row_ptr, mtx.num_rows + std::size_t{1}, file);
+    mtx.col_idx = Csr_Array<uint32_t>(col_idx, mtx.nnz, file);
+    mtx.values = Csr_Array<double>(values, mtx.nnz, file);
+    return true;
+  } catch (const std::exception& e) {
+    spdlog::warn("ignoring matrix cache \"{}\": {}", cache_filename, e.what());
+    return false;
+  }
+}
+
+void write_matrix_cache(const std::string& filename, const Spmat_Csr& mtx) {
+  const auto cache_filename = matrix_cache_filename(filename);
+  if (cache_filename == filename) {
+    throw std::runtime_error("matrix file \"" + filename + "\" has the cache extension");
+  }
+  // write to a temporary file first so concurrent runs never see a partial cache
+  const auto tmp_filename = cache_filename + ".tmp" + std::to_string(::getpid());
+  Cache_Header header {};
+  std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+  header.version = cache_version;
+  header.header_size = sizeof(Cache_Header);
+  header.num_rows = mtx.num_rows;
+  header.num_cols = mtx.num_cols;
+  header.nnz = mtx.nnz;
+  std::tie(header.source_size, header.source_mtime) = source_stamp(filename);
+  set_cache_layout(header);
+  {
+    std::ofstream output(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (!output) {
+      throw std::runtime_error("unable to open file \"" + tmp_filename + "\" for writing");
+    }
+    const auto write_array = [&](uint64_t offset, const void* data, std::size_t size) {
+      const std::vector<char> padding(offset - static_cast<uint64_t>(output.tellp()), 0);
+      output.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+      output.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+    write_array(0, &header, sizeof(Cache_Header));
+    write_array(header.row_ptr_offset, mtx.row_ptr.data(), mtx.row_ptr.size() * sizeof(uint32_t));
+    write_array(header.col_idx_offset, mtx.col_idx.data(), mtx.nnz * sizeof(uint32_t));
+    write_array(header.values_offset, mtx.values.data(), mtx.nnz * sizeof(double));
+    if (!output) {
+      output.close();
+      std::filesystem::remove(tmp_filename);
+      throw std::runtime_error("unable to write file \"" + tmp_filename + "\"");
+    }
+  }
+  {
+    const Mapped_File file(tmp_filename);
+    header.checksum = hash_bytes_parallel(file.data() + header.row_ptr_offset,
+                                          header.file_size - header.row_ptr_offset);
+  }
+  {
+    std::fstream output(tmp_filename, std::ios::binary | std::ios::in | std::ios::out);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(Cache_Header));
+    if (!output) {
+      output.close();
+      std::filesystem::remove(tmp_filename);
+      throw std::runtime_error("unable to write file \"" + tmp_filename + "\"");
+    }
+  }
+  std::filesystem::rename(tmp_filename, cache_filename);
+}
+
+Spmat_Csr load_matrix(const std::string& filename, bool use_cache) {
+  if (!use_cache) {
+    return read_matrix_market_file(filename);
+  }
+  Spmat_Csr mtx;
+  if (read_matrix_cache(filename, mtx)) {
+    return mtx;
+  }
+  mtx = read_matrix_market_file(filename);
+  try {
+    write_matrix_cache(filename, mtx);
+  } catch (const std::exception& e) {
+    spdlog::warn("unable to write matrix cache: {}", e.what());
+  }
   return mtx;
 }
 
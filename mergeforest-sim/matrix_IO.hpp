@@ -9,6 +9,20 @@ namespace mergeforest_sim {
 
 Spmat_Csr read_matrix_market_file(const std::string& filename);
 
+// Binary CSR cache, stored next to the Matrix Market file with the extension
+// replaced by ".csr". The arrays are 64 byte aligned so a cached matrix is
+// used directly from the mapped file, without copying.
+std::string matrix_cache_filename(const std::string& filename);
+
+// returns false if the cache doesn't exist or is stale, invalid or corrupted
+bool read_matrix_cache(const std::string& filename, Spmat_Csr& mtx);
+
+void write_matrix_cache(const std::string& filename, const Spmat_Csr& mtx);
+
+// reads the cache of a Matrix Market file if it is up to date, otherwise
+// parses the file and (re)writes the cache
+Spmat_Csr load_matrix(const std::string& filename, bool use_cache = true);
+
 } // namespace mergeforest_sim
 
 #endif // MERGEFOREST_SIM_MAT_IO_HPP
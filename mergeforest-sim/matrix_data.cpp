@@ -2,13 +2,17 @@
 #include <mergeforest-sim/matrix_data.hpp>
 #include <mergeforest-sim/math_utils.hpp>
 #include <mergeforest-sim/sparse_matrix.hpp>
+#include <mergeforest-sim/parallel.hpp>
+#include <mergeforest-sim/preproc_cache.hpp>
 
 #include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <spdlog/spdlog.h>
 
-#include <map>
-#include <unordered_set>
 #include <algorithm>
-#include <queue>
+#include <atomic>
+#include <bit>
+#include <string>
 #include <cmath>
 
 namespace mergeforest_sim {
@@ -25,92 +29,262 @@ unsigned row_num_reads_fiber_cache(unsigned B_row_ptr, unsigned B_row_end) {
   return (end_addr - begin_addr) / block_size; 
 }
 
+namespace {
+
+// sets a bit of a bitset shared by several threads
+void set_bit_shared(std::vector<uint64_t>& bitset, std::size_t idx) {
+  std::atomic_ref<uint64_t> word(bitset[idx / 64]);
+  const auto bit = uint64_t{1} << (idx % 64);
+  if ((word.load(std::memory_order_relaxed) & bit) == 0) {
+    word.fetch_or(bit, std::memory_order_relaxed);
+  }
+}
+
+bool test_bit(const std::vector<uint64_t>& bitset, std::size_t idx) {
+  return (bitset[idx / 64] >> (idx % 64)) & 1;
+}
+
+// per block sums of preprocess_mats
+struct Preprocess_Block {
+  std::size_t num_rows {};
+  std::size_t num_elements {};
+  std::size_t C_size {};
+  std::size_t num_mults {};
+  std::size_t max_bytes_B_data {};
+  std::size_t B_data_max_reads {};
+  std::size_t B_data_max_reads_fiber_cache {};
+  std::size_t min_bytes_B_data {};
+  std::size_t B_data_min_reads {};
+  std::size_t B_data_min_reads_fiber_cache {};
+};
+
+} // namespace
+
 void Matrix_Data::preprocess_mats() {
   if (A->num_cols != B->num_rows) {
     throw std::runtime_error("matrices A and B don't have compatible dimensions");
   }
-  fmt::print("Allocating space for result matrix using the upper-bound method... ");
-  fflush(stdout);
+  std::string cache_filename;
+  bool cache_hit {false};
+  if (!preproc_cache_dir.empty()) {
+    cache_filename = preproc_cache_filename(preproc_cache_dir, *A, *B);
+    cache_hit = read_preproc_cache(cache_filename, *this);
+    if (verbose && cache_hit) {
+      fmt::print("Preprocessed data loaded from {}\n", cache_filename);
+    }
+  }
+  if (!cache_hit) {
+    compute_preprocessed_data();
+    if (!cache_filename.empty()) {
+      try {
+        write_preproc_cache(cache_filename, *this);
+      } catch (const std::exception& e) {
+        spdlog::warn("unable to write preprocessing cache: {}", e.what());
+      }
+    }
+  }
+  // the preprocessing cache keeps the natural order
+  if (row_order != Row_Order::natural) { reorder_rows(); }
+  // rows of C are written from the start of their allocated space
+  C.row_end = std::vector<uint32_t>(C.row_ptr.data(), C.row_ptr.data() + C.num_rows);
+  if (compute_result) {
+    C.col_idx = std::vector<uint32_t>(C.row_ptr[C.num_rows]);
+    C.values = std::vector<double>(C.row_ptr[C.num_rows]);
+  }
+}
 
+void Matrix_Data::compute_preprocessed_data() {
+  if (verbose) {
+    fmt::print("Allocating space for result matrix using the upper-bound method... ");
+    fflush(stdout);
+  }
+  constexpr std::size_t min_rows_per_block = std::size_t{1} << 12;
   C.num_rows = A->num_rows;
   C.num_cols = B->num_cols;
-  C.row_ptr = std::vector<uint32_t>(C.num_rows + 1);
-  C.row_end = std::vector<uint32_t>(C.num_rows);
-  C.row_ptr[0] = 0;
+  std::vector<uint32_t> C_row_ptr(std::size_t{C.num_rows} + 1, 0);
+  // B rows used by A and B cache blocks of those rows
+  std::vector<uint64_t> B_rows_used(div_ceil(std::size_t{B->num_rows}, std::size_t{64}) + 1);
+  std::vector<uint64_t> B_blocks_used(div_ceil(B->nnz / block_size + 1, std::size_t{64}) + 1);
+  std::vector<Preprocess_Block> blocks(num_parallel_blocks(A->num_rows, min_rows_per_block));
 
-  B_data_max_reads = 0;
-  B_data_min_reads = 0;
-  B_data_min_reads_fiber_cache = 0;
-  min_bytes_B_data = 0;
-  max_bytes_B_data = 0;
-  num_mults = 0;
-  preproc_A_row_ptr.push_back(0);
-  preproc_A_values.reserve(A->nnz);
-  preproc_B_row_ptr_end.reserve(A->nnz);
-  std::unordered_set<unsigned> B_row_set;
-  std::unordered_set<unsigned> B_cache_block_set;
-  bool C_row_ptr_overflow {false};
-
-  for (unsigned i = 0; i < A->num_rows; ++i) {
-    unsigned C_max_row_size {0};
-    unsigned non_empty_rows {0};
-    for (unsigned j = A->row_ptr[i]; j < A->row_ptr[i + 1]; ++j) {
-      const unsigned B_row_ptr = B->row_ptr[A->col_idx[j]];
-      const unsigned B_row_end = B->row_ptr[A->col_idx[j] + 1];
-      const unsigned B_row_size = B_row_end - B_row_ptr;
-      if (B_row_size == 0) continue;
-      max_bytes_B_data += B_row_size;
-      const auto B_row_num_reads = row_num_reads(B_row_ptr, B_row_end);
-      B_data_max_reads += B_row_num_reads;
-      B_data_max_reads_fiber_cache += row_num_reads_fiber_cache(B_row_ptr, B_row_end);
-      if (!B_row_set.contains(A->col_idx[j])) {
-        B_row_set.insert(A->col_idx[j]);
-        min_bytes_B_data += B_row_size;
-        B_data_min_reads += B_row_num_reads;
+  // count the non empty rows and elements of each block and the upper bound
+  // of the size of the rows of C
+  parallel_blocks(A->num_rows, [&](std::size_t block_idx, std::size_t begin, std::size_t end) {
+    auto& block = blocks[block_idx];
+    for (std::size_t i = begin; i != end; ++i) {
+      unsigned C_max_row_size {0};
+      unsigned non_empty_rows {0};
+      for (unsigned j = A->row_ptr[i]; j < A->row_ptr[i + 1]; ++j) {
+        const unsigned B_row_ptr = B->row_ptr[A->col_idx[j]];
+        const unsigned B_row_end = B->row_ptr[A->col_idx[j] + 1];
+        const unsigned B_row_size = B_row_end - B_row_ptr;
+        if (B_row_size == 0) continue;
+        block.max_bytes_B_data += B_row_size;
+        block.B_data_max_reads += row_num_reads(B_row_ptr, B_row_end);
+        block.B_data_max_reads_fiber_cache += row_num_reads_fiber_cache(B_row_ptr, B_row_end);
+        set_bit_shared(B_rows_used, A->col_idx[j]);
+        C_max_row_size += B_row_size;
+        block.num_mults += B_row_size;
+        ++non_empty_rows;
       }
-      // iterate all blocks of a row to calculate min B reads with infinite cache
+      C_max_row_size = std::min(C_max_row_size, B->num_cols);
+      C_row_ptr[i] = C_max_row_size;
+      block.C_size += C_max_row_size;
+      block.num_elements += non_empty_rows;
+      block.num_rows += (non_empty_rows > 0);
+    }
+  }, min_rows_per_block);
+
+  // B rows and cache blocks read with infinite reuse
+  std::vector<Preprocess_Block> B_blocks(num_parallel_blocks(B->num_rows, min_rows_per_block));
+  parallel_blocks(B->num_rows, [&](std::size_t block_idx, std::size_t begin, std::size_t end) {
+    auto& block = B_blocks[block_idx];
+    for (std::size_t i = begin; i != end; ++i) {
+      if (!test_bit(B_rows_used, i)) continue;
+      const unsigned B_row_ptr = B->row_ptr[i];
+      const unsigned B_row_end = B->row_ptr[i + 1];
+      block.min_bytes_B_data += B_row_end - B_row_ptr;
+      block.B_data_min_reads += row_num_reads(B_row_ptr, B_row_end);
       for (unsigned idx = round_down_multiple(B_row_ptr, block_size); idx < B_row_end; idx += block_size) {
-        if (!B_cache_block_set.contains(idx)) {
-          B_cache_block_set.insert(idx);
-          ++B_data_min_reads_fiber_cache;
-        }
+        set_bit_shared(B_blocks_used, idx / block_size);
       }
-      C_max_row_size += B_row_size;
-      num_mults += B_row_size;
-      ++non_empty_rows;
-      preproc_A_values.emplace_back(A->values[j]);
-      preproc_B_row_ptr_end.emplace_back(B_row_ptr, B_row_end);
-    }
-    C_max_row_size = std::min(C_max_row_size, B->num_cols);
-    C.row_ptr[i + 1] = C.row_ptr[i] + C_max_row_size;
-    C.row_end[i] =  C.row_ptr[i];
-    if (C.row_ptr[i + 1] < C.row_ptr[i]) {
-      C_row_ptr_overflow = true;
-    }
-    if (non_empty_rows > 0) {
-      preproc_A_row_ptr.push_back(preproc_A_row_ptr.back() + non_empty_rows);
-      preproc_A_row_idx.push_back(i);
-      preproc_C_row_ptr.push_back(C.row_ptr[i]);
     }
+  }, min_rows_per_block);
+  B_data_min_reads_fiber_cache = 0;
+  for (const auto word : B_blocks_used) {
+    B_data_min_reads_fiber_cache += static_cast<std::size_t>(std::popcount(word));
   }
+
+  Preprocess_Block total;
+  for (auto& block : blocks) {
+    const auto num_rows = block.num_rows;
+    const auto num_elements = block.num_elements;
+    // offsets of the block in the preprocessed arrays
+    block.num_rows = total.num_rows;
+    block.num_elements = total.num_elements;
+    total.num_rows += num_rows;
+    total.num_elements += num_elements;
+    total.C_size += block.C_size;
+    total.num_mults += block.num_mults;
+    total.max_bytes_B_data += block.max_bytes_B_data;
+    total.B_data_max_reads += block.B_data_max_reads;
+    total.B_data_max_reads_fiber_cache += block.B_data_max_reads_fiber_cache;
+  }
+  for (const auto& block : B_blocks) {
+    total.min_bytes_B_data += block.min_bytes_B_data;
+    total.B_data_min_reads += block.B_data_min_reads;
+  }
+  num_mults = total.num_mults;
+  max_bytes_B_data = total.max_bytes_B_data;
+  B_data_max_reads = total.B_data_max_reads;
+  B_data_max_reads_fiber_cache = total.B_data_max_reads_fiber_cache;
+  min_bytes_B_data = total.min_bytes_B_data;
+  B_data_min_reads = total.B_data_min_reads;
+  const bool C_row_ptr_overflow = total.C_size > UINT32_MAX;
+  parallel_exclusive_scan(C_row_ptr.data(), C_row_ptr.size());
+  C.row_ptr = std::move(C_row_ptr);
+
+  // fill the preprocessed arrays at the offsets of each block
+  preproc_A_row_ptr.assign(total.num_rows + 1, 0);
+  preproc_A_row_idx.resize(total.num_rows);
+  preproc_C_row_ptr.resize(total.num_rows);
+  preproc_A_values.resize(total.num_elements);
+  preproc_B_row_ptr_end.resize(total.num_elements);
+  preproc_A_row_ptr.back() = static_cast<uint32_t>(total.num_elements);
+  parallel_blocks(A->num_rows, [&](std::size_t block_idx, std::size_t begin, std::size_t end) {
+    auto row = blocks[block_idx].num_rows;
+    auto element = blocks[block_idx].num_elements;
+    for (std::size_t i = begin; i != end; ++i) {
+      const auto row_begin = element;
+      for (unsigned j = A->row_ptr[i]; j < A->row_ptr[i + 1]; ++j) {
+        const unsigned B_row_ptr = B->row_ptr[A->col_idx[j]];
+        const unsigned B_row_end = B->row_ptr[A->col_idx[j] + 1];
+        if (B_row_ptr == B_row_end) continue;
+        preproc_A_values[element] = A->values[j];
+        preproc_B_row_ptr_end[element] = {B_row_ptr, B_row_end};
+        ++element;
+      }
+      if (element > row_begin) {
+        preproc_A_row_ptr[row] = static_cast<uint32_t>(row_begin);
+        preproc_A_row_idx[row] = static_cast<uint32_t>(i);
+        preproc_C_row_ptr[row] = C.row_ptr[i];
+        ++row;
+      }
+    }
+  }, min_rows_per_block);
   B_data_min_reads_fiber_cache *= 3;
   B_data_max_reads_fiber_cache *= 3;
-  fmt::print("Done\n");
+  if (verbose) { fmt::print("Done\n"); }
   if (C_row_ptr_overflow) {
-    fmt::print("Not enough space for the upper-bound method. Performing symbolic phase... ");
-    fflush(stdout);
+    if (verbose) {
+      fmt::print("Not enough space for the upper-bound method. Performing symbolic phase... ");
+      fflush(stdout);
+    }
     spGEMM_symbolic_phase(*A, *B, C);
-    C.row_end.clear();
-    fmt::print("Done\n");
-  }
-  if (compute_result) {
-    C.col_idx = std::vector<uint32_t>(C.row_ptr[C.num_rows]);
-    C.values = std::vector<double>(C.row_ptr[C.num_rows]);
+    for (std::size_t row = 0; row < preproc_A_row_idx.size(); ++row) {
+      preproc_C_row_ptr[row] = C.row_ptr[preproc_A_row_idx[row]];
+    }
+    if (verbose) { fmt::print("Done\n"); }
   }
   min_bytes_B_data *= (sizeof(int) + sizeof(double));
   max_bytes_B_data *= (sizeof(int) + sizeof(double));
 }
 
+void Matrix_Data::reorder_rows() {
+  if (verbose) {
+    fmt::print("Reordering the rows of A ({})... ", row_order_name(row_order));
+    fflush(stdout);
+  }
+  natural_reuse_distance = Reuse_Distance::compute(preproc_B_row_ptr_end);
+  // preprocessed row of each row of A, the empty rows aren't preprocessed
+  std::vector<uint32_t> preproc_row(A->num_rows, UINT32_MAX);
+  for (std::size_t row = 0; row < preproc_A_row_idx.size(); ++row) {
+    preproc_row[preproc_A_row_idx[row]] = static_cast<uint32_t>(row);
+  }
+  std::vector<uint32_t> A_row_ptr;
+  std::vector<uint32_t> A_row_idx;
+  std::vector<uint32_t> C_row_ptr;
+  std::vector<double> A_values;
+  std::vector<std::pair<uint32_t, uint32_t>> B_row_ptr_end;
+  A_row_ptr.reserve(preproc_A_row_ptr.size());
+  A_row_idx.reserve(preproc_A_row_idx.size());
+  C_row_ptr.reserve(preproc_C_row_ptr.size());
+  A_values.reserve(preproc_A_values.size());
+  B_row_ptr_end.reserve(preproc_B_row_ptr_end.size());
+  // the rows keep their rows of C, so only the order of the arrays changes
+  for (const auto i : order_rows(*A, row_order)) {
+    const auto row = preproc_row[i];
+    if (row == UINT32_MAX) continue;
+    A_row_ptr.push_back(static_cast<uint32_t>(A_values.size()));
+    A_row_idx.push_back(i);
+    C_row_ptr.push_back(preproc_C_row_ptr[row]);
+    for (auto j = preproc_A_row_ptr[row]; j < preproc_A_row_ptr[row + 1]; ++j) {
+      A_values.push_back(preproc_A_values[j]);
+      B_row_ptr_end.push_back(preproc_B_row_ptr_end[j]);
+    }
+  }
+  A_row_ptr.push_back(static_cast<uint32_t>(A_values.size()));
+  preproc_A_row_ptr = std::move(A_row_ptr);
+  preproc_A_row_idx = std::move(A_row_idx);
+  preproc_C_row_ptr = std::move(C_row_ptr);
+  preproc_A_values = std::move(A_values);
+  preproc_B_row_ptr_end = std::move(B_row_ptr_end);
+  reuse_distance = Reuse_Distance::compute(preproc_B_row_ptr_end);
+  if (verbose) { fmt::print("Done\n"); }
+}
+
+void Matrix_Data::print_row_order(std::ostream& os) const {
+  if (row_order == Row_Order::natural) { return; }
+  fmt::print(os, "*---Row Order---*\n");
+  fmt::print(os, "Row order: {}\n", row_order_name(row_order));
+  fmt::print(os, "B row reuses: {} of {} uses\n", reuse_distance.num_reuses,
+             reuse_distance.num_uses);
+  fmt::print(os, "Median B row reuse distance: {} elements ({} in natural order)\n",
+             reuse_distance.median, natural_reuse_distance.median);
+  fmt::print(os, "Mean B row reuse distance: {:.1f} elements ({:.1f} in natural order)\n",
+             reuse_distance.mean, natural_reuse_distance.mean);
+}
+
 void Matrix_Data::set_physical_addrs() {
   Address addr {0UL};
   B_elements_addr = addr;
@@ -132,71 +306,145 @@ void Matrix_Data::set_physical_addrs() {
   C_partials_base_addr = round_up_multiple(addr, 96ul);
 }
 
-bool Matrix_Data::spGEMM_check_result() {
-  using pi = std::pair<uint32_t, uint32_t>;
-
-  fmt::print("Checking result... ");
-  fflush(stdout);
-  uint32_t max_row_size {0};
-  for (unsigned i = 0; i < A->num_rows; ++i) {
-    if (max_row_size < A->row_ptr[i+1] - A->row_ptr[i]) {
-      max_row_size = A->row_ptr[i+1] - A->row_ptr[i];
-    }
-  }
-  std::vector<uint32_t> B_row_addr(max_row_size);
-  std::vector<uint32_t> B_row_end(max_row_size);
-  std::vector<double> A_values(max_row_size);
-  std::priority_queue<pi, std::vector<pi>, std::greater<pi>> heap;
+std::vector<std::pair<std::string, Address>> Matrix_Data::address_regions() const {
+  return {{"B data", B_elements_addr},
+          {"C data", C_row_ptr_addr},
+          {"A data", preproc_A_row_ptr_addr},
+          {"C partial", C_partials_base_addr}};
+}
 
-  for (unsigned i = 0; i < A->num_rows; ++i) {
-    uint32_t cur_idx = UINT32_MAX;
-    double cur_value = 0.0;
-    uint32_t offset = C.row_ptr[i];
-    for (unsigned j = 0; j < A->row_ptr[i+1] - A->row_ptr[i]; ++j) {
-      B_row_addr[j] = B->row_ptr[A->col_idx[A->row_ptr[i] + j]];
-      B_row_end[j] = B->row_ptr[A->col_idx[A->row_ptr[i] + j] + 1];
-      A_values[j] = A->values[A->row_ptr[i] + j];
-      if (B_row_addr[j] < B_row_end[j]) {
-        heap.push(std::make_pair(B->col_idx[B_row_addr[j]], j));
-      }
+namespace {
+
+// rows with fewer than num_cols / check_hash_min_sparsity products are
+// accumulated in a hash table instead of the dense accumulator
+constexpr std::size_t check_hash_min_sparsity {16};
+
+// accumulators of a worker of the result check, allocated on first use and
+// reused for all the rows that the worker checks
+struct Check_Scratch {
+  std::vector<double> accumulator;
+  // row of A that last wrote each column of the accumulator
+  std::vector<uint32_t> accumulator_row;
+  // open addressing with linear probing, at most half full
+  std::vector<uint32_t> hash_cols;
+  std::vector<double> hash_values;
+  std::vector<uint32_t> row_cols;
+};
+
+// Computes the rows [begin, end) of A*B with Gustavson's algorithm, and
+// returns an error message for each row that differs in C. The products of a
+// column are accumulated in the order of the row of A.
+std::vector<std::string> check_result_rows(const Spmat_Csr& A, const Spmat_Csr& B,
+                                           const Spmat_Csr& C, uint32_t begin,
+                                           uint32_t end, Check_Scratch& scratch)
+{
+  std::vector<std::string> errors;
+  auto& accumulator = scratch.accumulator;
+  auto& accumulator_row = scratch.accumulator_row;
+  auto& hash_cols = scratch.hash_cols;
+  auto& hash_values = scratch.hash_values;
+  auto& row_cols = scratch.row_cols;
+  for (uint32_t i = begin; i < end; ++i) {
+    row_cols.clear();
+    std::size_t flops {0};
+    for (uint32_t j = A.row_ptr[i]; j < A.row_ptr[i+1]; ++j) {
+      flops += B.row_ptr[A.col_idx[j] + 1] - B.row_ptr[A.col_idx[j]];
     }
-    while (!heap.empty()) {
-      pi min = heap.top();
-      heap.pop();
-      if(min.first == cur_idx) {
-        //cur_value += A_values[min.second] * B->values[B_row_addr[min.second]];
-        cur_value = std::fma(A_values[min.second], B->values[B_row_addr[min.second]], cur_value);
+    const bool hash_row = flops * check_hash_min_sparsity < B.num_cols;
+    const auto table_size = hash_row ? std::bit_ceil(2 * flops) : std::size_t{0};
+    const auto mask = table_size - 1;
+    // slot of the column in the hash table, or the empty slot where it goes
+    const auto hash_slot = [&](uint32_t col) {
+      auto slot = (std::size_t{col} * 2654435761U) & mask;
+      while (hash_cols[slot] != UINT32_MAX && hash_cols[slot] != col) {
+        slot = (slot + 1) & mask;
       }
-      else {
-        if(cur_idx != UINT32_MAX) {
-          if (C.col_idx[offset] != cur_idx || !almost_equal(C.values[offset], cur_value, 1e6)) {
-            fmt::print("\nError in row {}: {}, {} should be {}, {}\n",
-              i, C.col_idx[offset], C.values[offset], cur_idx, cur_value);
-            return false;
+      return slot;
+    };
+    if (hash_row) {
+      if (hash_cols.size() < table_size) {
+        hash_cols.resize(table_size);
+        hash_values.resize(table_size);
+      }
+      std::fill_n(hash_cols.begin(), table_size, UINT32_MAX);
+    } else if (accumulator.size() != B.num_cols) {
+      accumulator.assign(B.num_cols, 0.0);
+      accumulator_row.assign(B.num_cols, UINT32_MAX);
+    }
+    for (uint32_t j = A.row_ptr[i]; j < A.row_ptr[i+1]; ++j) {
+      const auto A_value = A.values[j];
+      const auto B_row = A.col_idx[j];
+      for (uint32_t k = B.row_ptr[B_row]; k < B.row_ptr[B_row+1]; ++k) {
+        const auto col = B.col_idx[k];
+        if (hash_row) {
+          const auto slot = hash_slot(col);
+          if (hash_cols[slot] != col) {
+            hash_cols[slot] = col;
+            hash_values[slot] = A_value * B.values[k];
+            row_cols.push_back(col);
+          } else {
+            hash_values[slot] = std::fma(A_value, B.values[k], hash_values[slot]);
           }
-          ++offset;
+        } else if (accumulator_row[col] != i) {
+          accumulator_row[col] = i;
+          accumulator[col] = A_value * B.values[k];
+          row_cols.push_back(col);
+        } else {
+          accumulator[col] = std::fma(A_value, B.values[k], accumulator[col]);
         }
-        cur_idx = min.first;
-        cur_value = A_values[min.second] * B->values[B_row_addr[min.second]];
       }
-      ++B_row_addr[min.second];
-      if(B_row_addr[min.second] < B_row_end[min.second])
-        heap.push(std::make_pair(B->col_idx[B_row_addr[min.second]], min.second));
     }
-    if (cur_idx != UINT32_MAX) {
-      if (C.col_idx[offset] != cur_idx || !almost_equal(C.values[offset], cur_value, 1e6)) {
-        fmt::print("\nError in row {}: {}, {} should be {}, {}\n",
-          i, C.col_idx[offset], C.values[offset], cur_idx, cur_value);
-        return false;
+    std::ranges::sort(row_cols);
+    uint32_t offset = C.row_ptr[i];
+    bool row_error {false};
+    for (const auto col : row_cols) {
+      const auto value = hash_row ? hash_values[hash_slot(col)] : accumulator[col];
+      if (C.col_idx[offset] != col || !almost_equal(C.values[offset], value, 1e6)) {
+        errors.push_back(fmt::format("Error in row {}: {}, {} should be {}, {}", i,
+                                     C.col_idx[offset], C.values[offset], col, value));
+        row_error = true;
+        break;
       }
       ++offset;
     }
-    if (offset != C.row_end[i]) {
-      fmt::print("\nError in row end {}: {} should be {}\n", i, C.row_end[i], offset);
-      return false;
+    if (!row_error && offset != C.row_end[i]) {
+      errors.push_back(fmt::format("Error in row end {}: {} should be {}", i,
+                                   C.row_end[i], offset));
     }
   }
-  fmt::print("Correct!\n");
+  return errors;
+}
+
+} // namespace
+
+bool Matrix_Data::spGEMM_check_result() {
+  if (verbose) {
+    fmt::print("Checking result... ");
+    fflush(stdout);
+  }
+  // rows are checked in many more chunks than threads, so that the rows with
+  // most products don't end up in a single thread
+  const auto num_chunks = num_parallel_blocks(A->num_rows, 256, 16 * num_threads());
+  const auto num_workers = std::min<std::size_t>(num_threads(), num_chunks);
+  std::vector<std::vector<std::string>> errors(num_chunks);
+  std::vector<Check_Scratch> scratch(num_workers);
+  parallel_jobs(num_chunks, [&](std::size_t worker, std::size_t chunk) {
+    const auto begin = static_cast<uint32_t>(A->num_rows * chunk / num_chunks);
+    const auto end = static_cast<uint32_t>(A->num_rows * (chunk + 1) / num_chunks);
+    errors[chunk] = check_result_rows(*A, *B, C, begin, end, scratch[worker]);
+  }, num_workers);
+  std::size_t num_wrong_rows {};
+  for (const auto& chunk_errors : errors) {
+    for (const auto& error : chunk_errors) {
+      fmt::print("\n{}", error);
+    }
+    num_wrong_rows += chunk_errors.size();
+  }
+  if (num_wrong_rows > 0) {
+    fmt::print("\n{} of {} rows are wrong\n", num_wrong_rows, A->num_rows);
+    return false;
+  }
+  if (verbose) { fmt::print("Correct!\n"); }
   return true;
 }
 
@@ -1,18 +1,78 @@
 #ifndef MERGEFOREST_SIM_MAT_DATA_HPP
 #define MERGEFOREST_SIM_MAT_DATA_HPP
 
-#include <cstddef>
+#include <mergeforest-sim/array_fetcher.hpp>
+#include <mergeforest-sim/host_metrics.hpp>
 #include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/row_order.hpp>
 #include <mergeforest-sim/sparse_matrix.hpp>
 
+#include <ostream>
+#include <string>
 #include <vector>
 #include <utility>
+#include <cstddef>
+#include <cstdint>
 
 namespace mergeforest_sim {
 
+// Cycles and memory transactions of a simulation in the first cycles in
+// which its number of multiplications reached begin_mults and end_mults.
+// Used by the sampled simulation to measure a window of rows of A without
+// the rows simulated before it to warm up the caches.
+struct Measured_Interval {
+  struct Point {
+    std::size_t cycles {};
+    std::size_t mem_reads {};
+    std::size_t mem_writes {};
+  };
+
+  void measure(std::size_t begin_mults_, std::size_t end_mults_) {
+    begin_mults = begin_mults_;
+    end_mults = end_mults_;
+    next_mults = begin_mults;
+    num_points = 0;
+  }
+
+  // called by the simulation loops when num_mults >= next_mults
+  void record(std::size_t num_mults, const Point& point) {
+    if (num_points == 0 && num_mults >= begin_mults) {
+      begin = point;
+      ++num_points;
+      next_mults = end_mults;
+    }
+    if (num_points == 1 && num_mults >= end_mults) {
+      end = point;
+      ++num_points;
+      next_mults = SIZE_MAX;
+    }
+  }
+
+  bool finished() const { return num_points == 2; }
+
+  std::size_t begin_mults {SIZE_MAX};
+  std::size_t end_mults {SIZE_MAX};
+  std::size_t next_mults {SIZE_MAX};
+  Point begin;
+  Point end;
+  unsigned num_points {};
+};
+
 struct Matrix_Data {
+  // loads the preprocessed data from the preprocessing cache if possible,
+  // otherwise computes it, and allocates the result matrix
   void preprocess_mats();
+  // computes the architecture independent preprocessed data
+  void compute_preprocessed_data();
+  // processes the preprocessed rows in row_order instead of in row order
+  void reorder_rows();
+  // B row reuse distances before and after reordering, if the rows are
+  // reordered
+  void print_row_order(std::ostream& os) const;
   void set_physical_addrs();
+  // names and start addresses of the regions of memory of A, B, C and the C
+  // partial rows, in increasing address order
+  std::vector<std::pair<std::string, Address>> address_regions() const;
   bool spGEMM_check_result();
   // pointers to matrix objects
   const Spmat_Csr* A {nullptr};
@@ -20,12 +80,26 @@ struct Matrix_Data {
   // result matrix
   Spmat_Csr C;
   bool compute_result {};
+  // print progress messages to stdout
+  bool verbose {true};
+  // print the stats at the end of the simulation
+  bool print_results {true};
+  // directory of the preprocessing cache, no cache is used if empty
+  std::string preproc_cache_dir;
+  Row_Order row_order {Row_Order::natural};
+  Reuse_Distance natural_reuse_distance;
+  Reuse_Distance reuse_distance;
   // preprocessed arrays
   std::vector<uint32_t> preproc_A_row_ptr;
   std::vector<uint32_t> preproc_A_row_idx;
   std::vector<uint32_t> preproc_C_row_ptr;
   std::vector<double> preproc_A_values;
   std::vector<std::pair<uint32_t, uint32_t>> preproc_B_row_ptr_end;
+  // with several MergeForest cores, the preprocessed arrays of a core only
+  // have the rows given to it, which are read from the arrays of all the
+  // rows: segments of its rows and of its elements in those arrays
+  std::vector<Fetch_Segment> preproc_row_segments;
+  std::vector<Fetch_Segment> preproc_element_segments;
   // physical addresses of the matrix arrays
   Address B_elements_addr {invalid_address};
   Address C_row_ptr_addr {invalid_address};
@@ -44,6 +118,12 @@ struct Matrix_Data {
   std::size_t min_bytes_B_data {};
   std::size_t max_bytes_B_data {};
   std::size_t num_mults {};
+  // wall time and memory used by the simulator
+  Host_Metrics host_metrics;
+  // B rows used, in order, by the rows of the matrix before A, with which
+  // the caches are warmed up before the simulation starts
+  std::vector<std::pair<uint32_t, uint32_t>> warmup_B_row_ptr_end;
+  Measured_Interval measured;
 };
 
 } // namespace mergeforest_sim
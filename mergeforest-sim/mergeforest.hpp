@@ -6,25 +6,79 @@
 #include <mergeforest-sim/main_memory.hpp>
 #include <mergeforest-sim/matrix_data.hpp>
 #include <mergeforest-sim/sparse_matrix.hpp>
+#include <mergeforest-sim/time_series.hpp>
 
 #include <toml.hpp>
 
+#include <deque>
 #include <string>
 #include <iostream>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 
 namespace mergeforest_sim {
 
+// With num_cores > 1, several cores, each with its own merge tree manager
+// and linked list cache, share the main memory and process different rows
+// of A, given to them with row_distribution:
+// - blocks: one block of consecutive rows per core, with about the same
+//   number of multiplications
+// - round_robin: chunks of row_chunk_size rows given to the cores in turns
+// - dynamic: chunks of row_chunk_size rows taken by the cores from a shared
+//   queue when they hold less than max_core_chunks chunks to multiply
 class MergeForest {
 public:
   MergeForest(const toml::value& parsed_config, Matrix_Data& matrix_data_,
 	  const std::string& out_path_);
   Spmat_Csr run_simulation(bool compute_result);
+  void print_stats(std::ostream& os);
 private:
+  enum class Row_Distribution { blocks, round_robin, dynamic };
+
+  // preprocessed rows [begin_row, end_row)
+  struct Row_Chunk {
+    uint32_t begin_row {};
+    uint32_t end_row {};
+    std::size_t num_mults {};
+  };
+
+  struct Core {
+    Core(const toml::value& parsed_config, Matrix_Data& data_);
+
+    // matrix_data with a single core, otherwise only has the rows of the core
+    Matrix_Data& data;
+    mergeforest::Merge_Tree_Manager merge_tree_manager;
+    mergeforest::Linked_List_Cache linked_list_cache;
+    // multiplications at the end of the chunks not multiplied yet
+    std::deque<std::size_t> chunk_end_mults;
+    std::size_t num_rows {};
+    // cycles until the core finished its last row
+    std::size_t busy_cycles {};
+  };
+
+  static constexpr std::size_t max_core_chunks = 2;
+
+  void get_config_params();
   void reset();
+  void distribute_rows();
+  void init_core_data(Matrix_Data& data) const;
+  void give_chunk(Core& core, const Row_Chunk& chunk);
+  // returns true if a core took a chunk from the queue
+  bool give_dynamic_chunks();
+  bool cores_finished();
+  bool cores_idle() const;
+  template<bool profile> void simulation_loop();
+  void skip_idle_cycles();
   void print_progress();
   void check_valid_simulation();
   void print_stats();
-  void print_stats_impl(std::ostream& os);
+  void print_cores_stats(std::ostream& os) const;
+  // sum and maximum of the stats of the cores
+  std::size_t cores_total(std::size_t mergeforest::Merge_Tree_Manager::* stat) const;
+  std::size_t cores_total(std::size_t mergeforest::Linked_List_Cache::* stat) const;
+  std::size_t cores_max(std::size_t mergeforest::Merge_Tree_Manager::* stat) const;
+  std::size_t cores_max(std::size_t mergeforest::Linked_List_Cache::* stat) const;
 
   const std::size_t progress_interval = 10000;
   const toml::value& parsed_config;
@@ -32,11 +86,19 @@ private:
 
   const std::string& out_path;
   // system components
-  mergeforest::Merge_Tree_Manager merge_tree_manager;
-  mergeforest::Linked_List_Cache linked_list_cache;
+  std::deque<Matrix_Data> cores_data;
+  std::deque<Core> cores;
   Main_Memory main_mem;
+  Time_Series_Writer time_series;
 
+  // queue of the dynamic row distribution
+  std::vector<Row_Chunk> row_chunks;
+  std::size_t next_row_chunk {};
   std::size_t cycles {};
+  // config parameters
+  unsigned num_cores {};
+  Row_Distribution row_distribution {};
+  unsigned row_chunk_size {};
 };
 
 } // namespace mergeforest_sim
@@ -3,6 +3,8 @@
 
 #include <algorithm>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <climits>
 #include <cassert>
 #include <toml/get.hpp>
@@ -23,7 +25,8 @@ bool Inactive_Row::valid() const {
 Linked_List_Cache::Linked_List_Cache(const toml::value& parsed_config,
 				     const Matrix_Data& matrix_data_)
   : matrix_data{matrix_data_}
-  , B_row_ptr_end_fetcher{matrix_data_.preproc_B_row_ptr_end}
+  , B_row_ptr_end_fetcher{matrix_data_.preproc_B_row_ptr_end,
+                          &matrix_data_.preproc_element_segments}
 {
   get_config_params(parsed_config);
 }
@@ -41,6 +44,10 @@ void Linked_List_Cache::reset() {
   pending_reqs.clear();
   for (auto& i : finished_reqs) { i.clear(); }
 
+  // the B rows are known after preprocessing the matrices
+  if (belady_replacement) { compute_next_uses(); }
+  next_ref = 0;
+  furthest_inactive_rows = {};
   active_rows.clear();
   std::ranges::fill(inactive_rows_cache, Inactive_Row{});
   for (unsigned i = 0; i < row_data_list.size() - 1; ++i) {
@@ -49,7 +56,8 @@ void Linked_List_Cache::reset() {
     row_data_list[i].last = false;
   }
   row_data_list.back() = {0, UINT_MAX, true, false};
-  free_list_heads = {0};
+  free_list_heads.clear();
+  free_list_heads.push_back(0);
   C_partial_row_ptr = UINT_MAX;
   inactive_rows_list_head = UINT_MAX;
   inactive_rows_list_tail = UINT_MAX;
@@ -60,6 +68,7 @@ void Linked_List_Cache::reset() {
   num_free_blocks = row_data_list.size();
   num_fetching_blocks = 0;
   cycles = 0;
+  active = false;
 
   reads = 0;
   writes = 0;
@@ -80,7 +89,26 @@ void Linked_List_Cache::reset() {
   stats_max_outstanding_reqs = 0;
 }
 
+void Linked_List_Cache::warm_up(const std::vector<std::pair<uint32_t, uint32_t>>& B_row_ptr_end) {
+  // the next use of the warm-up rows is their first use in the simulation
+  Flat_Map<uint32_t, std::size_t, UINT32_MAX> first_uses;
+  if (belady_replacement) {
+    const auto& B_rows = matrix_data.preproc_B_row_ptr_end;
+    for (std::size_t i = 0; i < B_rows.size(); ++i) {
+      if (!first_uses.contains(B_rows[i].first)) { first_uses.insert(B_rows[i].first, i); }
+    }
+  }
+  for (const auto& [B_row_ptr, B_row_end] : B_row_ptr_end) {
+    const auto* first_use = first_uses.find(B_row_ptr);
+    warm_up_row(B_row_ptr, B_row_end, first_use == nullptr ? SIZE_MAX : *first_use);
+  }
+  evictions = 0;
+  max_free_lists = 0;
+  stats_max_inactive_rows = num_inactive_rows;
+}
+
 void Linked_List_Cache::update() {
+  active = false;
   // send requests of B matrix data to main memory
   for (unsigned i = 0; i < mem_ports.size() - 1; ++i) {
     if (!mem_ports[i].has_msg_send()) {
@@ -90,21 +118,23 @@ void Linked_List_Cache::update() {
         stats_max_outstanding_reqs = std::max(matB_fetcher.num_outstanding_reqs,
 					      stats_max_outstanding_reqs);
 	++B_reads;
+        active = true;
       }
     }
-    mem_ports[i].transfer();
+    if (mem_ports[i].transfer()) { active = true; }
   }
   if (!mem_ports.back().has_msg_send()) {
     const Address addr = B_row_ptr_end_fetcher.get_fetch_address();
     if (addr != invalid_address) {
       mem_ports.back().add_msg_send({.address = addr, .is_write = false});
       ++preproc_A_reads;
+      active = true;
     }
   }
-  mem_ports.back().transfer();
+  if (mem_ports.back().transfer()) { active = true; }
   // send prefetched B_row_ptrs
   if (!prefetch_port.has_msg_send()) {
-    std::vector<Prefetched_Row> prefetched_rows;
+    Prefetched_Rows prefetched_rows;
     for (unsigned i = 0; i < prefetched_rows_per_cycle; ++i) {
       if (B_row_ptr_end_fetcher.num_elements == 0) break;
       const auto B_row_ptr_end = B_row_ptr_end_fetcher.front();
@@ -115,10 +145,11 @@ void Linked_List_Cache::update() {
       prefetched_rows.emplace_back(B_row_ptr_end.first, B_row_head_ptr);
     }
     if (!prefetched_rows.empty()) {
-      prefetch_port.add_msg_send(prefetched_rows);
+      prefetch_port.add_msg_send(std::move(prefetched_rows));
+      active = true;
     }
   }
-  prefetch_port.transfer();
+  if (prefetch_port.transfer()) { active = true; }
   if (cycles == 0) {
     sample_cache_utilization();
   } 
@@ -133,11 +164,13 @@ void Linked_List_Cache::apply() {
     if (!mem_ports[i].msg_received_valid()) continue;
     matB_fetcher.put_response(mem_ports[i].get_msg_received());
     mem_ports[i].clear_msg_received();
+    active = true;
   }
   if (mem_ports.back().msg_received_valid()) {
     const auto mem_response = mem_ports.back().get_msg_received();
     B_row_ptr_end_fetcher.receive_data(mem_response.address);
     mem_ports.back().clear_msg_received();
+    active = true;
   }
   receive_read_requests();
   send_read_responses();
@@ -145,6 +178,7 @@ void Linked_List_Cache::apply() {
   if (write_port.msg_received_valid()) {
     const unsigned response = write_C_partial_row(write_port.get_msg_received());
     write_port.clear_msg_received();
+    active = true;
     if (response != UINT_MAX) {
       assert(!write_port.has_msg_send());
       write_port.add_msg_send(response);
@@ -152,9 +186,26 @@ void Linked_List_Cache::apply() {
   }
   // update slave ports
   for (auto& port : read_ports) {
-    port.transfer();
+    if (port.transfer()) { active = true; }
   }
-  write_port.transfer();
+  if (write_port.transfer()) { active = true; }
+}
+
+bool Linked_List_Cache::idle() const {
+  return !active;
+}
+
+void Linked_List_Cache::skip_cycles(std::size_t num_cycles) {
+  // the sampled values don't change in idle cycles
+  const auto num_skipped_samples = (cycles + num_cycles + sample_interval - 1) / sample_interval
+    - (cycles + sample_interval - 1) / sample_interval;
+  for (std::size_t i = 0; i < num_skipped_samples; ++i) {
+    sample_cache_utilization();
+  }
+  cycles = static_cast<unsigned>((cycles + num_cycles) % sample_interval);
+  // send_read_responses moves the arbiter even if there are no responses
+  const auto arbiter_step = std::min<std::size_t>(read_ports.size(), num_banks);
+  arbiter = (arbiter + num_cycles % read_ports.size() * arbiter_step) % read_ports.size();
 }
 
 Linked_List_Cache::Mem_Port* Linked_List_Cache::get_mem_port(std::size_t id) {
@@ -180,6 +231,19 @@ std::size_t Linked_List_Cache::num_mem_ports() const {
   return mem_ports.size();
 }
 
+void Linked_List_Cache::add_time_series_columns(Time_Series_Writer& time_series) const {
+  time_series.add_counter("cache_reads", &reads);
+  time_series.add_counter("cache_writes", &writes);
+  time_series.add_counter("B_reads", &B_reads);
+  time_series.add_counter("C_partial_reads", &C_partial_reads);
+  time_series.add_counter("C_partial_writes", &C_partial_writes);
+  time_series.add_counter("evictions", &evictions);
+  time_series.add_gauge("active_blocks", &num_active_blocks);
+  time_series.add_gauge("inactive_blocks", &num_inactive_blocks);
+  time_series.add_gauge("C_partial_blocks", &num_C_partial_blocks);
+  time_series.add_gauge("free_blocks", &num_free_blocks);
+}
+
 void Linked_List_Cache::get_config_params(const toml::value& parsed_config) {
   const auto num_mem_ports = toml::find_or(parsed_config, "linked_list_cache",
                                            "num_mem_ports", 4U);
@@ -188,6 +252,7 @@ void Linked_List_Cache::get_config_params(const toml::value& parsed_config) {
                                                "merge_tree_manager",
                                                "num_merge_trees");
   read_ports = std::vector<Cache_Read_Port>(num_cache_read_ports);
+  pending_reqs.reserve(num_cache_read_ports);
   finished_reqs.assign(num_cache_read_ports, {});
   const auto max_rows_fetch = toml::find<std::size_t>(parsed_config,
                                                       "linked_list_cache",
@@ -207,6 +272,7 @@ void Linked_List_Cache::get_config_params(const toml::value& parsed_config) {
   inactive_rows_assoc = toml::find_or(parsed_config, "linked_list_cache",
                                       "inactive_rows_assoc", 16u);
   inactive_rows_num_sets = max_inactive_rows / inactive_rows_assoc;
+  active_rows.reserve(max_active_rows);
   num_banks = toml::find_or(parsed_config, "linked_list_cache", "num_banks", num_cache_read_ports);
   matB_fetcher.max_outstanding_reqs = toml::find_or(parsed_config,
                                                     "linked_list_cache",
@@ -214,18 +280,48 @@ void Linked_List_Cache::get_config_params(const toml::value& parsed_config) {
                                                     800U);
   prefetched_rows_per_cycle = toml::find_or(parsed_config, "linked_list_cache",
                                             "prefetched_rows_per_cycle", 4U);
+  if (prefetched_rows_per_cycle > max_prefetched_rows_per_cycle) {
+    throw std::runtime_error("linked_list_cache.prefetched_rows_per_cycle is larger than "
+                             + std::to_string(max_prefetched_rows_per_cycle) + "\n");
+  }
   sample_interval = toml::find_or(parsed_config, "linked_list_cache",
                                             "sample_interval", 10000U);
+  const auto replacement = toml::find_or<std::string>(parsed_config, "linked_list_cache",
+                                                      "replacement", "lru");
+  if (replacement != "lru" && replacement != "belady") {
+    throw std::runtime_error("Unknown linked list cache replacement " + replacement + "\n");
+  }
+  belady_replacement = replacement == "belady";
+}
+
+void Linked_List_Cache::compute_next_uses() {
+  const auto& B_rows = matrix_data.preproc_B_row_ptr_end;
+  next_uses.assign(B_rows.size(), SIZE_MAX);
+  Flat_Map<uint32_t, std::size_t, UINT32_MAX> last_uses;
+  for (auto i = B_rows.size(); i-- > 0;) {
+    if (auto* last_use = last_uses.find(B_rows[i].first)) {
+      next_uses[i] = *last_use;
+      *last_use = i;
+    } else {
+      last_uses.insert(B_rows[i].first, i);
+    }
+  }
+}
+
+std::size_t Linked_List_Cache::next_use(std::size_t ref) const {
+  return next_uses.empty() ? SIZE_MAX : next_uses[ref];
 }
 
 
 unsigned Linked_List_Cache::add_new_row(uint32_t B_row_ptr, uint32_t B_row_end) {
-  auto it = active_rows.find(B_row_ptr);
+  const auto row_next_use = next_use(next_ref);
   // search row in the active rows hash table
-  if (it != active_rows.end()) {
-    ++(it->second.num_uses);
+  if (auto* active_row = active_rows.find(B_row_ptr)) {
+    ++(active_row->num_uses);
+    active_row->next_use = row_next_use;
     ++reused_rows;
-    return it->second.row_head;
+    ++next_ref;
+    return active_row->row_head;
   }
   if (active_rows.size() == max_active_rows) return UINT_MAX;
   // search row in inactive rows cache
@@ -234,7 +330,8 @@ unsigned Linked_List_Cache::add_new_row(uint32_t B_row_ptr, uint32_t B_row_end)
     auto& inactive_row = inactive_rows_cache[index * inactive_rows_assoc + i];
     if (inactive_row.B_row_ptr != B_row_ptr) continue;
     // move row to active rows hash table
-    active_rows[B_row_ptr] = {inactive_row.row_head, 1, inactive_row.num_blocks};
+    const auto row_head = inactive_row.row_head;
+    active_rows.insert(B_row_ptr, {row_head, 1, inactive_row.num_blocks, row_next_use});
     stats_max_active_rows = std::max(stats_max_active_rows, active_rows.size());
     num_active_blocks += inactive_row.num_blocks;
     num_inactive_blocks -= inactive_row.num_blocks;
@@ -242,7 +339,8 @@ unsigned Linked_List_Cache::add_new_row(uint32_t B_row_ptr, uint32_t B_row_end)
            + num_free_blocks <= row_data_list.size());
     inactive_rows_list_remove(index * inactive_rows_assoc + i);
     ++reused_rows;
-    return active_rows[B_row_ptr].row_head;
+    ++next_ref;
+    return row_head;
   }
   // add new row to the cache
   if (!matB_fetcher.can_accept_row()) return UINT_MAX;
@@ -259,17 +357,19 @@ unsigned Linked_List_Cache::add_new_row(uint32_t B_row_ptr, uint32_t B_row_end)
   matB_fetcher.add_row(begin, end, ptr);
   stats_max_fetched_rows = std::max(matB_fetcher.num_rows_fetch,
                                     stats_max_fetched_rows);
-  active_rows[B_row_ptr] = {ptr, 1, row_num_blocks};
+  active_rows.insert(B_row_ptr, {ptr, 1, row_num_blocks, row_next_use});
   stats_max_active_rows = std::max(stats_max_active_rows, active_rows.size());
   num_fetching_blocks += row_num_blocks;
   assert(num_free_blocks + num_inactive_blocks >= num_fetching_blocks);
   ++fetched_rows;
+  ++next_ref;
   return ptr;
 }
 
 void Linked_List_Cache::write_B_row_data() {
   for (auto& row_fetcher : matB_fetcher.row_fetchers) {
     auto [num_elements, ptr, last] = row_fetcher.get_data();
+    if (ptr != UINT_MAX) { active = true; }
     if (num_elements == 0) continue;
     assert(num_fetching_blocks > 0);
     --num_fetching_blocks;
@@ -303,7 +403,7 @@ void Linked_List_Cache::receive_read_requests() {
     if (row_block.num_elements == 0
         || (row_block.last == false && row_block.next == UINT_MAX))
     {
-      pending_reqs.emplace(request.row_ptr, std::make_pair(i, request.id));
+      pending_reqs[request.row_ptr].emplace_back(i, request.id);
     } else {
       Cache_Response response = {.row_ptr = row_block.next,
                                  .num_elements = row_block.num_elements,
@@ -314,6 +414,7 @@ void Linked_List_Cache::receive_read_requests() {
     }
     read_ports[i].clear_msg_received();
     ++reads;
+    active = true;
   }
 }
 
@@ -325,6 +426,7 @@ void Linked_List_Cache::send_read_responses() {
       assert(!read_ports[arbiter].has_msg_send());
       read_ports[arbiter].add_msg_send(finished_reqs[arbiter].front());
       finished_reqs[arbiter].pop_front(); 
+      active = true;
     }
     ++num_responses;
     if (num_responses == num_banks) { break; }
@@ -332,12 +434,14 @@ void Linked_List_Cache::send_read_responses() {
 }
 
 void Linked_List_Cache::finish_pending_reqs(unsigned ptr) {
-  for (auto [it, end] = pending_reqs.equal_range(ptr); it != end; ++it) {
+  const auto* reqs = pending_reqs.find(ptr);
+  if (reqs == nullptr) { return; }
+  for (const auto& [port, id] : *reqs) {
     Cache_Response response{.row_ptr = row_data_list[ptr].next,
                             .num_elements = row_data_list[ptr].num_elements,
-                            .id = it->second.second};
+                            .id = id};
     if (row_data_list[ptr].last) { response.row_ptr = UINT_MAX; }
-    finished_reqs[it->second.first].push_back(response);
+    finished_reqs[port].push_back(response);
     update_cache_block(ptr);
   }
   pending_reqs.erase(ptr);
@@ -364,12 +468,13 @@ void Linked_List_Cache::update_cache_block(unsigned ptr) {
     }
   } else if (row_data_list[ptr].last) {
     // decrease number of uses in active rows
-    auto it = active_rows.find(row_data_list[ptr].next);
-    assert(it != active_rows.end());
-    --(it->second.num_uses);
-    if (it->second.num_uses == 0) {
-      add_to_inactive_rows(*it);
-      active_rows.erase(it);
+    const auto B_row_ptr = row_data_list[ptr].next;
+    auto* active_row = active_rows.find(B_row_ptr);
+    assert(active_row != nullptr);
+    --(active_row->num_uses);
+    if (active_row->num_uses == 0) {
+      add_to_inactive_rows(B_row_ptr, *active_row);
+      active_rows.erase(B_row_ptr);
     }
   }
 }
@@ -425,49 +530,61 @@ unsigned Linked_List_Cache::allocate_block() {
 bool Linked_List_Cache::free_inactive_row() {
   if (inactive_rows_list_head == UINT_MAX) return false;
   assert(free_list_heads.empty());
-  assert(inactive_rows_cache[inactive_rows_list_head].B_row_ptr != UINT_MAX);
-  assert(num_inactive_blocks >= inactive_rows_cache[inactive_rows_list_head].num_blocks);
-  num_inactive_blocks -= inactive_rows_cache[inactive_rows_list_head].num_blocks;
-  num_free_blocks += inactive_rows_cache[inactive_rows_list_head].num_blocks;
+  evict_inactive_row(belady_replacement ? furthest_inactive_row() : inactive_rows_list_head);
+  return true;
+}
+
+void Linked_List_Cache::evict_inactive_row(unsigned ptr) {
+  const auto& inactive_row = inactive_rows_cache[ptr];
+  assert(inactive_row.valid());
+  assert(num_inactive_blocks >= inactive_row.num_blocks);
+  num_inactive_blocks -= inactive_row.num_blocks;
+  num_free_blocks += inactive_row.num_blocks;
   assert(num_active_blocks + num_inactive_blocks + num_C_partial_blocks
          + num_free_blocks <= row_data_list.size());
-  assert(num_inactive_rows > 0);
-  --num_inactive_rows;
+  free_list_heads.emplace_back(inactive_row.row_head);
+  inactive_rows_list_remove(ptr);
   ++evictions;
-  free_list_heads.emplace_back(
-    inactive_rows_cache[inactive_rows_list_head].row_head);
-  unsigned ptr = inactive_rows_list_head;
-  inactive_rows_list_head = inactive_rows_cache[inactive_rows_list_head].next;
-  inactive_rows_cache[ptr] = Inactive_Row{};
-  if (inactive_rows_list_head == UINT_MAX) {
-    assert(num_inactive_rows == 1);
-    inactive_rows_list_tail = UINT_MAX;
-  } else {
-    inactive_rows_cache[inactive_rows_list_head].prev = UINT_MAX;
-  }
   max_free_lists = std::max(max_free_lists, free_list_heads.size());
-  return true;
 }
 
-void Linked_List_Cache::add_to_inactive_rows(
-  const std::pair<uint32_t, Active_Row>& active_row)
+unsigned Linked_List_Cache::furthest_inactive_row() {
+  // skip the entries of the rows that were reused or evicted
+  while (true) {
+    assert(!furthest_inactive_rows.empty());
+    const auto [use, ptr] = furthest_inactive_rows.top();
+    furthest_inactive_rows.pop();
+    const auto& inactive_row = inactive_rows_cache[ptr];
+    if (inactive_row.valid() && inactive_row.next_use == use) { return ptr; }
+  }
+}
+
+void Linked_List_Cache::add_to_inactive_rows(uint32_t B_row_ptr,
+                                             const Active_Row& active_row)
 {
-  assert(num_active_blocks >= active_row.second.num_blocks);
-  num_active_blocks -= active_row.second.num_blocks;
-  num_inactive_blocks += active_row.second.num_blocks;
+  assert(num_active_blocks >= active_row.num_blocks);
+  num_active_blocks -= active_row.num_blocks;
+  num_inactive_blocks += active_row.num_blocks;
   assert(num_active_blocks + num_inactive_blocks + num_C_partial_blocks
          + num_free_blocks <= row_data_list.size());
-  // search for an empty way or replace smallest inactive row
-  const unsigned index = active_row.first % inactive_rows_num_sets;
+  // search for an empty way or replace smallest inactive row, or the one
+  // used furthest in the future with the Belady replacement
+  const unsigned index = B_row_ptr % inactive_rows_num_sets;
   unsigned pos = 0;
   unsigned min_row_num_blocks = UINT_MAX;
+  std::size_t max_next_use = 0;
   for (unsigned i = 0; i < inactive_rows_assoc; ++i) {
     auto& inactive_row = inactive_rows_cache[index * inactive_rows_assoc + i];
     if (!inactive_row.valid()) {
       pos = i;
       break;
     }
-    if (inactive_row.num_blocks < min_row_num_blocks) {
+    if (belady_replacement) {
+      if (inactive_row.next_use >= max_next_use) {
+        max_next_use = inactive_row.next_use;
+        pos = i;
+      }
+    } else if (inactive_row.num_blocks < min_row_num_blocks) {
       min_row_num_blocks = inactive_row.num_blocks;
       pos = i;
     }
@@ -475,19 +592,22 @@ void Linked_List_Cache::add_to_inactive_rows(
   pos += index * inactive_rows_assoc;
   // add inactive row to free lists queue
   if (inactive_rows_cache[pos].valid()) {
-    assert(num_inactive_rows > inactive_rows_cache[pos].num_blocks);
-    num_inactive_blocks -= inactive_rows_cache[pos].num_blocks;
-    num_free_blocks += inactive_rows_cache[pos].num_blocks;
-    assert(num_active_blocks + num_inactive_blocks + num_C_partial_blocks
-           + num_free_blocks <= row_data_list.size());
-    free_list_heads.emplace_back(inactive_rows_cache[pos].row_head);
-    inactive_rows_list_remove(pos);
-    ++evictions;
-    max_free_lists = std::max(max_free_lists, free_list_heads.size());
+    if (belady_replacement && active_row.next_use >= inactive_rows_cache[pos].next_use) {
+      // the new row is used after all the rows of its set, so it's evicted
+      // instead of them
+      num_inactive_blocks -= active_row.num_blocks;
+      num_free_blocks += active_row.num_blocks;
+      free_list_heads.emplace_back(active_row.row_head);
+      ++evictions;
+      max_free_lists = std::max(max_free_lists, free_list_heads.size());
+      return;
+    }
+    evict_inactive_row(pos);
   }
-  inactive_rows_cache[pos].B_row_ptr = active_row.first;
-  inactive_rows_cache[pos].row_head = active_row.second.row_head;
-  inactive_rows_cache[pos].num_blocks = active_row.second.num_blocks;
+  inactive_rows_cache[pos].B_row_ptr = B_row_ptr;
+  inactive_rows_cache[pos].row_head = active_row.row_head;
+  inactive_rows_cache[pos].num_blocks = active_row.num_blocks;
+  inactive_rows_cache[pos].next_use = active_row.next_use;
   inactive_rows_cache[pos].prev = inactive_rows_list_tail;
   inactive_rows_cache[pos].next = UINT_MAX;
   if (inactive_rows_list_tail == UINT_MAX) {
@@ -501,6 +621,58 @@ void Linked_List_Cache::add_to_inactive_rows(
   ++num_inactive_rows;
   stats_max_inactive_rows =
     std::max(stats_max_inactive_rows, num_inactive_rows);
+  if (belady_replacement) {
+    furthest_inactive_rows.emplace(active_row.next_use, pos);
+    // drop the stale entries
+    if (furthest_inactive_rows.size() > 2 * inactive_rows_cache.size()) {
+      furthest_inactive_rows = {};
+      for (unsigned i = 0; i < inactive_rows_cache.size(); ++i) {
+        if (!inactive_rows_cache[i].valid()) continue;
+        furthest_inactive_rows.emplace(inactive_rows_cache[i].next_use, i);
+      }
+    }
+  }
+}
+
+// the row is fetched, used and released at once, so it ends up at the tail of
+// the inactive rows
+void Linked_List_Cache::warm_up_row(uint32_t B_row_ptr, uint32_t B_row_end,
+                                    std::size_t row_next_use)
+{
+  const unsigned index = B_row_ptr % inactive_rows_num_sets;
+  for (unsigned i = 0; i < inactive_rows_assoc; ++i) {
+    const auto pos = index * inactive_rows_assoc + i;
+    const auto& inactive_row = inactive_rows_cache[pos];
+    if (inactive_row.B_row_ptr != B_row_ptr) continue;
+    const Active_Row row{inactive_row.row_head, 0, inactive_row.num_blocks, row_next_use};
+    num_active_blocks += row.num_blocks;
+    num_inactive_blocks -= row.num_blocks;
+    inactive_rows_list_remove(pos);
+    add_to_inactive_rows(B_row_ptr, row);
+    return;
+  }
+  const unsigned row_num_blocks = div_ceil(B_row_end - B_row_ptr, block_size);
+  if (row_num_blocks > num_free_blocks + num_inactive_blocks) return;
+  unsigned row_head = UINT_MAX;
+  unsigned prev = UINT_MAX;
+  for (auto remaining = B_row_end - B_row_ptr; remaining > 0;) {
+    const unsigned ptr = allocate_block();
+    assert(ptr != UINT_MAX);
+    --num_free_blocks;
+    ++num_active_blocks;
+    row_data_list[ptr].num_elements = std::min(remaining, block_size);
+    remaining -= row_data_list[ptr].num_elements;
+    if (prev == UINT_MAX) {
+      row_head = ptr;
+    } else {
+      row_data_list[prev].next = ptr;
+      row_data_list[prev].last = false;
+    }
+    prev = ptr;
+  }
+  // the last block of a row points to its B_row_ptr
+  row_data_list[prev].next = B_row_ptr;
+  add_to_inactive_rows(B_row_ptr, {row_head, 0, row_num_blocks, row_next_use});
 }
 
 void Linked_List_Cache::inactive_rows_list_remove(unsigned ptr) {
@@ -2,18 +2,26 @@
 #define MERGEFOREST_SIM_LINKED_LIST_CACHE_HPP
 
 #include <mergeforest-sim/array_fetcher.hpp>
+#include <mergeforest-sim/flat_map.hpp>
 #include <mergeforest-sim/mergeforest/matB_fetcher.hpp>
 #include <mergeforest-sim/matrix_data.hpp>
 #include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/ring_queue.hpp>
+#include <mergeforest-sim/small_vector.hpp>
+#include <mergeforest-sim/time_series.hpp>
 
 #include <toml.hpp>
 
 #include <vector>
-#include <deque>
-#include <unordered_map>
+#include <queue>
+#include <utility>
+#include <climits>
+#include <cstdint>
 
 namespace mergeforest_sim {
 
+struct Benchmark_Access;
+
 namespace mergeforest {
 
 struct Linked_list_Node {
@@ -29,6 +37,9 @@ struct Active_Row {
   unsigned row_head {};
   unsigned num_uses {};
   unsigned num_blocks {};
+  // index of the next prefetched row that uses this B row, only with the
+  // Belady replacement
+  std::size_t next_use {SIZE_MAX};
 };
 
 struct Inactive_Row {
@@ -39,25 +50,35 @@ struct Inactive_Row {
   unsigned num_blocks {};
   unsigned prev {};
   unsigned next {};
+  std::size_t next_use {SIZE_MAX};
 };
 
 class Linked_List_Cache {
 public:
+  friend Benchmark_Access;
+
   using Mem_Port = Port<Mem_Request, Mem_Response>;
-  using Prefetch_Port = Port<std::vector<Prefetched_Row>, Empty_Msg>;
+  using Prefetch_Port = Port<Prefetched_Rows, Empty_Msg>;
   using Cache_Read_Port = Port<Cache_Response, Cache_Read>;
   using Cache_Write_Port = Port<unsigned, Cache_Write>;
 
   Linked_List_Cache(const toml::value& parsed_config,
 		    const Matrix_Data& matrix_data_);
   void reset();
+  // fills the cache with the B rows as if they had been fetched and used in
+  // this order, without timing nor stats
+  void warm_up(const std::vector<std::pair<uint32_t, uint32_t>>& B_row_ptr_end);
   void update();
   void apply();
+  // true if the last cycle didn't change the state of the cache
+  bool idle() const;
+  void skip_cycles(std::size_t num_cycles);
   Mem_Port* get_mem_port(std::size_t id);
   Prefetch_Port* get_prefetch_port();
   Cache_Read_Port* get_read_port(std::size_t id);
   Cache_Write_Port* get_write_port();
   std::size_t num_mem_ports() const;
+  void add_time_series_columns(Time_Series_Writer& time_series) const;
   // config parameters
   std::size_t num_blocks {};
   unsigned max_active_rows {};
@@ -66,6 +87,9 @@ public:
   unsigned num_banks {};
   unsigned prefetched_rows_per_cycle {};
   unsigned sample_interval {};
+  // evict the inactive rows that will be used furthest in the future instead
+  // of the least recently used ones, using the known order of the B rows
+  bool belady_replacement {};
   // stats
   std::size_t reads {};
   std::size_t writes {};
@@ -99,7 +123,12 @@ private:
   unsigned write_C_partial_row(Cache_Write request);
   unsigned allocate_block();
   bool free_inactive_row();
-  void add_to_inactive_rows(const std::pair<uint32_t, Active_Row>& active_row);
+  void evict_inactive_row(unsigned ptr);
+  unsigned furthest_inactive_row();
+  std::size_t next_use(std::size_t ref) const;
+  void compute_next_uses();
+  void add_to_inactive_rows(uint32_t B_row_ptr, const Active_Row& active_row);
+  void warm_up_row(uint32_t B_row_ptr, uint32_t B_row_end, std::size_t row_next_use);
   void inactive_rows_list_remove(unsigned ptr);
   void sample_cache_utilization();
 
@@ -113,13 +142,22 @@ private:
 
   Array_Fetcher<std::pair<uint32_t, uint32_t>> B_row_ptr_end_fetcher;
   MatB_Fetcher matB_fetcher;
-  std::unordered_multimap<unsigned, std::pair<unsigned, unsigned>> pending_reqs;
-  std::vector<std::deque<Cache_Response>> finished_reqs;
+  // read port and id of the requests waiting for each block, in arrival order
+  Flat_Map<unsigned, Small_Vector<std::pair<unsigned, unsigned>, 4>, UINT_MAX> pending_reqs;
+  std::vector<Ring_Queue<Cache_Response>> finished_reqs;
 
-  std::unordered_map<uint32_t, Active_Row> active_rows;
+  Flat_Map<uint32_t, Active_Row, UINT32_MAX> active_rows;
   std::vector<Inactive_Row> inactive_rows_cache;
   std::vector<Linked_list_Node> row_data_list;
-  std::deque<unsigned> free_list_heads;
+  Ring_Queue<unsigned> free_list_heads;
+  // index of the next use of the B row of each prefetched row, SIZE_MAX if
+  // it isn't used again, only with the Belady replacement
+  std::vector<std::size_t> next_uses;
+  // index of the next prefetched row
+  std::size_t next_ref {};
+  // next use and position of the inactive rows, with stale entries of the
+  // rows that were reused or evicted since they were pushed
+  std::priority_queue<std::pair<std::size_t, unsigned>> furthest_inactive_rows;
   unsigned inactive_rows_list_head {UINT_MAX};
   unsigned inactive_rows_list_tail {UINT_MAX};
   std::size_t num_inactive_rows {};
@@ -130,6 +168,7 @@ private:
   std::size_t num_free_blocks {};
   std::size_t num_fetching_blocks {};
   unsigned cycles {};
+  bool active {};
 };
 
 } // namespace mergeforest
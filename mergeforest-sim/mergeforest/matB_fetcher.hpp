@@ -2,9 +2,9 @@
 #define MERGEFOREST_SIM_MAT_B_FETCHER_HPP
 
 #include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/ring_queue.hpp>
 
 #include <vector>
-#include <deque>
 #include <tuple>
 #include <climits>
 
@@ -17,7 +17,7 @@ struct Row_Fetcher {
   Address row_end_addr {invalid_address};
   unsigned row_ptr {UINT_MAX};
   std::size_t num_bytes_received {};
-  std::deque<std::pair<Address, bool>> pending_reqs;
+  Ring_Queue<std::pair<Address, bool>> pending_reqs;
 
   std::tuple<unsigned, unsigned, bool> get_data();
 };
@@ -9,6 +9,19 @@ bool Input_Fiber::finished() const {
   return !C_partial_fiber && head_ptr == UINT_MAX && B_num_elements == 0;
 }
 
+void Input_Fiber::init(double A_value_, uint32_t B_row_ptr_, unsigned head_ptr_,
+                       C_Partial_Fiber* C_partial_fiber_)
+{
+  C_partial_fiber = C_partial_fiber_;
+  A_value = A_value_;
+  B_row_ptr = B_row_ptr_;
+  head_ptr = head_ptr_;
+  request_sent = false;
+  B_num_elements = 0;
+  next_data.clear();
+  next_data.last = true;
+}
+
 bool Tree_Level::empty() const {
   return nodes.empty();
 }
@@ -47,6 +60,10 @@ void Merge_Tree::reset() {
     level.num_active_nodes = 0;
   }
   std::ranges::fill(outputs, Task_Output{});
+  for (std::size_t i = 0; i != inputs.size(); ++i) {
+    levels.back().nodes[i].reserve(parent.input_buffer_size);
+    inputs[i].next_data.reserve(parent.input_buffer_size);
+  }
 }
 
 bool Merge_Tree::inactive() const {
@@ -70,6 +87,7 @@ Cache_Read Merge_Tree::get_request() {
         && input.C_partial_fiber->head_ptr != UINT_MAX)
     {
       input.head_ptr = input.C_partial_fiber->head_ptr;
+      parent.active = true;
     }
     if (input.head_ptr != UINT_MAX && 
         input_buffer_size(input_arbiter) + block_size <= parent.input_buffer_size)
@@ -150,6 +168,7 @@ void Merge_Tree::update_level(unsigned idx) {
   if (cur_level.task == UINT_MAX) {
     if (next_level.task == UINT_MAX) { return; }
     cur_level.init(next_level.task, (next_level.num_active_nodes + 1) / 2);
+    parent.active = true;
   }
   if (cur_level.task != next_level.task) { return; }
   if (idx == 0) {
@@ -193,6 +212,7 @@ void Merge_Tree::update_level(unsigned idx) {
     if (next_level.num_active_nodes == 0) {
       next_level.task = UINT_MAX;
     }
+    parent.active = true;
     break;
   }
 }
@@ -216,6 +236,7 @@ void Merge_Tree::update_root() {
   { 
     return;
   }
+  parent.active = true;
   auto& buffer = output.C_partial ? output.C_partial->data : dest;
   unsigned num_elements_out = 0;
   if (src1.finished()) {
@@ -255,6 +276,7 @@ void Merge_Tree::update_base() {
   if (base_level.task == UINT_MAX) {
     // update merge tree base level with new task
     if (num_active_inputs == 0) { return; }
+    parent.active = true;
     base_level.task = input_task;
     base_level.num_active_nodes = num_active_inputs;
     for (unsigned i = 0; i != base_level.num_active_nodes; ++i) {
@@ -284,17 +306,21 @@ void Merge_Tree::update_base() {
       : input.next_data;
     assert(buffer.size() <= parent.input_buffer_size);
     // do block mult
+    parent.active = true;
     auto n = std::min(parent.merge_tree_merger_width, input.B_num_elements);
     input.B_num_elements -= n;
     parent.num_mults += n;
     ++parent.num_block_mults;
     const auto& mat_B = parent.matrix_data.B;
-    while (n--) {
-      buffer.col_idx.push_back(mat_B->col_idx[input.B_row_ptr]);
-      if (parent.matrix_data.compute_result) {
-        buffer.values.push_back(input.A_value * mat_B->values[input.B_row_ptr]);
+    if (parent.matrix_data.compute_result) {
+      for (; n > 0; --n, ++input.B_row_ptr) {
+        buffer.push_back(mat_B->col_idx[input.B_row_ptr],
+                         input.A_value * mat_B->values[input.B_row_ptr]);
+      }
+    } else {
+      for (; n > 0; --n, ++input.B_row_ptr) {
+        buffer.push_back(mat_B->col_idx[input.B_row_ptr]);
       }
-      ++input.B_row_ptr;
     }
     if (base_level.task != input_task) {
       buffer.last = false;
@@ -12,20 +12,12 @@ namespace mergeforest_sim {
 namespace mergeforest {
 
 
-bool Fiber_Buffer::empty() const {
-  return col_idx.empty();
-}
-
 bool Fiber_Buffer::finished() const {
-  return col_idx.empty() && last;
-}
-
-std::size_t Fiber_Buffer::size() const {
-  return col_idx.size();
+  return empty() && last;
 }
 
 bool Fiber_Buffer::ready_to_merge(unsigned size) const {
-  return last || col_idx.size() >= size;
+  return last || this->size() >= size;
 }
 
 bool C_Partial_Fiber::finished() const {
@@ -121,10 +113,10 @@ void Task_Tree::reset() {
 
 Merge_Tree_Manager::Merge_Tree_Manager(const toml::value& parsed_config, Matrix_Data& matrix_data_)
   : matrix_data{matrix_data_}
-  , A_row_ptr_fetcher(matrix_data.preproc_A_row_ptr)
-  , A_row_idx_fetcher(matrix_data.preproc_A_row_idx)
-  , C_row_ptr_fetcher(matrix_data.preproc_C_row_ptr)
-  , A_values_fetcher(matrix_data.preproc_A_values)
+  , A_row_ptr_fetcher(matrix_data.preproc_A_row_ptr, &matrix_data.preproc_row_segments)
+  , A_row_idx_fetcher(matrix_data.preproc_A_row_idx, &matrix_data.preproc_row_segments)
+  , C_row_ptr_fetcher(matrix_data.preproc_C_row_ptr, &matrix_data.preproc_row_segments)
+  , A_values_fetcher(matrix_data.preproc_A_values, &matrix_data.preproc_element_segments)
 {
   get_config_params(parsed_config);
 }
@@ -149,12 +141,14 @@ void Merge_Tree_Manager::reset() {
 
   for (auto& tree : merge_trees) { tree.reset(); }
   std::ranges::fill(dyn_nodes, Dynamic_Tree_Node{});
+  for (auto& node : dyn_nodes) { node.data.reserve(output_buffer_size); }
   std::ranges::fill(C_partial_fibers, C_Partial_Fiber{});
   task_allocator.reset();
   task_tree.reset();
   C_partial_write_idx = UINT_MAX;
   C_partial_head_ptr = nullptr;
   write_arbiter = UINT64_MAX;
+  active = false;
   
   num_mults = 0;
   num_block_mults = 0;
@@ -168,10 +162,14 @@ void Merge_Tree_Manager::reset() {
   num_C_partial_elements = 0;
   prefetch_stalls = 0;
   A_data_stalls = 0;
+  C_partial_stalls = 0;
   max_write_bytes = 0;
 }
 
 void Merge_Tree_Manager::update() {
+  active = false;
+  cycle_A_data_stalls = A_data_stalls;
+  cycle_C_partial_stalls = C_partial_stalls;
   write_C_data();
   write_C_partial_data();
   update_dynamic_nodes();
@@ -181,10 +179,14 @@ void Merge_Tree_Manager::update() {
   send_A_data_request();
   send_cache_read_requests();
   
-  mem_read_port.transfer();
-  for (auto& p: cache_read_ports) { p.transfer(); }
-  for (auto& p: mem_write_ports) { p.transfer(); }
-  cache_write_port.transfer();
+  if (mem_read_port.transfer()) { active = true; }
+  for (auto& p: cache_read_ports) {
+    if (p.transfer()) { active = true; }
+  }
+  for (auto& p: mem_write_ports) {
+    if (p.transfer()) { active = true; }
+  }
+  if (cache_write_port.transfer()) { active = true; }
 }
 
 void Merge_Tree_Manager::apply() {
@@ -208,6 +210,16 @@ bool Merge_Tree_Manager::finished() {
   return true;
 }
 
+bool Merge_Tree_Manager::idle() const {
+  return !active;
+}
+
+void Merge_Tree_Manager::skip_cycles(std::size_t num_cycles) {
+  // an idle cycle repeats the stalls of the last cycle
+  A_data_stalls += num_cycles * (A_data_stalls - cycle_A_data_stalls);
+  C_partial_stalls += num_cycles * (C_partial_stalls - cycle_C_partial_stalls);
+}
+
 Merge_Tree_Manager::Mem_Port* Merge_Tree_Manager::get_mem_read_port() {
   return &mem_read_port;
 }
@@ -238,6 +250,19 @@ std::size_t Merge_Tree_Manager::num_cache_read_ports() const {
   return cache_read_ports.size();
 }
 
+void Merge_Tree_Manager::add_time_series_columns(Time_Series_Writer& time_series) const {
+  time_series.add_counter("mults", &num_mults);
+  time_series.add_counter("merge_tree_merges", &merge_tree_num_merges);
+  time_series.add_counter("merge_tree_adds", &merge_tree_num_adds);
+  time_series.add_counter("dyn_merges", &dyn_num_merges);
+  time_series.add_counter("dyn_adds", &dyn_num_adds);
+  time_series.add_counter("idle_cycles", &num_idle_cycles);
+  time_series.add_counter("prefetch_stalls", &prefetch_stalls);
+  time_series.add_counter("A_data_stalls", &A_data_stalls);
+  time_series.add_counter("C_partial_stalls", &C_partial_stalls);
+  time_series.add_counter("C_writes", &C_writes);
+}
+
 void Merge_Tree_Manager::get_config_params(const toml::value& parsed_config) {
   const auto A_row_ptr_buffer_size = toml::find_or(parsed_config, "merge_tree_manager",
                                                    "A_row_ptr_buffer_size", 16u);
@@ -311,6 +336,7 @@ void Merge_Tree_Manager::send_A_data_request() {
       request.id = read_arbiter;
       mem_read_port.add_msg_send(request);
       ++preproc_A_reads;
+      active = true;
       return;
     }
   }
@@ -322,6 +348,7 @@ void Merge_Tree_Manager::send_cache_read_requests() {
     const auto request = merge_trees[i].get_request();
     if (request.valid()) {
       cache_read_ports[i].add_msg_send(request);
+      active = true;
     }
   }
 }
@@ -342,6 +369,7 @@ void Merge_Tree_Manager::write_C_data() {
       if (address == invalid_address) { continue; }
       ++C_writes;
       port.add_msg_send(Mem_Request{.address = address, .is_write = true});
+      active = true;
       break;
     }
   }
@@ -362,10 +390,11 @@ void Merge_Tree_Manager::write_C_partial_data() {
     ++num_C_partial_rows;
   }
   cache_write_port.add_msg_send(cache_write);
+  active = true;
 }
 
 void Merge_Tree_Manager::update_dynamic_nodes() {
-  std::vector<unsigned> possible_merges;
+  possible_merges.clear();
   for (unsigned i = 0; i != dyn_nodes.size(); ++i) {
     if (dyn_nodes[i].data.size() > output_buffer_size - dyn_merger_width
 	|| dyn_nodes[i].output.num_bytes_write >
@@ -411,6 +440,7 @@ void Merge_Tree_Manager::update_dynamic_nodes() {
     if (node.output.valid()) {
       write_C_output(node.output, node.data, num_elements_out);
     }
+    active = true;
   //   if (node.src1.valid()) {
   //     auto& node_src1 = fiber_source_node(node.src1);
   //     if (node.src2.valid() && num_merges != num_final_mergers) {
@@ -472,16 +502,17 @@ void Merge_Tree_Manager::write_C_output(Task_Output& output, Fiber_Buffer& node,
   max_write_bytes = std::max(max_write_bytes, output.num_bytes_write);
   if (output.write_address == invalid_address) { return; }
   assert(node.size() == num_elements_out);
-  while (!node.empty()) {
-    if (matrix_data.compute_result) {
-      matrix_data.C.col_idx[output.C_row_ptr] = node.col_idx.front();
-      matrix_data.C.values[output.C_row_ptr] = node.values.front();
-      node.values.pop_front();
+  if (matrix_data.compute_result) {
+    for (; !node.empty(); node.pop_front()) {
+      matrix_data.C.col_idx[output.C_row_ptr] = node.front_col_idx();
+      matrix_data.C.values[output.C_row_ptr] = node.front_value();
+      ++output.C_row_ptr;
     }
-    node.col_idx.pop_front();
-    ++output.C_row_ptr;
-    ++matrix_data.C.nnz;
+  } else {
+    output.C_row_ptr += static_cast<unsigned>(node.size());
+    node.clear();
   }
+  matrix_data.C.nnz += num_elements_out;
   if (node.finished()) {
     matrix_data.C.row_end[output.C_row_idx] = output.C_row_ptr;
     output.C_row_idx = UINT_MAX;
@@ -498,7 +529,10 @@ void Merge_Tree_Manager::allocate_task() {
   if (!task_allocator.all_rows_allocated()) {
     // find available tree to allocate
     for (unsigned i = 0; i != merge_trees.size(); ++i) {
-      if (add_task_merge_tree(i)) { return; }
+      if (add_task_merge_tree(i)) {
+        active = true;
+        return;
+      }
     }
   }
   // find two sources ready to merge
@@ -564,10 +598,9 @@ bool Merge_Tree_Manager::add_task_merge_tree(unsigned tree_idx) {
   }
   // init B rows in inputs
   while (tree.num_active_inputs < B_rows_to_allocate) {
-    tree.inputs[tree.num_active_inputs] =
-      Input_Fiber{ .A_value = A_values_fetcher.front(),
-                   .B_row_ptr = prefetched_B_rows.front().B_row_ptr,
-                   .head_ptr = prefetched_B_rows.front().row_head_ptr };
+    tree.inputs[tree.num_active_inputs].init(A_values_fetcher.front(),
+                                             prefetched_B_rows.front().B_row_ptr,
+                                             prefetched_B_rows.front().row_head_ptr);
     A_values_fetcher.pop();
     prefetched_B_rows.pop_front();
     ++tree.num_active_inputs;
@@ -577,9 +610,8 @@ bool Merge_Tree_Manager::add_task_merge_tree(unsigned tree_idx) {
   while (tree.num_active_inputs < tree.inputs.size()
          && !task_allocator.C_partial_fibers.empty())
   {
-    tree.inputs[tree.num_active_inputs] =
-      Input_Fiber{ .C_partial_fiber =
-                   task_allocator.C_partial_fibers.back() };
+    tree.inputs[tree.num_active_inputs].init(0.0, UINT32_MAX, UINT_MAX,
+                                             task_allocator.C_partial_fibers.back());
     task_allocator.C_partial_fibers.pop_back();
     ++tree.num_active_inputs;
   }
@@ -600,12 +632,14 @@ void Merge_Tree_Manager::add_task_dyn_node(unsigned node_idx,
       C_partial_write_idx = node_idx + static_cast<unsigned>(merge_trees.size());
       C_partial_head_ptr = task_allocator.output.C_partial;
     }
+    active = true;
     dyn_nodes[node_idx].src1 = prev_src.first;
     dyn_nodes[node_idx].src2 = cur_src.first;
     dyn_nodes[node_idx].data.last = false;
     dyn_nodes[node_idx].output = task_allocator.output;
     task_allocator.reset();
   } else {
+    active = true;
     dyn_nodes[node_idx].src1 = prev_src.first;
     dyn_nodes[node_idx].src2 = cur_src.first;
     dyn_nodes[node_idx].data.last = false;
@@ -634,6 +668,7 @@ void Merge_Tree_Manager::get_new_task() {
     A_row_ptr_fetcher.pop();
     A_row_idx_fetcher.pop();
     C_row_ptr_fetcher.pop();
+    active = true;
     if (num_rows_merge <= max_rows_merge) {
       task_allocator.output.C_row_idx = A_row_idx;
       task_allocator.output.C_row_ptr = C_row_ptr;
@@ -671,6 +706,7 @@ void Merge_Tree_Manager::get_new_task() {
   }
   if (task_tree.tree_level == 1) {
     if (task_tree.tree_level == last_level) {
+      active = true;
       assert(task_tree.B_rows_second_level + task_tree.num_C_partials_level[0]
              == max_rows_merge);
       task_allocator.output.C_row_idx = task_tree.C_row_idx;
@@ -741,6 +777,7 @@ void Merge_Tree_Manager::get_new_task() {
   // last level
   assert(task_tree.num_C_partials_level[task_tree.tree_level - 1]
          == max_rows_merge);
+  active = true;
   task_allocator.output.C_row_idx = task_tree.C_row_idx;
   task_allocator.output.C_row_ptr = task_tree.C_row_ptr;
   task_allocator.output.write_address =
@@ -775,6 +812,7 @@ C_Partial_Fiber* Merge_Tree_Manager::get_C_partial_fiber() {
   for (auto& p : C_partial_fibers) {
     if (p.finished()) {
       p.data.last = false;
+      active = true;
       return &p;
     }
   }
@@ -783,6 +821,7 @@ C_Partial_Fiber* Merge_Tree_Manager::get_C_partial_fiber() {
 
 void Merge_Tree_Manager::receive_A_data() {
   if (!mem_read_port.msg_received_valid()) { return; }
+  active = true;
   const auto mem_read_resp = mem_read_port.get_msg_received();
   assert(mem_read_resp.id < 4);
   switch (mem_read_resp.id) {
@@ -808,9 +847,9 @@ void Merge_Tree_Manager::receive_prefetch_data() {
     if (prefetched_B_rows.size() + prefetch_resp.size()
         <= max_prefetched_rows)
     {
-      prefetched_B_rows.insert(prefetched_B_rows.end(), prefetch_resp.begin(),
-                               prefetch_resp.end());
+      for (const auto& row : prefetch_resp) { prefetched_B_rows.push_back(row); }
       prefetch_port.clear_msg_received();
+      active = true;
     }
   }
 }
@@ -820,8 +859,10 @@ void Merge_Tree_Manager::receive_cache_data() {
     if (!cache_read_ports[i].msg_received_valid()) { continue; }
     merge_trees[i].receive_response(cache_read_ports[i].get_msg_received());
     cache_read_ports[i].clear_msg_received();
+    active = true;
   }
   if (!cache_write_port.msg_received_valid()) { return; }
+  active = true;
   assert(C_partial_head_ptr && C_partial_head_ptr->head_ptr == UINT_MAX);
   C_partial_head_ptr->head_ptr = cache_write_port.get_msg_received();
   C_partial_head_ptr = nullptr;
@@ -836,6 +877,27 @@ unsigned Merge_Tree_Manager::do_merge_add(Fiber_Buffer& dest,
   const auto [merge_width, max_num_adds] = (is_merge_tree) ?
     std::tie(merge_tree_merger_width, merge_tree_merger_num_adds)
     : std::tie(dyn_merger_width, dyn_merger_num_adds);
+  const auto [num_elements_output, num_adds] = matrix_data.compute_result
+    ? merge_add<true>(dest, src1, src2, merge_width, max_num_adds)
+    : merge_add<false>(dest, src1, src2, merge_width, max_num_adds);
+  if (src1.finished() && src2.finished()) {
+    dest.last = true;
+  }
+  if (is_merge_tree) {
+    ++merge_tree_num_merges;
+    merge_tree_num_adds += num_adds;
+  } else {
+    ++dyn_num_merges;
+    dyn_num_adds += num_adds;
+  }
+  return num_elements_output;
+}
+
+template<bool compute_result>
+std::pair<unsigned, unsigned> Merge_Tree_Manager::merge_add(Fiber_Buffer& dest, Fiber_Buffer& src1,
+                                       Fiber_Buffer& src2, unsigned merge_width,
+                                       unsigned max_num_adds)
+{
   unsigned num_elements_output {};
   unsigned num_adds {};
   while (num_elements_output < merge_width && num_adds < max_num_adds) {
@@ -848,60 +910,41 @@ unsigned Merge_Tree_Manager::do_merge_add(Fiber_Buffer& dest,
         fiber_buffer_transfer(src1, dest, merge_width - num_elements_output);
       break;
     }
-    const auto res  = src1.col_idx.front() <=> src2.col_idx.front();
-    if (res < 0) {
-      dest.col_idx.push_back(src1.col_idx.front());
-      src1.col_idx.pop_front();
-      if (matrix_data.compute_result) {
-        dest.values.push_back(src1.values.front());
-        src1.values.pop_front();
+    const auto col_idx1 = src1.front_col_idx();
+    const auto col_idx2 = src2.front_col_idx();
+    if (col_idx1 < col_idx2) {
+      if constexpr (compute_result) {
+        dest.push_back(col_idx1, src1.front_value());
+      } else {
+        dest.push_back(col_idx1);
       }
-    } else if (res > 0) {
-      dest.col_idx.push_back(src2.col_idx.front());
-      src2.col_idx.pop_front();
-      if (matrix_data.compute_result) {
-        dest.values.push_back(src2.values.front());
-        src2.values.pop_front();
+      src1.pop_front();
+    } else if (col_idx1 > col_idx2) {
+      if constexpr (compute_result) {
+        dest.push_back(col_idx2, src2.front_value());
+      } else {
+        dest.push_back(col_idx2);
       }
+      src2.pop_front();
     } else {
-      dest.col_idx.push_back(src1.col_idx.front());
-      src1.col_idx.pop_front();
-      src2.col_idx.pop_front();
-      if (!src1.values.empty()) {
-        const auto add_value = src1.values.front() + src2.values.front();
-        dest.values.push_back(add_value);
-        src1.values.pop_front();
-        src2.values.pop_front();
+      if constexpr (compute_result) {
+        dest.push_back(col_idx1, src1.front_value() + src2.front_value());
+      } else {
+        dest.push_back(col_idx1);
       }
+      src1.pop_front();
+      src2.pop_front();
       ++num_adds;
     }
     ++num_elements_output;
   }
-  if (src1.finished() && src2.finished()) {
-    dest.last = true;
-  }
-  if (is_merge_tree) {
-    ++merge_tree_num_merges;
-    merge_tree_num_adds += num_adds;
-  } else {
-    ++dyn_num_merges;
-    dyn_num_adds += num_adds;
-  }
-  return num_elements_output;
+  return {num_elements_output, num_adds};
 }
 
 unsigned fiber_buffer_transfer(Fiber_Buffer& src, Fiber_Buffer& dest, std::size_t num_elements) {
-  const auto n =
-    static_cast<std::ptrdiff_t>(std::min(num_elements, src.size()));
+  const auto n = std::min(num_elements, src.size());
   if (n == 0) { return 0; }
-  dest.col_idx.insert(dest.col_idx.end(), src.col_idx.begin(),
-                      src.col_idx.begin() + n);
-  src.col_idx.erase(src.col_idx.begin(), src.col_idx.begin() + n);
-  if (!src.values.empty()) {
-    dest.values.insert(dest.values.end(), src.values.begin(),
-                       src.values.begin() + n);
-    src.values.erase(src.values.begin(), src.values.begin() + n);
-  }
+  dest.transfer(src, n);
   if (src.finished()) {
     dest.last = true;
   }
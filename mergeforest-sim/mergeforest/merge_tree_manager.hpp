@@ -2,27 +2,29 @@
 #define MERGEFOREST_SIM_MERGE_TREE_MANAGER_HPP
 
 #include <mergeforest-sim/array_fetcher.hpp>
+#include <mergeforest-sim/fiber_queue.hpp>
 #include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/ring_queue.hpp>
 #include <mergeforest-sim/matrix_data.hpp>
+#include <mergeforest-sim/time_series.hpp>
 
 #include <toml.hpp>
 
 #include <vector>
-#include <deque>
+#include <utility>
 #include <climits>
 
 namespace mergeforest_sim {
 
+// gives the benchmarks access to the private hot paths
+struct Benchmark_Access;
+
 namespace mergeforest {
 
-struct Fiber_Buffer {
-  bool empty() const;
+struct Fiber_Buffer : Fiber_Queue {
   bool finished() const;
-  std::size_t size() const;
   bool ready_to_merge(unsigned size) const;
 
-  std::deque<uint32_t> col_idx{};
-  std::deque<double> values{};
   bool last{ true };
 };
 
@@ -94,9 +96,10 @@ struct Merge_Tree;
 class Merge_Tree_Manager {
 public:
   friend Merge_Tree;
+  friend Benchmark_Access;
   
   using Mem_Port = Port<Mem_Request, Mem_Response>;
-  using Prefetch_Port = Port<Empty_Msg, std::vector<Prefetched_Row>>;
+  using Prefetch_Port = Port<Empty_Msg, Prefetched_Rows>;
   using Cache_Read_Port = Port<Cache_Read, Cache_Response>;
   using Cache_Write_Port = Port<Cache_Write, unsigned>;
 
@@ -105,6 +108,9 @@ public:
   void update();
   void apply();
   bool finished();
+  // true if the last cycle only updated the stall stats
+  bool idle() const;
+  void skip_cycles(std::size_t num_cycles);
   Mem_Port* get_mem_read_port();
   Prefetch_Port* get_prefetch_port();
   Cache_Read_Port* get_cache_read_port(std::size_t id);
@@ -112,6 +118,7 @@ public:
   Mem_Port* get_mem_write_port(std::size_t id);
   std::size_t num_mem_ports() const;
   std::size_t num_cache_read_ports() const;
+  void add_time_series_columns(Time_Series_Writer& time_series) const;
   // config parameters
   unsigned max_prefetched_rows {};
   unsigned merge_tree_size {};
@@ -165,6 +172,11 @@ private:
   void receive_cache_data();
   unsigned do_merge_add(Fiber_Buffer& dest, Fiber_Buffer& src1,
                         Fiber_Buffer& src2, bool is_merge_tree);
+  // merge loop without run time checks of matrix_data.compute_result, returns
+  // the number of elements output and the number of additions
+  template<bool compute_result>
+  std::pair<unsigned, unsigned> merge_add(Fiber_Buffer& dest, Fiber_Buffer& src1, Fiber_Buffer& src2,
+                     unsigned merge_width, unsigned max_num_adds);
   
   Matrix_Data& matrix_data;
 
@@ -179,20 +191,29 @@ private:
   Array_Fetcher<uint32_t> C_row_ptr_fetcher;
   Array_Fetcher<double> A_values_fetcher;
   unsigned read_arbiter {UINT_MAX};
-  std::deque<Prefetched_Row> prefetched_B_rows;
+  Ring_Queue<Prefetched_Row> prefetched_B_rows;
 
   std::vector<Merge_Tree> merge_trees;
   std::vector<Dynamic_Tree_Node> dyn_nodes; 
+  // dynamic nodes that can merge in the current cycle
+  std::vector<unsigned> possible_merges;
   std::vector<C_Partial_Fiber> C_partial_fibers;
   Task_Allocator task_allocator;
   Task_Tree task_tree;
   unsigned C_partial_write_idx {UINT_MAX};
   C_Partial_Fiber* C_partial_head_ptr {nullptr};
   std::size_t write_arbiter {UINT64_MAX};
+  bool active {};
+  // stall stats at the start of the cycle
+  std::size_t cycle_A_data_stalls {};
+  std::size_t cycle_C_partial_stalls {};
 };
 
 struct Input_Fiber {
   bool finished() const;
+  // starts a new fiber, keeping the buffer reserved for next_data
+  void init(double A_value_, uint32_t B_row_ptr_, unsigned head_ptr_,
+            C_Partial_Fiber* C_partial_fiber_ = nullptr);
 
   C_Partial_Fiber* C_partial_fiber {};
   double A_value {};
@@ -1,51 +1,149 @@
 #include <mergeforest-sim/mergeforest.hpp>
 #include <mergeforest-sim/math_utils.hpp>
+#include <mergeforest-sim/host_metrics.hpp>
 
 #include <spdlog/spdlog.h>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+
 namespace mergeforest_sim {
 
+namespace {
+
+// view of the elements of array that doesn't own them
+template<typename T>
+Csr_Array<T> array_view(Csr_Array<T>& array) {
+  return {array.data(), array.size(),
+          std::shared_ptr<const void>(array.data(), [](const void*) {})};
+}
+
+// matrix with the dimensions of mat whose arrays are views of its arrays
+Spmat_Csr matrix_view(Spmat_Csr& mat) {
+  Spmat_Csr view;
+  view.num_rows = mat.num_rows;
+  view.num_cols = mat.num_cols;
+  view.nnz = mat.nnz;
+  view.row_ptr = array_view(mat.row_ptr);
+  view.row_end = array_view(mat.row_end);
+  view.col_idx = array_view(mat.col_idx);
+  view.values = array_view(mat.values);
+  return view;
+}
+
+// a chunk stored in memory right after the previous one extends its segment
+void add_segment(std::vector<Fetch_Segment>& segments, std::size_t begin,
+                 std::size_t source_begin)
+{
+  if (!segments.empty()
+      && segments.back().source_begin + (begin - segments.back().begin) == source_begin)
+  {
+    return;
+  }
+  segments.push_back({.begin = begin, .source_begin = source_begin});
+}
+
+} // namespace
+
+MergeForest::Core::Core(const toml::value& parsed_config, Matrix_Data& data_)
+  : data{data_}
+  , merge_tree_manager{parsed_config, data_}
+  , linked_list_cache{parsed_config, data_}
+{}
+
 MergeForest::MergeForest(const toml::value& parsed_config_,
 		 Matrix_Data& matrix_data_,
 		 const std::string& out_path_)
   : parsed_config{parsed_config_}
   , matrix_data{matrix_data_}
   , out_path{out_path_}
-  , merge_tree_manager{parsed_config, matrix_data_}
-  , linked_list_cache{parsed_config, matrix_data_}
   , main_mem{parsed_config}
 {
-  main_mem.set_num_ports(1 + linked_list_cache.num_mem_ports()
-                         + merge_tree_manager.num_mem_ports());
+  get_config_params();
+  if (num_cores == 1) {
+    cores.emplace_back(parsed_config, matrix_data);
+  } else {
+    for (unsigned i = 0; i < num_cores; ++i) {
+      cores.emplace_back(parsed_config, cores_data.emplace_back());
+    }
+    // the next uses of the B rows of a core aren't known in advance
+    if (row_distribution == Row_Distribution::dynamic
+        && cores.front().linked_list_cache.belady_replacement)
+    {
+      throw std::runtime_error("The Belady replacement needs a static row distribution");
+    }
+  }
+  std::size_t num_ports = 0;
+  for (const auto& core : cores) {
+    num_ports += 1 + core.linked_list_cache.num_mem_ports()
+      + core.merge_tree_manager.num_mem_ports();
+  }
+  main_mem.set_num_ports(num_ports);
+  main_mem.add_time_series_columns(time_series);
   // port connections
-  merge_tree_manager.get_mem_read_port()->connect(main_mem.get_port(0));
-  std::size_t port_idx = 1;
-  for (std::size_t i = 0; i != linked_list_cache.num_mem_ports(); ++i) {
-    linked_list_cache.get_mem_port(i)->connect(main_mem.get_port(port_idx));
+  std::size_t port_idx = 0;
+  for (std::size_t c = 0; c < cores.size(); ++c) {
+    auto& merge_tree_manager = cores[c].merge_tree_manager;
+    auto& linked_list_cache = cores[c].linked_list_cache;
+    merge_tree_manager.get_mem_read_port()->connect(main_mem.get_port(port_idx));
     ++port_idx;
+    for (std::size_t i = 0; i != linked_list_cache.num_mem_ports(); ++i) {
+      linked_list_cache.get_mem_port(i)->connect(main_mem.get_port(port_idx));
+      ++port_idx;
+    }
+    for (std::size_t i = 0; i != merge_tree_manager.num_mem_ports(); ++i) {
+      merge_tree_manager.get_mem_write_port(i)->connect(
+        main_mem.get_port(port_idx));
+      ++port_idx;
+    }
+    merge_tree_manager.get_prefetch_port()->connect(
+      linked_list_cache.get_prefetch_port());
+    for (std::size_t i = 0; i != merge_tree_manager.num_cache_read_ports(); ++i) {
+      merge_tree_manager.get_cache_read_port(i)->connect(
+        linked_list_cache.get_read_port(i));
+    }
+    merge_tree_manager.get_cache_write_port()->connect(
+      linked_list_cache.get_write_port());
+    if (cores.size() > 1) { time_series.set_column_prefix(fmt::format("core{}_", c)); }
+    merge_tree_manager.add_time_series_columns(time_series);
+    linked_list_cache.add_time_series_columns(time_series);
   }
-  for (std::size_t i = 0; i != merge_tree_manager.num_mem_ports(); ++i) {
-    merge_tree_manager.get_mem_write_port(i)->connect(
-      main_mem.get_port(port_idx));
-    ++port_idx;
+  time_series.set_column_prefix("");
+}
+
+void MergeForest::get_config_params() {
+  num_cores = toml::find_or(parsed_config, "num_cores", 1U);
+  if (num_cores == 0) {
+    throw std::runtime_error("MergeForest needs at least one core");
+  }
+  const auto distribution = toml::find_or<std::string>(parsed_config, "row_distribution",
+                                                       "blocks");
+  if (distribution == "blocks") {
+    row_distribution = Row_Distribution::blocks;
+  } else if (distribution == "round_robin") {
+    row_distribution = Row_Distribution::round_robin;
+  } else if (distribution == "dynamic") {
+    row_distribution = Row_Distribution::dynamic;
+  } else {
+    throw std::runtime_error("Unknown row distribution " + distribution + "\n");
   }
-  merge_tree_manager.get_prefetch_port()->connect(
-    linked_list_cache.get_prefetch_port());
-  for (std::size_t i = 0; i != merge_tree_manager.num_cache_read_ports(); ++i) {
-    merge_tree_manager.get_cache_read_port(i)->connect(
-      linked_list_cache.get_read_port(i));
+  row_chunk_size = toml::find_or(parsed_config, "row_chunk_size", 64U);
+  if (row_chunk_size == 0) {
+    throw std::runtime_error("row_chunk_size must be at least 1");
   }
-  merge_tree_manager.get_cache_write_port()->connect(
-    linked_list_cache.get_write_port());
 }
 
 void MergeForest::print_progress() {
-  if (merge_tree_manager.num_mults == 0) {
+  if (!matrix_data.verbose) { return; }
+  const auto num_mults = cores_total(&mergeforest::Merge_Tree_Manager::num_mults);
+  if (num_mults == 0) {
     fmt::print("progress:   0.00%\r");
   } else {
-    const auto progress = static_cast<double>(merge_tree_manager.num_mults)
+    const auto progress = static_cast<double>(num_mults)
       / static_cast<double>(matrix_data.num_mults) * 100.0;
     fmt::print("progress: {:6.2f}%\r", progress);
   }
@@ -53,80 +151,327 @@ void MergeForest::print_progress() {
 }
 
 Spmat_Csr MergeForest::run_simulation(bool compute_result) {
+  auto& host_metrics = matrix_data.host_metrics;
+  auto start = Host_Clock::now();
   matrix_data.compute_result = compute_result;
   matrix_data.preprocess_mats();
   matrix_data.set_physical_addrs();
+  host_metrics.preprocess_time = elapsed_seconds(start);
+  start = Host_Clock::now();
+  main_mem.set_address_regions(matrix_data.address_regions());
   reset();
-  // simulation loop
+  for (auto& core : cores) {
+    core.linked_list_cache.warm_up(matrix_data.warmup_B_row_ptr_end);
+  }
+  open_time_series(time_series, parsed_config, out_path);
+  if (toml::find_or(parsed_config, "profile_components", false)) {
+    simulation_loop<true>();
+  } else {
+    simulation_loop<false>();
+  }
+  time_series.close(cycles);
+  // the cores count the elements of C that they write
+  for (const auto& core_data : cores_data) { matrix_data.C.nnz += core_data.C.nnz; }
+  host_metrics.simulate_time = elapsed_seconds(start);
+  if (matrix_data.verbose) { fmt::print("progress: 100.00%\n"); }
+  // a measured window isn't simulated to the end
+  if (!matrix_data.measured.finished()) { check_valid_simulation(); }
+  if (compute_result) {
+    start = Host_Clock::now();
+    matrix_data.spGEMM_check_result();
+    host_metrics.verify_time = elapsed_seconds(start);
+  }
+  if (matrix_data.print_results) { print_stats(); }
+  return compute_result ? matrix_data.C : Spmat_Csr{};
+}
+
+template<bool profile>
+void MergeForest::simulation_loop() {
+  const bool fast_forward = toml::find_or(parsed_config, "fast_forward", true);
+  const bool dynamic_rows = cores.size() > 1 && row_distribution == Row_Distribution::dynamic;
+  // wall time of the update and apply calls of each component
+  std::array<double, 5> times {};
   for (;;) {
-    merge_tree_manager.update();
-    linked_list_cache.update();
-    main_mem.update();
-    linked_list_cache.apply();
-    merge_tree_manager.apply();
+    profiled_call<profile>(times[0], [&] {
+      for (auto& core : cores) { core.merge_tree_manager.update(); }
+    });
+    profiled_call<profile>(times[1], [&] {
+      for (auto& core : cores) { core.linked_list_cache.update(); }
+    });
+    profiled_call<profile>(times[2], [&] { main_mem.update(); });
+    profiled_call<profile>(times[3], [&] {
+      for (auto& core : cores) { core.linked_list_cache.apply(); }
+    });
+    profiled_call<profile>(times[4], [&] {
+      for (auto& core : cores) { core.merge_tree_manager.apply(); }
+    });
     if (cycles % progress_interval == 0) {
       print_progress();
     }
     ++cycles;
-    if (merge_tree_manager.finished() && main_mem.inactive()) {
+    time_series.sample(cycles);
+    const auto num_mults = cores_total(&mergeforest::Merge_Tree_Manager::num_mults);
+    if (num_mults >= matrix_data.measured.next_mults) {
+      matrix_data.measured.record(num_mults, {cycles, main_mem.read_requests,
+                                              main_mem.write_requests});
+      // the rows after a measured window only keep the hardware busy
+      if (matrix_data.measured.finished()) { break; }
+    }
+    const bool new_chunks = dynamic_rows && give_dynamic_chunks();
+    if (cores_finished() && main_mem.inactive()) {
       break;
     }
+    if (fast_forward && !new_chunks && cores_idle() && main_mem.idle()) {
+      skip_idle_cycles();
+    }
   }
-  fmt::print("progress: 100.00%\n");
-  check_valid_simulation();
-  print_stats();
-  if (compute_result) {
-    matrix_data.spGEMM_check_result();
-    return matrix_data.C;
+  auto& component_times = matrix_data.host_metrics.component_times;
+  component_times.clear();
+  if constexpr (profile) {
+    component_times = {{"Merge_Tree_Manager::update", times[0]},
+                       {"Linked_List_Cache::update", times[1]},
+                       {"Main_Memory::update", times[2]},
+                       {"Linked_List_Cache::apply", times[3]},
+                       {"Merge_Tree_Manager::apply", times[4]}};
   }
-  return Spmat_Csr{};
 }
 
 void MergeForest::reset() {
-  merge_tree_manager.reset();
-  linked_list_cache.reset();
+  if (cores.size() > 1) { distribute_rows(); }
+  for (auto& core : cores) {
+    core.merge_tree_manager.reset();
+    core.linked_list_cache.reset();
+    core.busy_cycles = 0;
+  }
   main_mem.reset();
   cycles = 0;
 }
 
+void MergeForest::distribute_rows() {
+  const auto& A_row_ptr = matrix_data.preproc_A_row_ptr;
+  const auto& B_rows = matrix_data.preproc_B_row_ptr_end;
+  const auto num_rows = static_cast<uint32_t>(matrix_data.preproc_A_row_idx.size());
+  // multiplications of the preprocessed rows before each row
+  std::vector<std::size_t> row_mults(std::size_t{num_rows} + 1, 0);
+  for (uint32_t i = 0; i < num_rows; ++i) {
+    row_mults[i + 1] = row_mults[i];
+    for (auto j = A_row_ptr[i]; j < A_row_ptr[i + 1]; ++j) {
+      row_mults[i + 1] += B_rows[j].second - B_rows[j].first;
+    }
+  }
+  const auto make_chunk = [&](uint32_t begin, uint32_t end) {
+    return Row_Chunk{.begin_row = begin, .end_row = end,
+                     .num_mults = row_mults[end] - row_mults[begin]};
+  };
+  for (auto& core : cores) {
+    init_core_data(core.data);
+    core.chunk_end_mults.clear();
+    core.num_rows = 0;
+  }
+  row_chunks.clear();
+  next_row_chunk = 0;
+  switch (row_distribution) {
+  case Row_Distribution::blocks: {
+    uint32_t begin = 0;
+    for (std::size_t c = 0; c < cores.size(); ++c) {
+      // first row at which the multiplications reach the share of the core
+      const auto share = row_mults.back() * (c + 1) / cores.size();
+      const auto end = static_cast<uint32_t>(std::ranges::lower_bound(row_mults, share)
+                                             - row_mults.begin());
+      const auto block_end = c + 1 == cores.size() ? num_rows : std::max(begin, end);
+      give_chunk(cores[c], make_chunk(begin, block_end));
+      begin = block_end;
+    }
+    break;
+  }
+  case Row_Distribution::round_robin:
+    for (uint32_t begin = 0, c = 0; begin < num_rows; begin += row_chunk_size, ++c) {
+      give_chunk(cores[c % cores.size()],
+                 make_chunk(begin, std::min(begin + row_chunk_size, num_rows)));
+    }
+    break;
+  case Row_Distribution::dynamic:
+    for (uint32_t begin = 0; begin < num_rows; begin += row_chunk_size) {
+      row_chunks.push_back(make_chunk(begin, std::min(begin + row_chunk_size, num_rows)));
+    }
+    give_dynamic_chunks();
+    break;
+  }
+}
+
+void MergeForest::init_core_data(Matrix_Data& data) const {
+  data.A = matrix_data.A;
+  data.B = matrix_data.B;
+  data.compute_result = matrix_data.compute_result;
+  data.verbose = false;
+  data.print_results = false;
+  // the cores write their rows in the arrays of the result matrix
+  data.C = matrix_view(matrix_data.C);
+  data.C.nnz = 0;
+  data.preproc_A_row_ptr = {0};
+  data.preproc_A_row_idx.clear();
+  data.preproc_C_row_ptr.clear();
+  data.preproc_A_values.clear();
+  data.preproc_B_row_ptr_end.clear();
+  data.preproc_row_segments.clear();
+  data.preproc_element_segments.clear();
+  data.num_mults = 0;
+  data.B_elements_addr = matrix_data.B_elements_addr;
+  data.C_row_ptr_addr = matrix_data.C_row_ptr_addr;
+  data.C_row_end_addr = matrix_data.C_row_end_addr;
+  data.C_elements_addr = matrix_data.C_elements_addr;
+  data.preproc_A_row_ptr_addr = matrix_data.preproc_A_row_ptr_addr;
+  data.preproc_A_row_idx_addr = matrix_data.preproc_A_row_idx_addr;
+  data.preproc_A_values_addr = matrix_data.preproc_A_values_addr;
+  data.preproc_B_row_ptr_end_addr = matrix_data.preproc_B_row_ptr_end_addr;
+  data.C_partials_base_addr = matrix_data.C_partials_base_addr;
+}
+
+void MergeForest::give_chunk(Core& core, const Row_Chunk& chunk) {
+  if (chunk.begin_row == chunk.end_row) { return; }
+  auto& data = core.data;
+  const auto& A_row_ptr = matrix_data.preproc_A_row_ptr;
+  const auto begin_element = A_row_ptr[chunk.begin_row];
+  const auto end_element = A_row_ptr[chunk.end_row];
+  add_segment(data.preproc_row_segments, data.preproc_A_row_idx.size(), chunk.begin_row);
+  add_segment(data.preproc_element_segments, data.preproc_A_values.size(), begin_element);
+  for (auto row = chunk.begin_row; row < chunk.end_row; ++row) {
+    data.preproc_A_row_ptr.push_back(data.preproc_A_row_ptr.back() + A_row_ptr[row + 1]
+                                     - A_row_ptr[row]);
+  }
+  const auto append = [](auto& dest, const auto& src, std::size_t begin, std::size_t end) {
+    dest.insert(dest.end(), src.begin() + static_cast<std::ptrdiff_t>(begin),
+                src.begin() + static_cast<std::ptrdiff_t>(end));
+  };
+  append(data.preproc_A_row_idx, matrix_data.preproc_A_row_idx, chunk.begin_row, chunk.end_row);
+  append(data.preproc_C_row_ptr, matrix_data.preproc_C_row_ptr, chunk.begin_row, chunk.end_row);
+  append(data.preproc_A_values, matrix_data.preproc_A_values, begin_element, end_element);
+  append(data.preproc_B_row_ptr_end, matrix_data.preproc_B_row_ptr_end, begin_element,
+         end_element);
+  data.num_mults += chunk.num_mults;
+  core.num_rows += chunk.end_row - chunk.begin_row;
+  core.chunk_end_mults.push_back(data.num_mults);
+}
+
+bool MergeForest::give_dynamic_chunks() {
+  bool given = false;
+  for (auto& core : cores) {
+    while (!core.chunk_end_mults.empty()
+           && core.merge_tree_manager.num_mults >= core.chunk_end_mults.front())
+    {
+      core.chunk_end_mults.pop_front();
+    }
+    while (next_row_chunk < row_chunks.size() && core.chunk_end_mults.size() < max_core_chunks) {
+      give_chunk(core, row_chunks[next_row_chunk]);
+      ++next_row_chunk;
+      given = true;
+    }
+  }
+  return given;
+}
+
+bool MergeForest::cores_finished() {
+  bool finished = true;
+  for (auto& core : cores) {
+    if (!core.merge_tree_manager.finished()) {
+      core.busy_cycles = cycles;
+      finished = false;
+    }
+  }
+  return finished;
+}
+
+bool MergeForest::cores_idle() const {
+  return std::ranges::all_of(cores, [](const Core& core) {
+    return core.merge_tree_manager.idle() && core.linked_list_cache.idle();
+  });
+}
+
+// A cycle in which no component changed its state is repeated until main
+// memory can answer the oldest pending read, so those cycles are only
+// accounted, not simulated.
+void MergeForest::skip_idle_cycles() {
+  const auto num_cycles = main_mem.cycles_to_next_event();
+  if (num_cycles == 0) { return; }
+  for (auto& core : cores) {
+    core.merge_tree_manager.skip_cycles(num_cycles);
+    core.linked_list_cache.skip_cycles(num_cycles);
+  }
+  main_mem.skip_cycles(num_cycles);
+  if (div_ceil(cycles + num_cycles, progress_interval)
+      != div_ceil(cycles, progress_interval)) {
+    print_progress();
+  }
+  cycles += num_cycles;
+}
+
+std::size_t MergeForest::cores_total(std::size_t mergeforest::Merge_Tree_Manager::* stat) const {
+  std::size_t total = 0;
+  for (const auto& core : cores) { total += core.merge_tree_manager.*stat; }
+  return total;
+}
+
+std::size_t MergeForest::cores_total(std::size_t mergeforest::Linked_List_Cache::* stat) const {
+  std::size_t total = 0;
+  for (const auto& core : cores) { total += core.linked_list_cache.*stat; }
+  return total;
+}
+
+std::size_t MergeForest::cores_max(std::size_t mergeforest::Merge_Tree_Manager::* stat) const {
+  std::size_t max = 0;
+  for (const auto& core : cores) { max = std::max(max, core.merge_tree_manager.*stat); }
+  return max;
+}
+
+std::size_t MergeForest::cores_max(std::size_t mergeforest::Linked_List_Cache::* stat) const {
+  std::size_t max = 0;
+  for (const auto& core : cores) { max = std::max(max, core.linked_list_cache.*stat); }
+  return max;
+}
+
 void MergeForest::check_valid_simulation() {
-  if (matrix_data.num_mults != merge_tree_manager.num_mults) {
+  using mergeforest::Merge_Tree_Manager;
+  using mergeforest::Linked_List_Cache;
+  if (matrix_data.num_mults != cores_total(&Merge_Tree_Manager::num_mults)) {
     spdlog::error("Number of multiplications doesn't match the expected value");
   }
-  const auto num_adds = merge_tree_manager.merge_tree_num_adds
-    + merge_tree_manager.dyn_num_adds;
+  const auto num_adds = cores_total(&Merge_Tree_Manager::merge_tree_num_adds)
+    + cores_total(&Merge_Tree_Manager::dyn_num_adds);
   if (matrix_data.num_mults != matrix_data.C.nnz + num_adds) {
     spdlog::error("Number of additions doesn't match the expected value");
   }
-  const auto num_reads = merge_tree_manager.preproc_A_reads
-    + linked_list_cache.preproc_A_reads + linked_list_cache.B_reads
-    + linked_list_cache.C_partial_reads;
+  const auto C_partial_reads = cores_total(&Linked_List_Cache::C_partial_reads);
+  const auto C_partial_writes = cores_total(&Linked_List_Cache::C_partial_writes);
+  const auto B_reads = cores_total(&Linked_List_Cache::B_reads);
+  const auto num_reads = cores_total(&Merge_Tree_Manager::preproc_A_reads)
+    + cores_total(&Linked_List_Cache::preproc_A_reads) + B_reads + C_partial_reads;
   if (main_mem.read_requests != num_reads) {
     spdlog::error("Number of reads in Main Memory doesn't match the rest of the system");
   }
-  const auto num_writes = merge_tree_manager.C_writes
-    + linked_list_cache.C_partial_writes;
+  const auto num_writes = cores_total(&Merge_Tree_Manager::C_writes) + C_partial_writes;
   if (main_mem.write_requests != num_writes) {
     spdlog::error("Number of writes in Main Memory doesn't match the rest of the system");
   }
-  if (linked_list_cache.C_partial_reads != linked_list_cache.C_partial_writes) {
+  if (C_partial_reads != C_partial_writes) {
     spdlog::error("Number of reads and writes of C partial data doesn't match");
   }
-  const auto B_bytes_read = linked_list_cache.B_elements_read * element_size;
-  if (B_bytes_read < matrix_data.min_bytes_B_data) {
+  // a warmed up cache may hold B rows that are then never read
+  const bool cold_cache = matrix_data.warmup_B_row_ptr_end.empty();
+  const auto B_bytes_read = cores_total(&Linked_List_Cache::B_elements_read) * element_size;
+  if (cold_cache && B_bytes_read < matrix_data.min_bytes_B_data) {
     spdlog::error("Number of B bytes read too small");
   }
   if (B_bytes_read > matrix_data.max_bytes_B_data) {
     spdlog::error("Number of B bytes read too big");
   }
-  if (linked_list_cache.B_reads < matrix_data.B_data_min_reads) {
+  if (cold_cache && B_reads < matrix_data.B_data_min_reads) {
     spdlog::error("Number of B reads read too small");
   }
-  if (linked_list_cache.B_reads > matrix_data.B_data_max_reads) {
+  if (B_reads > matrix_data.B_data_max_reads) {
     spdlog::error("Number of B reads read too big");
   }
-  if (linked_list_cache.fetched_rows + linked_list_cache.reused_rows
-      != matrix_data.preproc_B_row_ptr_end.size())
+  if (cores_total(&Linked_List_Cache::fetched_rows)
+      + cores_total(&Linked_List_Cache::reused_rows) != matrix_data.preproc_B_row_ptr_end.size())
   {
     spdlog::error("Number of fetched and reused B rows "
                   "doesn't match total number of B rows");
@@ -135,46 +480,54 @@ void MergeForest::check_valid_simulation() {
 
 void MergeForest::print_stats() {
   if (out_path.empty()) {
-    print_stats_impl(std::cout);
+    print_stats(std::cout);
   } else {
     std::ofstream of;
     of.open(out_path.data());
-    print_stats_impl(of);
+    print_stats(of);
   }
 }
 
-void MergeForest::print_stats_impl(std::ostream& os) {
+void MergeForest::print_stats(std::ostream& os) {
+  using mergeforest::Merge_Tree_Manager;
+  using mergeforest::Linked_List_Cache;
+  // the cores have the same config parameters, their stats are added up
+  const auto& merge_tree_manager = cores.front().merge_tree_manager;
+  const auto& linked_list_cache = cores.front().linked_list_cache;
   const double period_ns = toml::find_or(parsed_config, "clock_period_ns", 1.0);
   const auto exec_time_ns = static_cast<double>(cycles) * period_ns;
   const auto exec_time_ms = exec_time_ns * 1e-6;
   const auto Gflops = static_cast<double>(matrix_data.num_mults) / exec_time_ns;
   const auto block_mults_ratio = ratio(matrix_data.num_mults,
-                                       merge_tree_manager.num_block_mults
+                                       cores_total(&Merge_Tree_Manager::num_block_mults)
                                        * merge_tree_manager.merge_tree_merger_width) * 100.0;
-  const auto num_adds = merge_tree_manager.merge_tree_num_adds + merge_tree_manager.dyn_num_adds;
-  const auto merge_tree_adds_ratio = ratio(merge_tree_manager.merge_tree_num_adds,
-                                           merge_tree_manager.merge_tree_num_merges
+  const auto num_adds = cores_total(&Merge_Tree_Manager::merge_tree_num_adds)
+    + cores_total(&Merge_Tree_Manager::dyn_num_adds);
+  const auto merge_tree_adds_ratio = ratio(cores_total(&Merge_Tree_Manager::merge_tree_num_adds),
+                                           cores_total(&Merge_Tree_Manager::merge_tree_num_merges)
                                            * merge_tree_manager.merge_tree_merger_num_adds) * 100.0;
-  const auto dyn_adds_ratio = ratio(merge_tree_manager.dyn_num_adds,
-                                    merge_tree_manager.dyn_num_merges
+  const auto dyn_adds_ratio = ratio(cores_total(&Merge_Tree_Manager::dyn_num_adds),
+                                    cores_total(&Merge_Tree_Manager::dyn_num_merges)
                                     * merge_tree_manager.dyn_merger_num_adds) * 100.0;
-  const auto dyn_merges_per_cycle = ratio(merge_tree_manager.dyn_num_merges, cycles);
+  const auto dyn_merges_per_cycle = ratio(cores_total(&Merge_Tree_Manager::dyn_num_merges),
+                                          cycles);
   const auto num_trees = merge_tree_manager.num_cache_read_ports();
-  const auto idle_cycles_ratio = ratio(merge_tree_manager.num_idle_cycles,
-                                       cycles * num_trees) * 100.0;
-  const auto A_data_stalls_ratio = ratio(merge_tree_manager.A_data_stalls,
-                                         cycles) * 100.0;
-  const auto C_partial_stalls_ratio = ratio(merge_tree_manager.C_partial_stalls,
-                                         cycles) * 100.0;
-  const auto cache_bandwidth = ratio(linked_list_cache.reads + linked_list_cache.writes, cycles);
-  const auto active_blocks_avg = ratio(linked_list_cache.num_active_blocks_avg,
-                                       linked_list_cache.num_samples);
-  const auto inactive_blocks_avg = ratio(linked_list_cache.num_inactive_blocks_avg,
-                                         linked_list_cache.num_samples);
-  const auto C_partial_blocks_avg = ratio(linked_list_cache.num_C_partial_blocks_avg,
-                                          linked_list_cache.num_samples);
-  const auto free_blocks_avg = ratio(linked_list_cache.num_free_blocks_avg,
-                                     linked_list_cache.num_samples);
+  const auto idle_cycles_ratio = ratio(cores_total(&Merge_Tree_Manager::num_idle_cycles),
+                                       cycles * num_trees * cores.size()) * 100.0;
+  const auto A_data_stalls_ratio = ratio(cores_total(&Merge_Tree_Manager::A_data_stalls),
+                                         cycles * cores.size()) * 100.0;
+  const auto C_partial_stalls_ratio = ratio(cores_total(&Merge_Tree_Manager::C_partial_stalls),
+                                            cycles * cores.size()) * 100.0;
+  const auto cache_bandwidth = ratio(cores_total(&Linked_List_Cache::reads)
+                                     + cores_total(&Linked_List_Cache::writes), cycles);
+  const auto active_blocks_avg = ratio(cores_total(&Linked_List_Cache::num_active_blocks_avg),
+                                       cores_total(&Linked_List_Cache::num_samples));
+  const auto inactive_blocks_avg = ratio(cores_total(&Linked_List_Cache::num_inactive_blocks_avg),
+                                         cores_total(&Linked_List_Cache::num_samples));
+  const auto C_partial_blocks_avg = ratio(cores_total(&Linked_List_Cache::num_C_partial_blocks_avg),
+                                          cores_total(&Linked_List_Cache::num_samples));
+  const auto free_blocks_avg = ratio(cores_total(&Linked_List_Cache::num_free_blocks_avg),
+                                     cores_total(&Linked_List_Cache::num_samples));
   const auto active_blocks_ratio = ratio(active_blocks_avg, linked_list_cache.num_blocks) * 100.0;
   const auto inactive_blocks_ratio =
     ratio(inactive_blocks_avg, linked_list_cache.num_blocks) * 100.0;
@@ -187,16 +540,16 @@ void MergeForest::print_stats_impl(std::ostream& os) {
   const auto bandwidth = mem_traffic_bytes / exec_time_ns;
   const auto op_intensity =
     static_cast<double>(matrix_data.num_mults) / mem_traffic_bytes;
-  const auto preproc_A_reads = merge_tree_manager.preproc_A_reads
-    + linked_list_cache.preproc_A_reads;
+  const auto preproc_A_reads = cores_total(&Merge_Tree_Manager::preproc_A_reads)
+    + cores_total(&Linked_List_Cache::preproc_A_reads);
   const auto preproc_A_bytes_read = sizeof(uint32_t) * (
     matrix_data.preproc_A_row_ptr.size()
     + matrix_data.preproc_A_row_idx.size()
     + matrix_data.preproc_C_row_ptr.size()
     + 2 * matrix_data.preproc_B_row_ptr_end.size())
     + sizeof(double) * matrix_data.preproc_A_values.size();
-  const auto B_bytes_read = linked_list_cache.B_elements_read * element_size;
-  const auto C_partial_bytes_rw = linked_list_cache.C_partial_reads
+  const auto B_bytes_read = cores_total(&Linked_List_Cache::B_elements_read) * element_size;
+  const auto C_partial_bytes_rw = cores_total(&Linked_List_Cache::C_partial_reads)
     * mem_transaction_size;
   const auto mem_bytes_read = preproc_A_bytes_read + B_bytes_read + C_partial_bytes_rw;
   const auto unused_read_bytes_ratio =
@@ -207,8 +560,9 @@ void MergeForest::print_stats_impl(std::ostream& os) {
                                                            mem_bytes_write);
   const auto unused_A_bytes_ratio = unused_bytes_ratio(preproc_A_reads,
                                                        preproc_A_bytes_read);
-  const auto unused_B_bytes_ratio = unused_bytes_ratio(linked_list_cache.B_reads, B_bytes_read);
-  const auto unused_C_bytes_ratio = unused_bytes_ratio(merge_tree_manager.C_writes,
+  const auto unused_B_bytes_ratio = unused_bytes_ratio(cores_total(&Linked_List_Cache::B_reads),
+                                                       B_bytes_read);
+  const auto unused_C_bytes_ratio = unused_bytes_ratio(cores_total(&Merge_Tree_Manager::C_writes),
                                                        C_bytes_write);
   const auto total_unused_bytes_ratio = unused_bytes_ratio(mem_traffic,
                                                            mem_bytes_read + mem_bytes_write);
@@ -222,37 +576,38 @@ void MergeForest::print_stats_impl(std::ostream& os) {
   fmt::print(os, "*---Merge_Tree_Manager---*\n");
   fmt::print(os, "Number flops (mults): {}\n", matrix_data.num_mults);
   fmt::print(os, "Number block mults: {} ({:.4f}%) utilization\n",
-             merge_tree_manager.num_block_mults, block_mults_ratio);
+             cores_total(&Merge_Tree_Manager::num_block_mults), block_mults_ratio);
   fmt::print(os, "Number adds : {}\n", num_adds);
   fmt::print(os, "Number merge tree merges : {} ({:.4f}% adder utilization)\n",
-             merge_tree_manager.merge_tree_num_merges,
+             cores_total(&Merge_Tree_Manager::merge_tree_num_merges),
              merge_tree_adds_ratio);
   fmt::print(os, "Number dynamic merges : {} ({:.4f}% adder utilization)\n",
-             merge_tree_manager.dyn_num_merges,
+             cores_total(&Merge_Tree_Manager::dyn_num_merges),
              dyn_adds_ratio);
   fmt::print(os, "Dynamic merges per cycle: {:.4f}\n", dyn_merges_per_cycle);
-  fmt::print(os, "Idle cycles: {} ({:.4f}%)\n", merge_tree_manager.num_idle_cycles,
+  fmt::print(os, "Idle cycles: {} ({:.4f}%)\n", cores_total(&Merge_Tree_Manager::num_idle_cycles),
 	     idle_cycles_ratio);
-  fmt::print(os, "A data stalls: {} ({:.4f}%)\n", merge_tree_manager.A_data_stalls,
+  fmt::print(os, "A data stalls: {} ({:.4f}%)\n", cores_total(&Merge_Tree_Manager::A_data_stalls),
 	     A_data_stalls_ratio);
-  fmt::print(os, "C partial stalls: {} ({:.4f}%)\n", merge_tree_manager.C_partial_stalls,
+  fmt::print(os, "C partial stalls: {} ({:.4f}%)\n",
+             cores_total(&Merge_Tree_Manager::C_partial_stalls),
 	     C_partial_stalls_ratio);
-  fmt::print(os, "C partial rows: {}\n", merge_tree_manager.num_C_partial_rows);
+  fmt::print(os, "C partial rows: {}\n", cores_total(&Merge_Tree_Manager::num_C_partial_rows));
   fmt::print(os, "C partial elements: {}\n",
-	     merge_tree_manager.num_C_partial_elements);
-  fmt::print(os, "Max write bytes: {}\n", merge_tree_manager.max_write_bytes);
+	     cores_total(&Merge_Tree_Manager::num_C_partial_elements));
+  fmt::print(os, "Max write bytes: {}\n", cores_max(&Merge_Tree_Manager::max_write_bytes));
   fmt::print(os, "*---Linked List Cache---*\n");
-  fmt::print(os, "Cache reads: {}\n", linked_list_cache.reads);
-  fmt::print(os, "Cache writes: {}\n", linked_list_cache.writes);
+  fmt::print(os, "Cache reads: {}\n", cores_total(&Linked_List_Cache::reads));
+  fmt::print(os, "Cache writes: {}\n", cores_total(&Linked_List_Cache::writes));
   fmt::print(os, "Cache bandwidth: {:.4f} blocks/cycle\n",
 	     cache_bandwidth);
-  fmt::print(os, "Fetched rows: {}\n", linked_list_cache.fetched_rows);
-  fmt::print(os, "Reused rows: {}\n", linked_list_cache.reused_rows);
-  fmt::print(os, "Evicted rows: {}\n", linked_list_cache.evictions);
+  fmt::print(os, "Fetched rows: {}\n", cores_total(&Linked_List_Cache::fetched_rows));
+  fmt::print(os, "Reused rows: {}\n", cores_total(&Linked_List_Cache::reused_rows));
+  fmt::print(os, "Evicted rows: {}\n", cores_total(&Linked_List_Cache::evictions));
   fmt::print(os, "Max active rows: {}\n",
-	     linked_list_cache.stats_max_active_rows);
+	     cores_max(&Linked_List_Cache::stats_max_active_rows));
   fmt::print(os, "Max inactive rows: {}\n",
-	     linked_list_cache.stats_max_inactive_rows);
+	     cores_max(&Linked_List_Cache::stats_max_inactive_rows));
   fmt::print(os, "Average active blocks: {:.4f} ({:.4f}%)\n",
 	     active_blocks_avg, active_blocks_ratio);
   fmt::print(os, "Average inactive blocks: {:.4f} ({:.4f}%)\n",
@@ -263,11 +618,11 @@ void MergeForest::print_stats_impl(std::ostream& os) {
 	     free_blocks_avg, free_blocks_ratio);
 
   fmt::print(os, "Max free lists: {}\n",
-	     linked_list_cache.max_free_lists);
+	     cores_max(&Linked_List_Cache::max_free_lists));
   fmt::print(os, "Max fetched rows: {}\n",
-	     linked_list_cache.stats_max_fetched_rows);
+	     cores_max(&Linked_List_Cache::stats_max_fetched_rows));
   fmt::print(os, "Max outstanding reqs: {}\n",
-	     linked_list_cache.stats_max_outstanding_reqs);
+	     cores_max(&Linked_List_Cache::stats_max_outstanding_reqs));
   fmt::print(os, "*---Main Memory---*\n");
   fmt::print(os, "Memory bandwidth: {:.4f} GB/s\n", bandwidth);
   fmt::print(os, "Operational intensity: {:.4f} flop/byte\n", op_intensity);
@@ -284,8 +639,8 @@ void MergeForest::print_stats_impl(std::ostream& os) {
 	     preproc_A_reads, reqs_to_MB(preproc_A_reads),
 	     unused_A_bytes_ratio);
   fmt::print(os, "B data reads: {} ({:.4f} MB) ({:.4f}% unused)\n",
-	     linked_list_cache.B_reads,
-	     reqs_to_MB(linked_list_cache.B_reads),
+	     cores_total(&Linked_List_Cache::B_reads),
+	     reqs_to_MB(cores_total(&Linked_List_Cache::B_reads)),
 	     unused_B_bytes_ratio);
   fmt::print(os, "B data min reads: {} ({:.4f} MB)\n",
 	     matrix_data.B_data_min_reads,
@@ -294,14 +649,42 @@ void MergeForest::print_stats_impl(std::ostream& os) {
 	     matrix_data.B_data_max_reads_fiber_cache,
 	     reqs_to_MB(matrix_data.B_data_max_reads_fiber_cache));
   fmt::print(os, "C partial reads/writes: {} ({:.4f} MB) (0% unused)\n",
-	     linked_list_cache.C_partial_reads,
-	     reqs_to_MB(linked_list_cache.C_partial_reads));
+	     cores_total(&Linked_List_Cache::C_partial_reads),
+	     reqs_to_MB(cores_total(&Linked_List_Cache::C_partial_reads)));
   fmt::print(os, "C data writes: {} ({:.4f} MB) ({:.4f}% unused)\n",
-	     merge_tree_manager.C_writes,
-	     reqs_to_MB(merge_tree_manager.C_writes), unused_C_bytes_ratio);
+	     cores_total(&Merge_Tree_Manager::C_writes),
+	     reqs_to_MB(cores_total(&Merge_Tree_Manager::C_writes)), unused_C_bytes_ratio);
   fmt::print(os, "A data bytes read: {}\n", preproc_A_bytes_read);
   fmt::print(os, "B data bytes read: {}\n", B_bytes_read);
   fmt::print(os, "C data bytes written: {}\n", C_bytes_write);
+  print_cores_stats(os);
+  main_mem.print_dram_stats(os, cycles);
+  matrix_data.print_row_order(os);
+  matrix_data.host_metrics.print(os, cycles);
+}
+
+void MergeForest::print_cores_stats(std::ostream& os) const {
+  if (cores.size() == 1) { return; }
+  static constexpr std::array distribution_names {"blocks", "round_robin", "dynamic"};
+  std::size_t max_busy_cycles = 0;
+  std::size_t total_busy_cycles = 0;
+  for (const auto& core : cores) {
+    max_busy_cycles = std::max(max_busy_cycles, core.busy_cycles);
+    total_busy_cycles += core.busy_cycles;
+  }
+  fmt::print(os, "*---Cores---*\n");
+  fmt::print(os, "Num cores: {}\n", cores.size());
+  fmt::print(os, "Row distribution: {} ({} rows per chunk)\n",
+             distribution_names[static_cast<std::size_t>(row_distribution)], row_chunk_size);
+  for (std::size_t c = 0; c < cores.size(); ++c) {
+    const auto& core = cores[c];
+    fmt::print(os, "Core {}: {} rows, {} mults, {} busy cycles, {} B data reads, "
+               "{} fetched rows, {} reused rows\n", c, core.num_rows, core.data.num_mults,
+               core.busy_cycles, core.linked_list_cache.B_reads,
+               core.linked_list_cache.fetched_rows, core.linked_list_cache.reused_rows);
+  }
+  fmt::print(os, "Load imbalance: {:.4f} (max / mean busy cycles)\n",
+             ratio(max_busy_cycles * cores.size(), total_busy_cycles));
 }
 
 } // namespace mergeforest_sim
@@ -0,0 +1,129 @@
+#ifndef MERGEFOREST_SIM_PARALLEL_HPP
+#define MERGEFOREST_SIM_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <cstddef>
+
+namespace mergeforest_sim {
+
+inline unsigned num_threads() {
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+inline std::size_t num_parallel_blocks(std::size_t size, std::size_t min_block_size = 1,
+                                      std::size_t max_blocks = num_threads())
+{
+  return std::clamp<std::size_t>(size / std::max<std::size_t>(min_block_size, 1), 1,
+                                 std::max<std::size_t>(max_blocks, 1));
+}
+
+// Splits [0, size) in num_parallel_blocks(size, min_block_size, max_blocks)
+// contiguous blocks and calls func(block_idx, begin, end) for each block in
+// its own thread. The split only depends on the arguments. Returns the number
+// of blocks used.
+template<typename Func>
+std::size_t parallel_blocks(std::size_t size, Func&& func,
+                            std::size_t min_block_size = 1,
+                            std::size_t max_blocks = num_threads())
+{
+  const std::size_t num_blocks = num_parallel_blocks(size, min_block_size, max_blocks);
+  if (num_blocks == 1) {
+    func(std::size_t{0}, std::size_t{0}, size);
+    return 1;
+  }
+  std::vector<std::exception_ptr> errors(num_blocks);
+  std::vector<std::thread> threads;
+  threads.reserve(num_blocks - 1);
+  const auto block_begin = [&](std::size_t block) {
+    return size / num_blocks * block + std::min(block, size % num_blocks);
+  };
+  const auto run_block = [&](std::size_t block) {
+    try {
+      func(block, block_begin(block), block_begin(block + 1));
+    } catch (...) {
+      errors[block] = std::current_exception();
+    }
+  };
+  for (std::size_t i = 1; i < num_blocks; ++i) {
+    threads.emplace_back(run_block, i);
+  }
+  run_block(0);
+  for (auto& t : threads) { t.join(); }
+  for (auto& e : errors) {
+    if (e) { std::rethrow_exception(e); }
+  }
+  return num_blocks;
+}
+
+// Calls func(job) for every job in [0, num_jobs) on num_workers threads. Each
+// worker takes the next unstarted job when it finishes its current one, so
+// jobs of very different lengths are balanced. If func takes two arguments it
+// is called as func(worker, job), with worker in [0, num_workers), so that
+// each worker can reuse its own scratch space. The first exception thrown by
+// a job is rethrown after all the workers finished.
+template<typename Func>
+void parallel_jobs(std::size_t num_jobs, Func&& func,
+                   std::size_t num_workers = num_threads())
+{
+  num_workers = std::clamp<std::size_t>(num_workers, 1, std::max<std::size_t>(num_jobs, 1));
+  std::atomic<std::size_t> next_job {0};
+  std::vector<std::exception_ptr> errors(num_workers);
+  const auto run_worker = [&](std::size_t worker) {
+    try {
+      for (auto job = next_job++; job < num_jobs; job = next_job++) {
+        if constexpr (std::is_invocable_v<Func&, std::size_t, std::size_t>) {
+          func(worker, job);
+        } else {
+          func(job);
+        }
+      }
+    } catch (...) {
+      errors[worker] = std::current_exception();
+      next_job = num_jobs;
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(num_workers - 1);
+  for (std::size_t i = 1; i < num_workers; ++i) {
+    threads.emplace_back(run_worker, i);
+  }
+  run_worker(0);
+  for (auto& t : threads) { t.join(); }
+  for (auto& e : errors) {
+    if (e) { std::rethrow_exception(e); }
+  }
+}
+
+// in place exclusive prefix sum of data[0, size), returns the total sum
+template<typename T>
+T parallel_exclusive_scan(T* data, std::size_t size,
+                          std::size_t min_block_size = std::size_t{1} << 16)
+{
+  std::vector<T> block_offsets(num_parallel_blocks(size, min_block_size) + 1, T{});
+  parallel_blocks(size, [&](std::size_t block, std::size_t begin, std::size_t end) {
+    T sum {};
+    for (std::size_t i = begin; i != end; ++i) { sum += data[i]; }
+    block_offsets[block + 1] = sum;
+  }, min_block_size);
+  for (std::size_t i = 1; i < block_offsets.size(); ++i) {
+    block_offsets[i] += block_offsets[i - 1];
+  }
+  parallel_blocks(size, [&](std::size_t block, std::size_t begin, std::size_t end) {
+    T sum = block_offsets[block];
+    for (std::size_t i = begin; i != end; ++i) {
+      const T value = data[i];
+      data[i] = sum;
+      sum += value;
+    }
+  }, min_block_size);
+  return block_offsets.back();
+}
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_PARALLEL_HPP
@@ -1,6 +1,9 @@
 #ifndef MERGEFOREST_SIM_PORT_HPP
 #define MERGEFOREST_SIM_PORT_HPP
 
+#include <mergeforest-sim/small_vector.hpp>
+
+#include <utility>
 #include <cstddef>
 #include <cstdint>
 #include <climits>
@@ -16,6 +19,8 @@ inline constexpr unsigned block_size = 8;
 inline constexpr std::size_t block_size_bytes = element_size * block_size;
 inline constexpr Address invalid_address = UINT64_MAX;
 
+// The messages are moved between the ports, so ports can carry move only
+// messages and messages with inline storage without allocating.
 template<typename Send, typename Recv>
 class Port {
   friend Port<Recv, Send>;
@@ -25,22 +30,24 @@ public:
     port->other = this;
   }
 
-  void transfer() {
+  // returns true if the message was moved to the other port
+  bool transfer() {
     assert(other != nullptr);
-    if (!msg_send_valid) return;
-    if (other->msg_recv_valid) return;
-    other->msg_recv = msg_send;
+    if (!msg_send_valid) return false;
+    if (other->msg_recv_valid) return false;
+    other->msg_recv = std::move(msg_send);
     other->msg_recv_valid = true;
     msg_send_valid = false;
+    return true;
   }
 
   bool has_msg_send() const {
     return msg_send_valid;
   }
 
-  bool add_msg_send(const Send& msg) {
+  bool add_msg_send(Send msg) {
     if (msg_send_valid) return false;
-    msg_send = msg;
+    msg_send = std::move(msg);
     msg_send_valid = true;
     return true;
   }
@@ -49,7 +56,7 @@ public:
     return msg_recv_valid;
   }
 
-  Recv get_msg_received() const {
+  const Recv& get_msg_received() const {
     return msg_recv;
   }
 
@@ -98,6 +105,10 @@ struct Prefetched_Row {
   unsigned row_head_ptr {UINT_MAX};
 };
 
+// maximum linked_list_cache.prefetched_rows_per_cycle
+inline constexpr unsigned max_prefetched_rows_per_cycle = 16;
+using Prefetched_Rows = Small_Vector<Prefetched_Row, max_prefetched_rows_per_cycle>;
+
 struct Cache_Read {
   bool valid() const { return row_ptr != UINT_MAX; }
 
@@ -0,0 +1,280 @@
+#include <mergeforest-sim/preproc_cache.hpp>
+#include <mergeforest-sim/hash.hpp>
+#include <mergeforest-sim/mapped_file.hpp>
+#include <mergeforest-sim/math_utils.hpp>
+#include <mergeforest-sim/port.hpp>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace mergeforest_sim {
+
+namespace {
+
+constexpr char cache_magic[8] = {'M', 'F', 'S', 'I', 'M', 'P', 'R', 'E'};
+constexpr uint32_t cache_version = 1;
+constexpr std::size_t cache_alignment = 64;
+
+static_assert(sizeof(std::pair<uint32_t, uint32_t>) == 2 * sizeof(uint32_t));
+
+enum Cache_Array : std::size_t {
+  C_row_ptr,
+  A_row_ptr,
+  A_row_idx,
+  preproc_C_row_ptr,
+  A_values,
+  B_row_ptr_end,
+  num_cache_arrays
+};
+
+struct Cache_Array_Layout {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct Cache_Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  // the cache is only valid for the same memory layout of B
+  uint32_t element_size;
+  uint32_t mem_transaction_size;
+  uint32_t block_size;
+  uint32_t C_num_rows;
+  uint32_t A_num_rows;
+  uint32_t A_num_cols;
+  uint32_t B_num_rows;
+  uint32_t B_num_cols;
+  uint64_t C_nnz;
+  uint64_t B_data_min_reads;
+  uint64_t B_data_max_reads;
+  uint64_t B_data_min_reads_fiber_cache;
+  uint64_t B_data_max_reads_fiber_cache;
+  uint64_t min_bytes_B_data;
+  uint64_t max_bytes_B_data;
+  uint64_t num_mults;
+  // offset and size in bytes of each array
+  Cache_Array_Layout arrays[num_cache_arrays];
+  uint64_t file_size;
+  // checksum of everything after the header
+  uint64_t checksum;
+};
+
+uint64_t matrix_hash(const Spmat_Csr& mtx) {
+  const std::array<uint64_t, 6> hashes {
+    mtx.num_rows, mtx.num_cols, mtx.nnz,
+    hash_bytes_parallel(reinterpret_cast<const char*>(mtx.row_ptr.data()),
+                        mtx.row_ptr.size() * sizeof(uint32_t)),
+    hash_bytes_parallel(reinterpret_cast<const char*>(mtx.col_idx.data()),
+                        mtx.nnz * sizeof(uint32_t)),
+    hash_bytes_parallel(reinterpret_cast<const char*>(mtx.values.data()),
+                        mtx.nnz * sizeof(double))
+  };
+  return hash_bytes(reinterpret_cast<const char*>(hashes.data()),
+                    hashes.size() * sizeof(uint64_t));
+}
+
+// sets the array offsets and file size from the array sizes
+void set_cache_layout(Cache_Header& header) {
+  uint64_t offset = sizeof(Cache_Header);
+  for (auto& array : header.arrays) {
+    array.offset = round_up_multiple<uint64_t>(offset, cache_alignment);
+    offset = array.offset + array.size;
+  }
+  header.file_size = offset;
+}
+
+template<typename T>
+void read_array(const Mapped_File& file, const Cache_Array_Layout& layout, std::vector<T>& vec) {
+  vec.resize(layout.size / sizeof(T));
+  std::memcpy(static_cast<void*>(vec.data()), file.data() + layout.offset, layout.size);
+}
+
+} // namespace
+
+std::string preproc_cache_filename(const std::string& cache_dir, const Spmat_Csr& A,
+                                   const Spmat_Csr& B)
+{
+  const auto A_hash = matrix_hash(A);
+  const auto B_hash = &A == &B ? A_hash : matrix_hash(B);
+  const auto cache_name = fmt::format("{:016x}_{:016x}.pre", A_hash, B_hash);
+  return (std::filesystem::path(cache_dir) / cache_name).string();
+}
+
+bool read_preproc_cache(const std::string& filename, Matrix_Data& matrix_data) {
+  if (!std::filesystem::exists(filename)) {
+    return false;
+  }
+  try {
+    const Mapped_File file(filename);
+    Cache_Header header {};
+    if (file.size() < sizeof(Cache_Header)) {
+      throw std::runtime_error("truncated header");
+    }
+    std::memcpy(&header, file.data(), sizeof(Cache_Header));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0
+        || header.header_size != sizeof(Cache_Header))
+    {
+      throw std::runtime_error("invalid header");
+    }
+    if (header.version != cache_version || header.element_size != element_size
+        || header.mem_transaction_size != mem_transaction_size
+        || header.block_size != block_size)
+    {
+      return false;
+    }
+    const auto& A = *matrix_data.A;
+    const auto& B = *matrix_data.B;
+    if (header.A_num_rows != A.num_rows || header.A_num_cols != A.num_cols
+        || header.B_num_rows != B.num_rows || header.B_num_cols != B.num_cols
+        || header.C_num_rows != A.num_rows)
+    {
+      throw std::runtime_error("matrix dimensions don't match");
+    }
+    Cache_Header expected = header;
+    set_cache_layout(expected);
+    const auto& arrays = header.arrays;
+    const auto num_rows = arrays[A_row_idx].size / sizeof(uint32_t);
+    const auto num_elements = arrays[A_values].size / sizeof(double);
+    if (std::memcmp(expected.arrays, arrays, sizeof(arrays)) != 0
+        || header.file_size != expected.file_size || file.size() != header.file_size
+        || arrays[C_row_ptr].size != (uint64_t{header.C_num_rows} + 1) * sizeof(uint32_t)
+        || arrays[A_row_ptr].size != (num_rows + 1) * sizeof(uint32_t)
+        || arrays[A_row_idx].size != num_rows * sizeof(uint32_t)
+        || arrays[preproc_C_row_ptr].size != num_rows * sizeof(uint32_t)
+        || arrays[A_values].size != num_elements * sizeof(double)
+        || arrays[B_row_ptr_end].size != num_elements * 2 * sizeof(uint32_t))
+    {
+      throw std::runtime_error("invalid array sizes");
+    }
+    const auto data_offset = arrays[0].offset;
+    if (hash_bytes_parallel(file.data() + data_offset, header.file_size - data_offset)
+        != header.checksum)
+    {
+      throw std::runtime_error("checksum mismatch");
+    }
+    auto& C = matrix_data.C;
+    C = Spmat_Csr{};
+    C.num_rows = A.num_rows;
+    C.num_cols = B.num_cols;
+    C.nnz = header.C_nnz;
+    std::vector<uint32_t> C_row_ptr_vec;
+    read_array(file, arrays[C_row_ptr], C_row_ptr_vec);
+    C.row_ptr = std::move(C_row_ptr_vec);
+    read_array(file, arrays[A_row_ptr], matrix_data.preproc_A_row_ptr);
+    read_array(file, arrays[A_row_idx], matrix_data.preproc_A_row_idx);
+    read_array(file, arrays[preproc_C_row_ptr], matrix_data.preproc_C_row_ptr);
+    read_array(file, arrays[A_values], matrix_data.preproc_A_values);
+    read_array(file, arrays[B_row_ptr_end], matrix_data.preproc_B_row_ptr_end);
+    matrix_data.B_data_min_reads = header.B_data_min_reads;
+    matrix_data.B_data_max_reads = header.B_data_max_reads;
+    matrix_data.B_data_min_reads_fiber_cache = header.B_data_min_reads_fiber_cache;
+    matrix_data.B_data_max_reads_fiber_cache = header.B_data_max_reads_fiber_cache;
+    matrix_data.min_bytes_B_data = header.min_bytes_B_data;
+    matrix_data.max_bytes_B_data = header.max_bytes_B_data;
+    matrix_data.num_mults = header.num_mults;
+    return true;
+  } catch (const std::exception& e) {
+    spdlog::warn("ignoring preprocessing cache \"{}\": {}", filename, e.what());
+    return false;
+  }
+}
+
+void write_preproc_cache(const std::string& filename, const Matrix_Data& matrix_data) {
+  const auto& A = *matrix_data.A;
+  const auto& B = *matrix_data.B;
+  const auto& C = matrix_data.C;
+  std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+  // write to a temporary file first so concurrent runs never see a partial
+  // cache, named after the process and the thread that writes it
+  const auto tmp_filename = fmt::format("{}.tmp{}_{:x}", filename, ::getpid(),
+                                        std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  Cache_Header header {};
+  std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+  header.version = cache_version;
+  header.header_size = sizeof(Cache_Header);
+  header.element_size = element_size;
+  header.mem_transaction_size = mem_transaction_size;
+  header.block_size = block_size;
+  header.C_num_rows = C.num_rows;
+  header.A_num_rows = A.num_rows;
+  header.A_num_cols = A.num_cols;
+  header.B_num_rows = B.num_rows;
+  header.B_num_cols = B.num_cols;
+  header.C_nnz = C.nnz;
+  header.B_data_min_reads = matrix_data.B_data_min_reads;
+  header.B_data_max_reads = matrix_data.B_data_max_reads;
+  header.B_data_min_reads_fiber_cache = matrix_data.B_data_min_reads_fiber_cache;
+  header.B_data_max_reads_fiber_cache = matrix_data.B_data_max_reads_fiber_cache;
+  header.min_bytes_B_data = matrix_data.min_bytes_B_data;
+  header.max_bytes_B_data = matrix_data.max_bytes_B_data;
+  header.num_mults = matrix_data.num_mults;
+  const std::array<const void*, num_cache_arrays> array_data {
+    C.row_ptr.data(),
+    matrix_data.preproc_A_row_ptr.data(),
+    matrix_data.preproc_A_row_idx.data(),
+    matrix_data.preproc_C_row_ptr.data(),
+    matrix_data.preproc_A_values.data(),
+    matrix_data.preproc_B_row_ptr_end.data()
+  };
+  header.arrays[C_row_ptr].size = C.row_ptr.size() * sizeof(uint32_t);
+  header.arrays[A_row_ptr].size = matrix_data.preproc_A_row_ptr.size() * sizeof(uint32_t);
+  header.arrays[A_row_idx].size = matrix_data.preproc_A_row_idx.size() * sizeof(uint32_t);
+  header.arrays[preproc_C_row_ptr].size =
+    matrix_data.preproc_C_row_ptr.size() * sizeof(uint32_t);
+  header.arrays[A_values].size = matrix_data.preproc_A_values.size() * sizeof(double);
+  header.arrays[B_row_ptr_end].size =
+    matrix_data.preproc_B_row_ptr_end.size() * 2 * sizeof(uint32_t);
+  set_cache_layout(header);
+  {
+    std::ofstream output(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (!output) {
+      throw std::runtime_error("unable to open file \"" + tmp_filename + "\" for writing");
+    }
+    const auto write_array = [&](uint64_t offset, const void* data, std::size_t size) {
+      const std::vector<char> padding(offset - static_cast<uint64_t>(output.tellp()), 0);
+      output.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+      output.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+    write_array(0, &header, sizeof(Cache_Header));
+    for (std::size_t i = 0; i < num_cache_arrays; ++i) {
+      write_array(header.arrays[i].offset, array_data[i], header.arrays[i].size);
+    }
+    if (!output) {
+      output.close();
+      std::filesystem::remove(tmp_filename);
+      throw std::runtime_error("unable to write file \"" + tmp_filename + "\"");
+    }
+  }
+  {
+    const Mapped_File file(tmp_filename);
+    const auto data_offset = header.arrays[0].offset;
+    header.checksum = hash_bytes_parallel(file.data() + data_offset,
+                                          header.file_size - data_offset);
+  }
+  {
+    std::fstream output(tmp_filename, std::ios::binary | std::ios::in | std::ios::out);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(Cache_Header));
+    if (!output) {
+      output.close();
+      std::filesystem::remove(tmp_filename);
+      throw std::runtime_error("unable to write file \"" + tmp_filename + "\"");
+    }
+  }
+  std::filesystem::rename(tmp_filename, filename);
+}
+
+} // namespace mergeforest_sim
@@ -0,0 +1,27 @@
+#ifndef MERGEFOREST_SIM_PREPROC_CACHE_HPP
+#define MERGEFOREST_SIM_PREPROC_CACHE_HPP
+
+#include <mergeforest-sim/matrix_data.hpp>
+#include <mergeforest-sim/sparse_matrix.hpp>
+
+#include <string>
+
+namespace mergeforest_sim {
+
+// Binary cache of the results of Matrix_Data::preprocess_mats that don't
+// depend on the architecture: the preprocessed arrays, the row pointers of C
+// and the B data counters. The cache files are stored in a cache directory
+// and named after hashes of the contents of A and B, so the cache of a pair
+// of matrices is found regardless of where they were loaded from.
+std::string preproc_cache_filename(const std::string& cache_dir, const Spmat_Csr& A,
+                                   const Spmat_Csr& B);
+
+// returns false if the cache doesn't exist or is invalid or corrupted,
+// otherwise sets the preprocessed data of matrix_data
+bool read_preproc_cache(const std::string& filename, Matrix_Data& matrix_data);
+
+void write_preproc_cache(const std::string& filename, const Matrix_Data& matrix_data);
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_PREPROC_CACHE_HPP
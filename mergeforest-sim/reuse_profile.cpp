@@ -0,0 +1,176 @@
+#include <mergeforest-sim/reuse_profile.hpp>
+#include <mergeforest-sim/flat_map.hpp>
+#include <mergeforest-sim/math_utils.hpp>
+#include <mergeforest-sim/port.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+namespace {
+
+// counts of the positions of the last uses, the sums of the counts between
+// two positions are the distinct blocks used in between
+class Fenwick_Tree {
+public:
+  explicit Fenwick_Tree(std::size_t size) : tree(size + 1) {}
+
+  void add(std::size_t pos, uint32_t count) {
+    for (++pos; pos < tree.size(); pos += pos & (~pos + 1)) { tree[pos] += count; }
+  }
+  void remove(std::size_t pos, uint32_t count) {
+    for (++pos; pos < tree.size(); pos += pos & (~pos + 1)) { tree[pos] -= count; }
+  }
+  // sum of the counts of [0, end)
+  std::size_t prefix_sum(std::size_t end) const {
+    std::size_t sum = 0;
+    for (; end > 0; end -= end & (~end + 1)) { sum += tree[end]; }
+    return sum;
+  }
+private:
+  std::vector<uint32_t> tree;
+};
+
+constexpr std::size_t exact_buckets = 4;
+
+} // namespace
+
+std::size_t Stack_Distance_Histogram::bucket(std::size_t distance) {
+  if (distance <= exact_buckets) { return distance > 0 ? distance - 1 : 0; }
+  // (2^k, 2^(k+1)] is split in 4 buckets of 2^(k-2) distances
+  const std::size_t k = std::bit_width(distance - 1) - 1;
+  return exact_buckets + (k - 2) * 4 + ((distance - 1 - (std::size_t{1} << k)) >> (k - 2));
+}
+
+std::size_t Stack_Distance_Histogram::bucket_end(std::size_t bucket) {
+  if (bucket < exact_buckets) { return bucket + 1; }
+  const auto k = (bucket - exact_buckets) / 4 + 2;
+  const auto sub_bucket = (bucket - exact_buckets) % 4;
+  return (std::size_t{1} << k) + ((sub_bucket + 1) << (k - 2));
+}
+
+void Stack_Distance_Histogram::add(std::size_t distance, std::size_t blocks) {
+  const auto b = bucket(distance);
+  if (b >= bucket_refs.size()) {
+    bucket_refs.resize(b + 1);
+    bucket_blocks.resize(b + 1);
+  }
+  ++bucket_refs[b];
+  bucket_blocks[b] += blocks;
+  ++num_refs;
+  num_blocks += blocks;
+  distance_sum += static_cast<double>(distance);
+}
+
+void Stack_Distance_Histogram::add_cold(std::size_t blocks) {
+  ++cold_refs;
+  cold_blocks += blocks;
+  ++num_refs;
+  num_blocks += blocks;
+}
+
+double Stack_Distance_Histogram::misses(std::size_t cache_blocks,
+                                        const std::vector<std::size_t>& counts) const
+{
+  double sum = 0.0;
+  std::size_t begin = 0;
+  for (std::size_t b = 0; b < counts.size(); ++b) {
+    const auto end = bucket_end(b);
+    if (cache_blocks <= begin) {
+      sum += static_cast<double>(counts[b]);
+    } else if (cache_blocks < end) {
+      sum += static_cast<double>(counts[b]) * static_cast<double>(end - cache_blocks)
+        / static_cast<double>(end - begin);
+    }
+    begin = end;
+  }
+  return sum;
+}
+
+double Stack_Distance_Histogram::misses(std::size_t cache_blocks) const {
+  return static_cast<double>(cold_refs) + misses(cache_blocks, bucket_refs);
+}
+
+double Stack_Distance_Histogram::miss_blocks(std::size_t cache_blocks) const {
+  return static_cast<double>(cold_blocks) + misses(cache_blocks, bucket_blocks);
+}
+
+std::size_t Stack_Distance_Histogram::max_distance() const {
+  return bucket_refs.empty() ? 0 : bucket_end(bucket_refs.size() - 1);
+}
+
+double Stack_Distance_Histogram::mean_distance() const {
+  const auto num_reuses = num_refs - cold_refs;
+  return num_reuses > 0 ? distance_sum / static_cast<double>(num_reuses) : 0.0;
+}
+
+B_Reuse_Profile B_Reuse_Profile::compute(const std::vector<std::pair<uint32_t, uint32_t>>& B_row_ptr_end,
+                                         std::size_t num_intervals)
+{
+  B_Reuse_Profile profile;
+  const auto num_refs = B_row_ptr_end.size();
+  num_intervals = std::max<std::size_t>(std::min(num_intervals, num_refs), 1);
+  std::size_t num_block_refs = 0;
+  std::size_t num_B_blocks = 0;
+  for (const auto& [B_row_ptr, B_row_end] : B_row_ptr_end) {
+    num_block_refs += div_ceil(B_row_end, block_size) - B_row_ptr / block_size;
+    num_B_blocks = std::max<std::size_t>(num_B_blocks, div_ceil(B_row_end, block_size));
+  }
+  // last use and last interval of each B row and block
+  struct Last_Use {
+    std::size_t ref {SIZE_MAX};
+    std::size_t interval {SIZE_MAX};
+  };
+  Flat_Map<uint32_t, Last_Use, UINT32_MAX> row_last_uses;
+  std::vector<Last_Use> block_last_uses(num_B_blocks);
+  Fenwick_Tree row_uses(num_refs);
+  Fenwick_Tree block_uses(num_block_refs);
+  std::size_t block_ref = 0;
+  for (std::size_t interval = 0; interval < num_intervals; ++interval) {
+    Working_Set working_set {.begin_ref = num_refs * interval / num_intervals,
+                             .end_ref = num_refs * (interval + 1) / num_intervals};
+    for (auto ref = working_set.begin_ref; ref < working_set.end_ref; ++ref) {
+      const auto [B_row_ptr, B_row_end] = B_row_ptr_end[ref];
+      const auto row_blocks = div_ceil(B_row_end - B_row_ptr, block_size);
+      auto& row_last_use = row_last_uses[B_row_ptr];
+      if (row_last_use.ref == SIZE_MAX) {
+        profile.rows.add_cold(row_blocks);
+      } else {
+        const auto distance = row_uses.prefix_sum(ref) - row_uses.prefix_sum(row_last_use.ref + 1);
+        profile.rows.add(distance + row_blocks, row_blocks);
+        row_uses.remove(row_last_use.ref, row_blocks);
+      }
+      row_uses.add(ref, row_blocks);
+      row_last_use.ref = ref;
+      if (row_last_use.interval != interval) {
+        row_last_use.interval = interval;
+        ++working_set.num_rows;
+      }
+      for (auto block = B_row_ptr / block_size; block * block_size < B_row_end; ++block) {
+        auto& block_last_use = block_last_uses[block];
+        if (block_last_use.ref == SIZE_MAX) {
+          profile.blocks.add_cold(1);
+        } else {
+          const auto distance = block_uses.prefix_sum(block_ref)
+            - block_uses.prefix_sum(block_last_use.ref + 1);
+          profile.blocks.add(distance + 1, 1);
+          block_uses.remove(block_last_use.ref, 1);
+        }
+        block_uses.add(block_ref, 1);
+        block_last_use.ref = block_ref;
+        if (block_last_use.interval != interval) {
+          block_last_use.interval = interval;
+          ++working_set.num_blocks;
+        }
+        ++block_ref;
+      }
+    }
+    profile.working_sets.push_back(working_set);
+  }
+  return profile;
+}
+
+} // namespace mergeforest_sim
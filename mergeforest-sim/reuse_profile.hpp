@@ -0,0 +1,68 @@
+#ifndef MERGEFOREST_SIM_REUSE_PROFILE_HPP
+#define MERGEFOREST_SIM_REUSE_PROFILE_HPP
+
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+// Histogram of the LRU stack distances of a sequence of references to B, in
+// blocks: the number of distinct blocks used since the previous use of the
+// referenced data, including its own blocks. A fully associative LRU cache
+// of N blocks hits the references with stack distance up to N. The buckets
+// are exact up to 4 blocks and split each power of two in 4 above.
+class Stack_Distance_Histogram {
+public:
+  void add(std::size_t distance, std::size_t num_blocks);
+  // first use of the referenced data
+  void add_cold(std::size_t num_blocks);
+  // references missed and blocks read by a fully associative LRU cache of
+  // cache_blocks blocks, interpolated within the buckets
+  double misses(std::size_t cache_blocks) const;
+  double miss_blocks(std::size_t cache_blocks) const;
+  // smallest cache in which only the cold references miss
+  std::size_t max_distance() const;
+  double mean_distance() const;
+
+  std::size_t num_refs {};
+  std::size_t num_blocks {};
+  std::size_t cold_refs {};
+  std::size_t cold_blocks {};
+private:
+  static std::size_t bucket(std::size_t distance);
+  // largest distance of the bucket
+  static std::size_t bucket_end(std::size_t bucket);
+  double misses(std::size_t cache_blocks, const std::vector<std::size_t>& counts) const;
+
+  std::vector<std::size_t> bucket_refs;
+  std::vector<std::size_t> bucket_blocks;
+  double distance_sum {};
+};
+
+// Reuse of B in the order of the preprocessed B rows (preproc_B_row_ptr_end),
+// computed with a Fenwick tree over the references in O(n log n)
+struct B_Reuse_Profile {
+  // distinct B data used in an interval of the references
+  struct Working_Set {
+    std::size_t begin_ref {};
+    std::size_t end_ref {};
+    std::size_t num_rows {};
+    std::size_t num_blocks {};
+  };
+
+  static B_Reuse_Profile compute(const std::vector<std::pair<uint32_t, uint32_t>>& B_row_ptr_end,
+                                 std::size_t num_intervals);
+
+  // references to whole B rows, which take div_ceil(length, block_size)
+  // blocks as in the linked list cache
+  Stack_Distance_Histogram rows;
+  // references to the aligned blocks of the B rows, as in the fiber cache
+  Stack_Distance_Histogram blocks;
+  std::vector<Working_Set> working_sets;
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_REUSE_PROFILE_HPP
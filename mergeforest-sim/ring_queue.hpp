@@ -0,0 +1,124 @@
+#ifndef MERGEFOREST_SIM_RING_QUEUE_HPP
+#define MERGEFOREST_SIM_RING_QUEUE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+
+namespace mergeforest_sim {
+
+// FIFO stored in a ring buffer. The capacity is a power of two that doubles
+// when an element doesn't fit and is kept by clear, so a queue that reached
+// its maximum size never allocates again. std::deque instead allocates and
+// frees a node every few hundred bytes that go through it.
+template<typename T>
+class Ring_Queue {
+  template<typename Queue, typename Value>
+  class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator() = default;
+    Iterator(Queue* queue_, std::size_t idx_) : queue{queue_}, idx{idx_} {}
+
+    reference operator*() const { return (*queue)[idx]; }
+    pointer operator->() const { return &(*queue)[idx]; }
+    Iterator& operator++() {
+      ++idx;
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto it = *this;
+      ++idx;
+      return it;
+    }
+    bool operator==(const Iterator& other) const { return idx == other.idx; }
+
+  private:
+    Queue* queue {};
+    std::size_t idx {};
+  };
+
+public:
+  using value_type = T;
+  using iterator = Iterator<Ring_Queue, T>;
+  using const_iterator = Iterator<const Ring_Queue, const T>;
+
+  bool empty() const { return num_elements == 0; }
+  std::size_t size() const { return num_elements; }
+
+  void reserve(std::size_t capacity) {
+    if (capacity > buf.size()) { grow(capacity); }
+  }
+
+  void clear() {
+    head = 0;
+    num_elements = 0;
+  }
+
+  T& operator[](std::size_t pos) {
+    assert(pos < num_elements);
+    return buf[(head + pos) & mask];
+  }
+  const T& operator[](std::size_t pos) const {
+    assert(pos < num_elements);
+    return buf[(head + pos) & mask];
+  }
+
+  T& front() { return (*this)[0]; }
+  const T& front() const { return (*this)[0]; }
+  T& back() { return (*this)[num_elements - 1]; }
+  const T& back() const { return (*this)[num_elements - 1]; }
+
+  void push_back(T value) {
+    if (num_elements == buf.size()) { grow(num_elements + 1); }
+    buf[(head + num_elements) & mask] = std::move(value);
+    ++num_elements;
+  }
+
+  template<typename... Args>
+  T& emplace_back(Args&&... args) {
+    push_back(T(std::forward<Args>(args)...));
+    return back();
+  }
+
+  void pop_front() {
+    assert(!empty());
+    head = (head + 1) & mask;
+    --num_elements;
+  }
+
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, num_elements}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, num_elements}; }
+
+private:
+  void grow(std::size_t min_capacity) {
+    std::vector<T> new_buf(std::bit_ceil(std::max<std::size_t>(
+      {min_capacity, 2 * buf.size(), 8})));
+    for (std::size_t i = 0; i < num_elements; ++i) {
+      new_buf[i] = std::move(buf[(head + i) & mask]);
+    }
+    buf = std::move(new_buf);
+    mask = buf.size() - 1;
+    head = 0;
+  }
+
+  std::vector<T> buf;
+  std::size_t mask {};
+  std::size_t head {};
+  std::size_t num_elements {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_RING_QUEUE_HPP
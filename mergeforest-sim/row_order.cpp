@@ -0,0 +1,185 @@
+#include <mergeforest-sim/row_order.hpp>
+#include <mergeforest-sim/flat_map.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+namespace {
+
+uint32_t row_degree(const Spmat_Csr& A, uint32_t row) {
+  return A.row_ptr[row + 1] - A.row_ptr[row];
+}
+
+std::vector<uint32_t> natural_order(const Spmat_Csr& A) {
+  std::vector<uint32_t> order(A.num_rows);
+  std::iota(order.begin(), order.end(), uint32_t{0});
+  return order;
+}
+
+// breadth first search of the bipartite graph, each column is expanded once
+// so that the columns shared by many rows don't make it quadratic
+std::vector<uint32_t> rcm_order(const Spmat_Csr& A) {
+  const auto A_t = A.transpose();
+  auto rows_by_degree = natural_order(A);
+  std::ranges::stable_sort(rows_by_degree, {}, [&](uint32_t row) { return row_degree(A, row); });
+  std::vector<bool> row_visited(A.num_rows);
+  std::vector<bool> col_visited(A.num_cols);
+  std::vector<uint32_t> order;
+  order.reserve(A.num_rows);
+  std::vector<uint32_t> neighbors;
+  for (const auto start : rows_by_degree) {
+    if (row_visited[start]) continue;
+    row_visited[start] = true;
+    order.push_back(start);
+    for (auto head = order.size() - 1; head < order.size(); ++head) {
+      const auto row = order[head];
+      neighbors.clear();
+      for (auto j = A.row_ptr[row]; j < A.row_ptr[row + 1]; ++j) {
+        const auto col = A.col_idx[j];
+        if (col_visited[col]) continue;
+        col_visited[col] = true;
+        for (auto k = A_t.row_ptr[col]; k < A_t.row_ptr[col + 1]; ++k) {
+          const auto neighbor = A_t.col_idx[k];
+          if (row_visited[neighbor]) continue;
+          row_visited[neighbor] = true;
+          neighbors.push_back(neighbor);
+        }
+      }
+      std::ranges::stable_sort(neighbors, {}, [&](uint32_t r) { return row_degree(A, r); });
+      order.insert(order.end(), neighbors.begin(), neighbors.end());
+    }
+  }
+  std::ranges::reverse(order);
+  return order;
+}
+
+std::vector<uint32_t> gray_order(const Spmat_Csr& A) {
+  std::vector<uint64_t> ranks(A.num_rows);
+  for (uint32_t i = 0; i < A.num_rows; ++i) {
+    // the first column range is the most significant bit
+    uint64_t mask = 0;
+    for (auto j = A.row_ptr[i]; j < A.row_ptr[i + 1]; ++j) {
+      const auto range = uint64_t{A.col_idx[j]} * 64 / A.num_cols;
+      mask |= uint64_t{1} << (63 - range);
+    }
+    // position of the mask in the Gray code sequence
+    for (unsigned shift = 1; shift < 64; shift *= 2) { mask ^= mask >> shift; }
+    ranks[i] = mask;
+  }
+  auto order = natural_order(A);
+  std::ranges::stable_sort(order, {}, [&](uint32_t row) { return ranks[row]; });
+  return order;
+}
+
+std::vector<uint32_t> jaccard_order(const Spmat_Csr& A) {
+  // rows of each column scanned for candidates at each step, it bounds the
+  // cost of the columns shared by many rows
+  constexpr uint32_t max_scanned_rows = 256;
+  const auto A_t = A.transpose();
+  std::vector<bool> visited(A.num_rows);
+  // first row of each column that may be unvisited
+  std::vector<uint32_t> col_begin(A_t.row_ptr.data(), A_t.row_ptr.data() + A_t.num_rows);
+  std::vector<uint32_t> num_shared_cols(A.num_rows);
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> order;
+  order.reserve(A.num_rows);
+  uint32_t next_unvisited = 0;
+  uint32_t row = UINT32_MAX;
+  while (order.size() < A.num_rows) {
+    if (row == UINT32_MAX) {
+      while (visited[next_unvisited]) { ++next_unvisited; }
+      row = next_unvisited;
+    }
+    visited[row] = true;
+    order.push_back(row);
+    candidates.clear();
+    for (auto j = A.row_ptr[row]; j < A.row_ptr[row + 1]; ++j) {
+      const auto col = A.col_idx[j];
+      const auto col_end = A_t.row_ptr[col + 1];
+      while (col_begin[col] < col_end && visited[A_t.col_idx[col_begin[col]]]) { ++col_begin[col]; }
+      const auto scan_end = std::min(col_end, col_begin[col] + max_scanned_rows);
+      for (auto k = col_begin[col]; k < scan_end; ++k) {
+        const auto candidate = A_t.col_idx[k];
+        if (visited[candidate]) continue;
+        if (num_shared_cols[candidate]++ == 0) { candidates.push_back(candidate); }
+      }
+    }
+    row = UINT32_MAX;
+    double max_similarity = 0.0;
+    for (const auto candidate : candidates) {
+      const auto shared = num_shared_cols[candidate];
+      const auto similarity = static_cast<double>(shared)
+        / static_cast<double>(row_degree(A, order.back()) + row_degree(A, candidate) - shared);
+      if (similarity > max_similarity) {
+        max_similarity = similarity;
+        row = candidate;
+      }
+      num_shared_cols[candidate] = 0;
+    }
+  }
+  return order;
+}
+
+} // namespace
+
+Row_Order parse_row_order(const std::string& name) {
+  if (name == "natural") return Row_Order::natural;
+  if (name == "rcm") return Row_Order::rcm;
+  if (name == "gray") return Row_Order::gray;
+  if (name == "jaccard") return Row_Order::jaccard;
+  throw std::runtime_error("Unknown row order " + name);
+}
+
+std::string_view row_order_name(Row_Order order) {
+  switch (order) {
+  case Row_Order::natural: return "natural";
+  case Row_Order::rcm: return "rcm";
+  case Row_Order::gray: return "gray";
+  case Row_Order::jaccard: return "jaccard";
+  }
+  return "";
+}
+
+std::vector<uint32_t> order_rows(const Spmat_Csr& A, Row_Order order) {
+  switch (order) {
+  case Row_Order::rcm: return rcm_order(A);
+  case Row_Order::gray: return gray_order(A);
+  case Row_Order::jaccard: return jaccard_order(A);
+  default: return natural_order(A);
+  }
+}
+
+Reuse_Distance Reuse_Distance::compute(const std::vector<std::pair<uint32_t, uint32_t>>& B_row_ptr_end) {
+  Reuse_Distance distance;
+  distance.num_uses = B_row_ptr_end.size();
+  // B elements used until the end of the last use of each B row
+  Flat_Map<uint32_t, std::size_t, UINT32_MAX> last_uses;
+  std::vector<std::size_t> distances;
+  std::size_t num_elements = 0;
+  for (const auto& [B_row_ptr, B_row_end] : B_row_ptr_end) {
+    const auto use_end = num_elements + (B_row_end - B_row_ptr);
+    if (auto* last_use = last_uses.find(B_row_ptr)) {
+      distances.push_back(num_elements - *last_use);
+      *last_use = use_end;
+    } else {
+      last_uses.insert(B_row_ptr, use_end);
+    }
+    num_elements = use_end;
+  }
+  distance.num_reuses = distances.size();
+  if (distances.empty()) { return distance; }
+  distance.mean = static_cast<double>(std::accumulate(distances.begin(), distances.end(),
+                                                      std::size_t{0}))
+    / static_cast<double>(distances.size());
+  const auto middle = distances.begin() + static_cast<std::ptrdiff_t>(distances.size() / 2);
+  std::ranges::nth_element(distances, middle);
+  distance.median = *middle;
+  return distance;
+}
+
+} // namespace mergeforest_sim
@@ -0,0 +1,46 @@
+#ifndef MERGEFOREST_SIM_ROW_ORDER_HPP
+#define MERGEFOREST_SIM_ROW_ORDER_HPP
+
+#include <mergeforest-sim/sparse_matrix.hpp>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+// Order in which the rows of A are processed. The orders other than natural
+// put close together the rows that use the same rows of B, so that the
+// caches find them before they are evicted:
+// - natural: increasing row order
+// - rcm: reverse Cuthill-McKee order of the bipartite graph of the rows and
+//   columns of A
+// - gray: rows sorted by the Gray code rank of the bitmask of the 64 column
+//   ranges that they use
+// - jaccard: greedy chain in which each row is followed by the unvisited row
+//   with the most similar columns (Jaccard index) among the rows that share
+//   a column with it
+enum class Row_Order { natural, rcm, gray, jaccard };
+
+Row_Order parse_row_order(const std::string& name);
+std::string_view row_order_name(Row_Order order);
+// rows of A in the given order
+std::vector<uint32_t> order_rows(const Spmat_Csr& A, Row_Order order);
+
+// Distances between consecutive uses of the same B row in a sequence of B
+// rows, in number of B elements used in between
+struct Reuse_Distance {
+  static Reuse_Distance compute(const std::vector<std::pair<uint32_t, uint32_t>>& B_row_ptr_end);
+
+  std::size_t num_uses {};
+  std::size_t num_reuses {};
+  std::size_t median {};
+  double mean {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_ROW_ORDER_HPP
@@ -0,0 +1,488 @@
+#include <mergeforest-sim/sampled_simulation.hpp>
+#include <mergeforest-sim/gamma.hpp>
+#include <mergeforest-sim/host_metrics.hpp>
+#include <mergeforest-sim/math_utils.hpp>
+#include <mergeforest-sim/mergeforest.hpp>
+#include <mergeforest-sim/parallel.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <climits>
+
+namespace mergeforest_sim {
+
+namespace {
+
+using Features = std::array<double, 3>;
+
+double squared_distance(const Features& a, const Features& b) {
+  double sum = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) { sum += (a[i] - b[i]) * (a[i] - b[i]); }
+  return sum;
+}
+
+std::size_t nearest_center(const Features& point, const std::vector<Features>& centers) {
+  std::size_t nearest = 0;
+  for (std::size_t i = 1; i < centers.size(); ++i) {
+    if (squared_distance(point, centers[i]) < squared_distance(point, centers[nearest])) {
+      nearest = i;
+    }
+  }
+  return nearest;
+}
+
+// k-means++ initialization followed by Lloyd iterations, returns the
+// cluster of each point. Fewer than k clusters are used if there are fewer
+// distinct points
+std::vector<unsigned> k_means(const std::vector<Features>& points, std::size_t k,
+                              std::mt19937_64& rng)
+{
+  std::vector<Features> centers;
+  centers.push_back(points[std::uniform_int_distribution<std::size_t>(0, points.size() - 1)(rng)]);
+  std::vector<double> distances(points.size());
+  while (centers.size() < k) {
+    double sum = 0.0;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      distances[i] = squared_distance(points[i], centers[nearest_center(points[i], centers)]);
+      sum += distances[i];
+    }
+    if (sum == 0.0) { break; }
+    auto target = std::uniform_real_distribution<double>(0.0, sum)(rng);
+    std::size_t next = 0;
+    while (next + 1 < points.size() && target >= distances[next]) {
+      target -= distances[next];
+      ++next;
+    }
+    centers.push_back(points[next]);
+  }
+  std::vector<unsigned> assignment(points.size(), UINT_MAX);
+  constexpr unsigned max_iterations = 100;
+  for (unsigned iteration = 0; iteration < max_iterations; ++iteration) {
+    bool changed = false;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      const auto cluster = static_cast<unsigned>(nearest_center(points[i], centers));
+      changed |= cluster != assignment[i];
+      assignment[i] = cluster;
+    }
+    if (!changed) { break; }
+    std::vector<Features> sums(centers.size(), Features{});
+    std::vector<std::size_t> counts(centers.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      for (std::size_t j = 0; j < points[i].size(); ++j) {
+        sums[assignment[i]][j] += points[i][j];
+      }
+      ++counts[assignment[i]];
+    }
+    for (std::size_t c = 0; c < centers.size(); ++c) {
+      if (counts[c] == 0) { continue; }
+      for (std::size_t j = 0; j < centers[c].size(); ++j) {
+        centers[c][j] = sums[c][j] / static_cast<double>(counts[c]);
+      }
+    }
+  }
+  // number the non empty clusters consecutively
+  std::vector<unsigned> ids(centers.size(), UINT_MAX);
+  unsigned num_ids = 0;
+  for (auto& cluster : assignment) {
+    if (ids[cluster] == UINT_MAX) { ids[cluster] = num_ids++; }
+    cluster = ids[cluster];
+  }
+  return assignment;
+}
+
+// Stratified estimate of the total of a quantity of the sampling units and
+// the half width of its 95% confidence interval, from the samples and the
+// number of units of each stratum. The variance of a stratum with a single
+// sample is estimated from the variance relative to the square of scale of
+// the strata with more samples.
+std::pair<double, double> stratified_total(const std::vector<std::vector<double>>& samples,
+                                           const std::vector<std::size_t>& num_units,
+                                           const std::vector<double>& scales)
+{
+  std::vector<double> variances(samples.size(), std::numeric_limits<double>::quiet_NaN());
+  double total = 0.0;
+  double relative_variance_sum = 0.0;
+  std::size_t num_relative_variances = 0;
+  for (std::size_t h = 0; h < samples.size(); ++h) {
+    const auto n = static_cast<double>(samples[h].size());
+    const auto mean = std::accumulate(samples[h].begin(), samples[h].end(), 0.0) / n;
+    total += static_cast<double>(num_units[h]) * mean;
+    if (samples[h].size() < 2) { continue; }
+    double sum = 0.0;
+    for (const auto x : samples[h]) { sum += (x - mean) * (x - mean); }
+    variances[h] = sum / (n - 1.0);
+    if (scales[h] > 0.0) {
+      relative_variance_sum += variances[h] / (scales[h] * scales[h]);
+      ++num_relative_variances;
+    }
+  }
+  double variance = 0.0;
+  for (std::size_t h = 0; h < samples.size(); ++h) {
+    const auto n = static_cast<double>(samples[h].size());
+    const auto N = static_cast<double>(num_units[h]);
+    const auto finite_population_correction = 1.0 - n / N;
+    if (finite_population_correction <= 0.0) { continue; }
+    auto stratum_variance = variances[h];
+    if (std::isnan(stratum_variance) && num_relative_variances > 0) {
+      stratum_variance = relative_variance_sum / static_cast<double>(num_relative_variances)
+        * scales[h] * scales[h];
+    }
+    variance += N * N * finite_population_correction * stratum_variance / n;
+  }
+  return {total, 1.96 * std::sqrt(variance)};
+}
+
+// half width of a confidence interval and its ratio to the estimate
+std::string confidence_interval(double value, double half_width, int precision) {
+  if (std::isnan(half_width)) { return "n/a"; }
+  return fmt::format("±{:.{}f} ({:.4f}%)", half_width, precision,
+                     value > 0.0 ? half_width / value * 100.0 : 0.0);
+}
+
+// B rows used by the first num_elements elements of A, in order and without
+// the empty rows, as in the preprocessed arrays
+std::vector<std::pair<uint32_t, uint32_t>> B_rows_used(const Spmat_Csr& A, const Spmat_Csr& B,
+                                                       std::size_t num_elements = SIZE_MAX)
+{
+  num_elements = std::min(num_elements, A.nnz);
+  std::vector<std::pair<uint32_t, uint32_t>> B_rows;
+  B_rows.reserve(num_elements);
+  for (std::size_t j = 0; j < num_elements; ++j) {
+    const auto B_row_ptr = B.row_ptr[A.col_idx[j]];
+    const auto B_row_end = B.row_ptr[A.col_idx[j] + 1];
+    if (B_row_ptr != B_row_end) { B_rows.emplace_back(B_row_ptr, B_row_end); }
+  }
+  return B_rows;
+}
+
+} // namespace
+
+Sampled_Simulation::Sampled_Simulation(const toml::value& parsed_config_,
+                                       Matrix_Data& matrix_data_,
+                                       const std::string& out_path_)
+  : parsed_config{parsed_config_}
+  , matrix_data{matrix_data_}
+  , out_path{out_path_}
+  , window_config{parsed_config_}
+{
+  get_config_params(parsed_config);
+  window_config.as_table().erase("sampling");
+  window_config.as_table().erase("time_series");
+}
+
+void Sampled_Simulation::get_config_params(const toml::value& parsed_config_) {
+  arch = toml::find<std::string>(parsed_config_, "arch");
+  if (arch != "mergeforest" && arch != "gamma") {
+    throw std::runtime_error("Error: architecture \"" + arch + "\" not implemented");
+  }
+  // the windows are measured by the multiplications done in the order of the
+  // rows, which several cores don't follow
+  if (arch == "mergeforest" && toml::find_or(parsed_config_, "num_cores", 1U) > 1) {
+    throw std::runtime_error("Sampled simulations need num_cores = 1");
+  }
+  num_windows = toml::find_or(parsed_config_, "sampling", "windows", 0U);
+  window_rows = toml::find_or(parsed_config_, "sampling", "window_rows", 1024U);
+  warmup_rows = toml::find_or(parsed_config_, "sampling", "warmup_rows", window_rows);
+  cooldown_rows = toml::find_or(parsed_config_, "sampling", "cooldown_rows", window_rows);
+  functional_warming = toml::find_or(parsed_config_, "sampling", "functional_warming", true);
+  num_clusters = toml::find_or(parsed_config_, "sampling", "clusters", 8U);
+  num_workers = toml::find_or(parsed_config_, "sampling", "threads", 0U);
+  seed = toml::find_or(parsed_config_, "sampling", "seed", uint64_t{1});
+  if (num_windows == 0 || window_rows == 0 || num_clusters == 0) {
+    throw std::runtime_error("sampling.windows, sampling.window_rows and "
+                             "sampling.clusters must be greater than 0");
+  }
+}
+
+Spmat_Csr Sampled_Simulation::run_simulation(bool compute_result) {
+  auto& host_metrics = matrix_data.host_metrics;
+  if (compute_result) {
+    spdlog::warn("the result matrix isn't computed by sampled simulations");
+  }
+  auto start = Host_Clock::now();
+  A = matrix_data.A;
+  if (matrix_data.row_order != Row_Order::natural) {
+    ordered_A = matrix_data.A->row_permutation(order_rows(*matrix_data.A, matrix_data.row_order));
+    A = &ordered_A;
+    matrix_data.natural_reuse_distance = Reuse_Distance::compute(B_rows_used(*matrix_data.A,
+                                                                             *matrix_data.B));
+    matrix_data.reuse_distance = Reuse_Distance::compute(B_rows_used(*A, *matrix_data.B));
+  }
+  make_units();
+  cluster_units();
+  pick_windows();
+  host_metrics.preprocess_time = elapsed_seconds(start);
+  if (matrix_data.verbose) {
+    fmt::print("Simulating {} of {} windows of {} rows in {} clusters...\n",
+               windows.size(), units.size(), window_rows, clusters.size());
+  }
+  start = Host_Clock::now();
+  std::mutex print_mutex;
+  std::size_t num_finished {};
+  parallel_jobs(windows.size(), [&](std::size_t job) {
+    simulate_window(windows[job]);
+    if (!matrix_data.verbose) { return; }
+    std::lock_guard lock(print_mutex);
+    ++num_finished;
+    fmt::print("sampling: {}/{} windows\r", num_finished, windows.size());
+    fflush(stdout);
+  }, num_workers == 0 ? num_threads() : num_workers);
+  if (matrix_data.verbose) { fmt::print("\n"); }
+  host_metrics.simulate_time = elapsed_seconds(start);
+  estimate();
+  if (matrix_data.print_results) { print_stats(); }
+  return Spmat_Csr{};
+}
+
+void Sampled_Simulation::make_units() {
+  const auto& B = *matrix_data.B;
+  if (A->num_cols != B.num_rows) {
+    throw std::runtime_error("matrices A and B don't have compatible dimensions");
+  }
+  row_mults.assign(std::size_t{A->num_rows} + 1, 0);
+  units.clear();
+  // elements of A since the last use of each B row, as in the preprocessed
+  // arrays the elements with an empty B row are skipped
+  std::vector<std::size_t> last_use(B.num_rows, SIZE_MAX);
+  const auto cold_distance = std::log2(static_cast<double>(A->nnz) + 1.0);
+  std::size_t element = 0;
+  for (std::size_t begin = 0; begin < A->num_rows; begin += window_rows) {
+    const auto end = std::min<std::size_t>(begin + window_rows, A->num_rows);
+    Unit unit {.begin_row = static_cast<uint32_t>(begin), .end_row = static_cast<uint32_t>(end)};
+    double distance_sum = 0.0;
+    for (std::size_t i = begin; i < end; ++i) {
+      row_mults[i + 1] = row_mults[i];
+      for (std::size_t j = A->row_ptr[i]; j < A->row_ptr[i + 1]; ++j) {
+        const auto col = A->col_idx[j];
+        const std::size_t B_row_size = B.row_ptr[col + 1] - B.row_ptr[col];
+        if (B_row_size == 0) { continue; }
+        row_mults[i + 1] += B_row_size;
+        distance_sum += last_use[col] == SIZE_MAX
+          ? cold_distance : std::log2(static_cast<double>(element - last_use[col]));
+        last_use[col] = element;
+        ++element;
+        ++unit.num_elements;
+      }
+    }
+    unit.num_mults = row_mults[end] - row_mults[begin];
+    unit.reuse_distance = unit.num_elements > 0
+      ? distance_sum / static_cast<double>(unit.num_elements) : cold_distance;
+    units.push_back(unit);
+  }
+  matrix_data.num_mults = row_mults.back();
+}
+
+void Sampled_Simulation::cluster_units() {
+  clusters.clear();
+  if (units.empty()) { return; }
+  // standardized log of the sizes and reuse distance of each unit
+  std::vector<Features> features(units.size());
+  for (std::size_t i = 0; i < units.size(); ++i) {
+    features[i] = {std::log1p(static_cast<double>(units[i].num_elements)),
+                   std::log1p(static_cast<double>(units[i].num_mults)),
+                   units[i].reuse_distance};
+  }
+  for (std::size_t j = 0; j < Features{}.size(); ++j) {
+    double mean = 0.0;
+    for (const auto& f : features) { mean += f[j]; }
+    mean /= static_cast<double>(features.size());
+    double variance = 0.0;
+    for (const auto& f : features) { variance += (f[j] - mean) * (f[j] - mean); }
+    const auto deviation = std::sqrt(variance / static_cast<double>(features.size()));
+    for (auto& f : features) { f[j] = deviation > 0.0 ? (f[j] - mean) / deviation : 0.0; }
+  }
+  std::mt19937_64 rng(seed);
+  const auto k = std::min<std::size_t>({num_clusters, num_windows, units.size()});
+  const auto assignment = k_means(features, k, rng);
+  for (std::size_t i = 0; i < units.size(); ++i) {
+    units[i].cluster = assignment[i];
+    if (assignment[i] >= clusters.size()) { clusters.resize(assignment[i] + 1); }
+    ++clusters[assignment[i]].num_units;
+  }
+}
+
+void Sampled_Simulation::pick_windows() {
+  windows.clear();
+  // one window per cluster, the rest go one at a time to the cluster with
+  // the most units per window
+  std::vector<std::size_t> cluster_windows(clusters.size(), 1);
+  auto remaining = std::min<std::size_t>(num_windows, units.size()) - clusters.size();
+  for (; remaining > 0; --remaining) {
+    std::size_t best = SIZE_MAX;
+    for (std::size_t c = 0; c < clusters.size(); ++c) {
+      if (cluster_windows[c] == clusters[c].num_units) { continue; }
+      if (best == SIZE_MAX || clusters[c].num_units * cluster_windows[best]
+                              > clusters[best].num_units * cluster_windows[c]) {
+        best = c;
+      }
+    }
+    ++cluster_windows[best];
+  }
+  // uniform random sample of the units of each cluster
+  std::mt19937_64 rng(seed + 1);
+  for (std::size_t c = 0; c < clusters.size(); ++c) {
+    std::vector<std::size_t> cluster_units;
+    for (std::size_t i = 0; i < units.size(); ++i) {
+      if (units[i].cluster == c) { cluster_units.push_back(i); }
+    }
+    std::shuffle(cluster_units.begin(), cluster_units.end(), rng);
+    cluster_units.resize(cluster_windows[c]);
+    std::ranges::sort(cluster_units);
+    for (const auto unit : cluster_units) {
+      clusters[c].windows.push_back(windows.size());
+      windows.push_back(Window{.unit = unit});
+    }
+  }
+}
+
+void Sampled_Simulation::simulate_window(Window& window) const {
+  const auto& unit = units[window.unit];
+  if (unit.num_mults == 0) { return; }
+  const auto warmup_begin = unit.begin_row - std::min(unit.begin_row, warmup_rows);
+  const auto cooldown_end = unit.end_row + std::min(A->num_rows - unit.end_row, cooldown_rows);
+  const auto A_window = A->row_slice(warmup_begin, cooldown_end);
+  Matrix_Data window_data;
+  window_data.A = &A_window;
+  window_data.B = matrix_data.B;
+  window_data.verbose = false;
+  window_data.print_results = false;
+  if (functional_warming) {
+    window_data.warmup_B_row_ptr_end = B_rows_used(*A, *matrix_data.B, A->row_ptr[warmup_begin]);
+  }
+  window_data.measured.measure(row_mults[unit.begin_row] - row_mults[warmup_begin],
+                               row_mults[unit.end_row] - row_mults[warmup_begin]);
+  const std::string no_out_path;
+  if (arch == "mergeforest") {
+    MergeForest sim(window_config, window_data, no_out_path);
+    sim.run_simulation(false);
+  } else {
+    Gamma sim(window_config, window_data, no_out_path);
+    sim.run_simulation(false);
+  }
+  const auto& measured = window_data.measured;
+  if (!measured.finished()) {
+    throw std::runtime_error("the multiplications of a sampling window weren't simulated");
+  }
+  window.cycles = measured.end.cycles - measured.begin.cycles;
+  window.mem_reads = measured.end.mem_reads - measured.begin.mem_reads;
+  window.mem_writes = measured.end.mem_writes - measured.begin.mem_writes;
+}
+
+void Sampled_Simulation::estimate() {
+  std::vector<std::vector<double>> cycles_samples(clusters.size());
+  std::vector<std::vector<double>> reads_samples(clusters.size());
+  std::vector<std::vector<double>> writes_samples(clusters.size());
+  std::vector<std::size_t> num_units(clusters.size());
+  std::vector<double> scales(clusters.size());
+  for (std::size_t c = 0; c < clusters.size(); ++c) {
+    num_units[c] = clusters[c].num_units;
+    for (const auto w : clusters[c].windows) {
+      cycles_samples[c].push_back(static_cast<double>(windows[w].cycles));
+      reads_samples[c].push_back(static_cast<double>(windows[w].mem_reads));
+      writes_samples[c].push_back(static_cast<double>(windows[w].mem_writes));
+    }
+    scales[c] = std::accumulate(cycles_samples[c].begin(), cycles_samples[c].end(), 0.0)
+      / static_cast<double>(cycles_samples[c].size());
+  }
+  std::tie(cycles.value, cycles.half_width) =
+    stratified_total(cycles_samples, num_units, scales);
+  std::tie(mem_reads.value, mem_reads.half_width) =
+    stratified_total(reads_samples, num_units, scales);
+  std::tie(mem_writes.value, mem_writes.half_width) =
+    stratified_total(writes_samples, num_units, scales);
+  // ratio estimate of the transactions per cycle, its variance is the one
+  // of the total of the residuals of the transactions of the windows
+  const auto throughput = cycles.value > 0.0
+    ? (mem_reads.value + mem_writes.value) / cycles.value : 0.0;
+  std::vector<std::vector<double>> residual_samples(clusters.size());
+  for (std::size_t c = 0; c < clusters.size(); ++c) {
+    for (std::size_t i = 0; i < cycles_samples[c].size(); ++i) {
+      residual_samples[c].push_back(reads_samples[c][i] + writes_samples[c][i]
+                                    - throughput * cycles_samples[c][i]);
+    }
+  }
+  const auto residual_half_width = stratified_total(residual_samples, num_units, scales).second;
+  mem_throughput.value = throughput;
+  mem_throughput.half_width = cycles.value > 0.0 ? residual_half_width / cycles.value : 0.0;
+}
+
+void Sampled_Simulation::print_stats() {
+  if (out_path.empty()) {
+    print_stats(std::cout);
+  } else {
+    std::ofstream of;
+    of.open(out_path.data());
+    print_stats(of);
+  }
+}
+
+void Sampled_Simulation::print_stats(std::ostream& os) {
+  const double period_ns = toml::find_or(parsed_config, "clock_period_ns", 1.0);
+  const auto exec_time_ns = cycles.value * period_ns;
+  const auto exec_time_ms = exec_time_ns * 1e-6;
+  const auto Gflops = exec_time_ns > 0.0
+    ? static_cast<double>(matrix_data.num_mults) / exec_time_ns : 0.0;
+  const auto bandwidth = mem_throughput.value * mem_transaction_size / period_ns;
+  const auto bandwidth_half_width = mem_throughput.half_width * mem_transaction_size / period_ns;
+  const auto num_rows = A ? A->num_rows : 0;
+  std::size_t window_rows_simulated {};
+  for (const auto& window : windows) {
+    window_rows_simulated += units[window.unit].end_row - units[window.unit].begin_row;
+  }
+  const auto rows_ratio = ratio(window_rows_simulated, num_rows) * 100.0;
+  const auto reads = static_cast<std::size_t>(std::llround(mem_reads.value));
+  const auto writes = static_cast<std::size_t>(std::llround(mem_writes.value));
+  const auto num_cycles = static_cast<std::size_t>(std::llround(cycles.value));
+
+  fmt::print(os, "*---Sampled Simulation Results---*\n");
+  fmt::print(os, "Config file: {}\n", parsed_config.location().file_name());
+  fmt::print(os, "Sampling units: {} ({} rows each)\n", units.size(), window_rows);
+  fmt::print(os, "Sampling clusters: {}\n", clusters.size());
+  fmt::print(os, "Simulated windows: {} ({:.4f}% of the rows)\n", windows.size(), rows_ratio);
+  fmt::print(os, "Warm-up rows per window: {}\n", warmup_rows);
+  fmt::print(os, "Num cycles: {}\n", num_cycles);
+  fmt::print(os, "Num cycles 95% CI: {}\n",
+             confidence_interval(cycles.value, cycles.half_width, 0));
+  fmt::print(os, "Clock period: {} ns\n", period_ns);
+  fmt::print(os, "Execution time: {:.4f} ms\n", exec_time_ms);
+  fmt::print(os, "GFlops: {:.4f}\n", Gflops);
+  fmt::print(os, "Number flops (mults): {}\n", matrix_data.num_mults);
+  fmt::print(os, "Memory bandwidth: {:.4f} GB/s\n", bandwidth);
+  fmt::print(os, "Memory bandwidth 95% CI: {}\n",
+             confidence_interval(bandwidth, bandwidth_half_width, 4));
+  fmt::print(os, "Memory traffic: {} transactions ({:.4f} MB)\n",
+             reads + writes, reqs_to_MB(reads + writes));
+  fmt::print(os, "Memory reads: {} ({:.4f} MB)\n", reads, reqs_to_MB(reads));
+  fmt::print(os, "Memory reads 95% CI: {}\n",
+             confidence_interval(mem_reads.value, mem_reads.half_width, 0));
+  fmt::print(os, "Memory writes: {} ({:.4f} MB)\n", writes, reqs_to_MB(writes));
+  fmt::print(os, "Memory writes 95% CI: {}\n",
+             confidence_interval(mem_writes.value, mem_writes.half_width, 0));
+  fmt::print(os, "*---Sampling Clusters---*\n");
+  for (std::size_t c = 0; c < clusters.size(); ++c) {
+    std::size_t cluster_cycles {};
+    for (const auto w : clusters[c].windows) { cluster_cycles += windows[w].cycles; }
+    fmt::print(os, "Cluster {}: {} units, {} windows, {:.1f} cycles per window\n", c,
+               clusters[c].num_units, clusters[c].windows.size(),
+               ratio(cluster_cycles, clusters[c].windows.size()));
+  }
+  matrix_data.print_row_order(os);
+  matrix_data.host_metrics.print(os, num_cycles);
+}
+
+} // namespace mergeforest_sim
@@ -0,0 +1,114 @@
+#ifndef MERGEFOREST_SIM_SAMPLED_SIMULATION_HPP
+#define MERGEFOREST_SIM_SAMPLED_SIMULATION_HPP
+
+#include <mergeforest-sim/matrix_data.hpp>
+#include <mergeforest-sim/sparse_matrix.hpp>
+
+#include <toml.hpp>
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+// Estimates the cycles and memory traffic of the architecture of the config
+// by simulating only some windows of rows of A, enabled with [sampling]
+// windows > 0. The rows of A, in the order in which the architectures
+// process them, are split in sampling units of window_rows consecutive rows.
+// The units are clustered with k-means by their number of elements, their
+// number of multiplications (the total length of the B rows they use) and the
+// mean reuse distance of those B rows. The windows are spread over the
+// clusters in proportion to their size and picked at random within each
+// cluster. Each window is simulated in detail together with the warmup_rows
+// rows before it, which fill the caches, and the cooldown_rows rows after it,
+// which overlap with its last rows as in the full run, but only the cycles
+// between the first and last multiplication of the window are measured. The
+// caches can also be filled beforehand with the B rows of all the previous
+// rows of A (functional_warming). With a row order other than natural, the
+// units are taken from A with its rows reordered. The totals are
+// extrapolated with the stratified mean of the windows of each cluster,
+// together with their 95% confidence intervals.
+class Sampled_Simulation {
+public:
+  Sampled_Simulation(const toml::value& parsed_config, Matrix_Data& matrix_data_,
+                     const std::string& out_path_);
+  // the result matrix isn't computed, compute_result is ignored
+  Spmat_Csr run_simulation(bool compute_result);
+  void print_stats(std::ostream& os);
+private:
+  struct Unit {
+    uint32_t begin_row {};
+    uint32_t end_row {};
+    std::size_t num_elements {};
+    std::size_t num_mults {};
+    // mean log2 of the number of elements of A since the last use of the B
+    // row of each element
+    double reuse_distance {};
+    unsigned cluster {};
+  };
+
+  struct Window {
+    std::size_t unit {};
+    std::size_t cycles {};
+    std::size_t mem_reads {};
+    std::size_t mem_writes {};
+  };
+
+  struct Cluster {
+    std::size_t num_units {};
+    std::vector<std::size_t> windows;
+  };
+
+  // estimated value and half width of its 95% confidence interval, NaN if
+  // the variance can't be estimated
+  struct Estimate {
+    double value {};
+    double half_width {};
+  };
+
+  void get_config_params(const toml::value& parsed_config);
+  void make_units();
+  void cluster_units();
+  void pick_windows();
+  void simulate_window(Window& window) const;
+  void estimate();
+  void print_stats();
+
+  const toml::value& parsed_config;
+  Matrix_Data& matrix_data;
+  const std::string& out_path;
+  // A with its rows in the row order of the config, the windows are sliced
+  // from it
+  const Spmat_Csr* A {nullptr};
+  Spmat_Csr ordered_A;
+  // config of the window simulations, without the sampling and time series
+  toml::value window_config;
+
+  std::vector<Unit> units;
+  std::vector<Cluster> clusters;
+  std::vector<Window> windows;
+  // multiplications of the rows of A before each row
+  std::vector<std::size_t> row_mults;
+  Estimate cycles;
+  Estimate mem_reads;
+  Estimate mem_writes;
+  // memory transactions per cycle
+  Estimate mem_throughput;
+  // config parameters
+  std::string arch;
+  unsigned num_windows {};
+  unsigned window_rows {};
+  unsigned warmup_rows {};
+  unsigned cooldown_rows {};
+  bool functional_warming {};
+  unsigned num_clusters {};
+  unsigned num_workers {};
+  uint64_t seed {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_SAMPLED_SIMULATION_HPP
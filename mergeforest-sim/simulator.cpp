@@ -27,7 +27,12 @@ Simulator::Simulator(const std::string& config_file,
   , out_path{out_path_}
 {
   const auto arch_str = toml::find<std::string>(parsed_config, "arch");
-  if (arch_str == "mergeforest") {
+  matrix_data.row_order = parse_row_order(toml::find_or<std::string>(parsed_config, "row_order",
+                                                                     "natural"));
+  if (toml::find_or(parsed_config, "sampling", "windows", 0U) > 0) {
+    arch.emplace<Sampled_Simulation>(parsed_config, matrix_data, out_path);
+  }
+  else if (arch_str == "mergeforest") {
     arch.emplace<MergeForest>(parsed_config, matrix_data, out_path);
   }
   else if (arch_str == "gamma") {
@@ -44,8 +49,30 @@ void Simulator::set_mats(const Spmat_Csr& A, const Spmat_Csr& B) {
   matrix_data.B = &B;
 }
 
+void Simulator::set_verbose(bool verbose) {
+  matrix_data.verbose = verbose;
+}
+
+void Simulator::set_preproc_cache_dir(const std::string& cache_dir) {
+  matrix_data.preproc_cache_dir = cache_dir;
+}
+
+void Simulator::set_load_time(double seconds) {
+  matrix_data.host_metrics.load_time = seconds;
+}
+
+void Simulator::set_concurrent_runs(std::size_t num_runs) {
+  matrix_data.host_metrics.concurrent_runs = num_runs;
+}
+
 Spmat_Csr Simulator::run_simulation(bool compute_result) {
   return std::visit(Arch_Visitor{compute_result}, arch);
 }
 
+void Simulator::print_stats(std::ostream& os) {
+  std::visit([&os](auto& a) {
+    if constexpr (Arch<decltype(a)>) { a.print_stats(os); }
+  }, arch);
+}
+
 } // namespace mergeforest_sim
@@ -5,10 +5,12 @@
 #include <mergeforest-sim/sparse_matrix.hpp>
 #include <mergeforest-sim/mergeforest.hpp>
 #include <mergeforest-sim/gamma.hpp>
+#include <mergeforest-sim/sampled_simulation.hpp>
 
 #include <toml.hpp>
 
 #include <string>
+#include <ostream>
 #include <memory>
 #include <variant>
 
@@ -18,13 +20,22 @@ class Simulator {
 public:
   Simulator(const std::string& config_file, const std::string& out_path_ = {});
   void set_mats(const Spmat_Csr& A, const Spmat_Csr& B);  
+  // disables the progress messages, e.g. when several simulations run in parallel
+  void set_verbose(bool verbose);
+  // reads and writes the preprocessed data of the matrices in cache_dir
+  void set_preproc_cache_dir(const std::string& cache_dir);
+  // wall time spent loading the matrices, reported with the host metrics
+  void set_load_time(double seconds);
+  // number of simulations running at the same time in the process
+  void set_concurrent_runs(std::size_t num_runs);
   Spmat_Csr run_simulation(bool compute_result = false);
+  void print_stats(std::ostream& os);
 private:
   const toml::value parsed_config;
   Matrix_Data matrix_data;
   std::string out_path; 
 
-  std::variant<std::monostate, MergeForest, Gamma> arch;
+  std::variant<std::monostate, MergeForest, Gamma, Sampled_Simulation> arch;
 };
   
 } // namespace mergeforest_sim
@@ -0,0 +1,98 @@
+#ifndef MERGEFOREST_SIM_SMALL_VECTOR_HPP
+#define MERGEFOREST_SIM_SMALL_VECTOR_HPP
+
+#include <array>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+
+namespace mergeforest_sim {
+
+// Vector of trivially destructible elements that stores up to N elements
+// inline and moves them to the heap when it grows further. Clearing it keeps
+// the heap storage, so a vector that is cleared and refilled only allocates
+// the first time it outgrows N elements.
+template<typename T, std::size_t N>
+class Small_Vector {
+  static_assert(std::is_trivially_destructible_v<T>);
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  Small_Vector() = default;
+  Small_Vector(std::initializer_list<T> init) {
+    for (const auto& value : init) { push_back(value); }
+  }
+
+  static constexpr std::size_t inline_capacity() { return N; }
+
+  bool empty() const { return size() == 0; }
+  std::size_t size() const { return on_heap ? heap.size() : num_inline; }
+
+  T* data() { return on_heap ? heap.data() : inline_buf.data(); }
+  const T* data() const { return on_heap ? heap.data() : inline_buf.data(); }
+  iterator begin() { return data(); }
+  iterator end() { return data() + size(); }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size(); }
+
+  T& operator[](std::size_t idx) {
+    assert(idx < size());
+    return data()[idx];
+  }
+  const T& operator[](std::size_t idx) const {
+    assert(idx < size());
+    return data()[idx];
+  }
+  T& front() { return (*this)[0]; }
+  const T& front() const { return (*this)[0]; }
+  T& back() { return (*this)[size() - 1]; }
+  const T& back() const { return (*this)[size() - 1]; }
+
+  void push_back(const T& value) {
+    if (on_heap) {
+      heap.push_back(value);
+    } else if (num_inline < N) {
+      inline_buf[num_inline++] = value;
+    } else {
+      heap.assign(inline_buf.begin(), inline_buf.end());
+      heap.push_back(value);
+      on_heap = true;
+    }
+  }
+
+  template<typename... Args>
+  T& emplace_back(Args&&... args) {
+    push_back(T{std::forward<Args>(args)...});
+    return back();
+  }
+
+  void pop_back() {
+    assert(!empty());
+    if (on_heap) {
+      heap.pop_back();
+    } else {
+      --num_inline;
+    }
+  }
+
+  void clear() {
+    heap.clear();
+    num_inline = 0;
+    on_heap = false;
+  }
+
+private:
+  std::array<T, N> inline_buf {};
+  std::vector<T> heap;
+  std::size_t num_inline {};
+  bool on_heap {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_SMALL_VECTOR_HPP
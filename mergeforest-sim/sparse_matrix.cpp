@@ -1,13 +1,14 @@
 #include <mergeforest-sim/sparse_matrix.hpp>
 #include <mergeforest-sim/matrix_IO.hpp>
 #include <mergeforest-sim/math_utils.hpp>
+#include <mergeforest-sim/parallel.hpp>
+#include <mergeforest-sim/port.hpp>
+#include <mergeforest-sim/reuse_profile.hpp>
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
-#include <queue>
 #include <vector>
-#include <unordered_set>
 #include <tuple>
 #include <algorithm>
 #include <bit>
@@ -17,43 +18,111 @@
 
 namespace mergeforest_sim {
 
-Spmat_Csr::Spmat_Csr(const std::string& filename)
-  : Spmat_Csr{read_matrix_market_file(filename)}
+Spmat_Csr::Spmat_Csr(const std::string& filename, bool use_cache)
+  : Spmat_Csr{load_matrix(filename, use_cache)}
 {}
 
-Spmat_Csr Spmat_Csr::transpose() {
+Spmat_Csr Spmat_Csr::transpose() const {
+  // each thread transposes a block of rows
+  constexpr std::size_t min_rows_per_block = std::size_t{1} << 12;
   Spmat_Csr B;
   B.num_rows = num_cols;
   B.num_cols = num_rows;
   B.nnz = nnz;
-  B.row_ptr = std::vector<uint32_t>(B.num_rows + 1);
-  B.col_idx = std::vector<uint32_t>(B.nnz);
-  B.values = std::vector<double>(B.nnz);
-
-  std::vector<std::tuple<uint32_t, uint32_t, double>> coo;
-  for (unsigned i = 0; i < num_rows; ++i) {
-    for (unsigned j = row_ptr[i]; j < row_ptr[i + 1]; ++j) {
-      coo.emplace_back(col_idx[j], i, values[j]);
+  const auto max_blocks = max_histogram_blocks(nnz, num_cols);
+  // count the entries of each column in each block
+  std::vector<std::vector<uint32_t>> histograms(
+    num_parallel_blocks(num_rows, min_rows_per_block, max_blocks));
+  parallel_blocks(num_rows, [&](std::size_t block, std::size_t begin, std::size_t end) {
+    auto& histogram = histograms[block];
+    histogram.assign(num_cols, 0);
+    for (std::size_t j = row_ptr[begin]; j != row_ptr[end]; ++j) {
+      ++histogram[col_idx[j]];
     }
-  }
-  std::sort(coo.begin(), coo.end());
-  B.row_ptr[0] = 0;
-  uint32_t prev_row = 0;
-  for (unsigned i = 0; i < B.nnz; ++i) {
-    uint32_t row = std::get<0>(coo[i]);
-    B.col_idx[i] = std::get<1>(coo[i]);
-    B.values[i] = std::get<2>(coo[i]);
-    for (unsigned j = prev_row; j < row; ++j) {
-      B.row_ptr[j + 1] = i;
+  }, min_rows_per_block, max_blocks);
+  B.row_ptr = histograms_to_offsets(histograms, B.num_rows);
+  std::vector<uint32_t> B_col_idx(B.nnz);
+  std::vector<double> B_values(B.nnz);
+  // rows are visited in order, so the columns of each row of B are sorted
+  parallel_blocks(num_rows, [&](std::size_t block, std::size_t begin, std::size_t end) {
+    auto& offsets = histograms[block];
+    for (std::size_t i = begin; i != end; ++i) {
+      for (std::size_t j = row_ptr[i]; j != row_ptr[i + 1]; ++j) {
+        const auto entry_idx = offsets[col_idx[j]]++;
+        B_col_idx[entry_idx] = static_cast<uint32_t>(i);
+        B_values[entry_idx] = values[j];
+      }
     }
-    prev_row = row;
+  }, min_rows_per_block, max_blocks);
+  B.col_idx = std::move(B_col_idx);
+  B.values = std::move(B_values);
+  return B;
+}
+
+Spmat_Csr Spmat_Csr::row_slice(uint32_t begin, uint32_t end) const {
+  Spmat_Csr S;
+  S.num_rows = end - begin;
+  S.num_cols = num_cols;
+  const auto first = row_ptr[begin];
+  const auto last = row_ptr[end];
+  S.nnz = last - first;
+  std::vector<uint32_t> S_row_ptr(std::size_t{S.num_rows} + 1);
+  for (std::size_t i = 0; i < S_row_ptr.size(); ++i) {
+    S_row_ptr[i] = row_ptr[begin + i] - first;
   }
-  for (unsigned i = prev_row; i < B.num_rows; ++i) {
-    B.row_ptr[i + 1] = static_cast<uint32_t>(B.nnz);
+  S.row_ptr = std::move(S_row_ptr);
+  S.col_idx = std::vector<uint32_t>(col_idx.begin() + first, col_idx.begin() + last);
+  S.values = std::vector<double>(values.begin() + first, values.begin() + last);
+  return S;
+}
+
+Spmat_Csr Spmat_Csr::row_permutation(const std::vector<uint32_t>& rows) const {
+  Spmat_Csr S;
+  S.num_rows = static_cast<uint32_t>(rows.size());
+  S.num_cols = num_cols;
+  std::vector<uint32_t> S_row_ptr(rows.size() + 1, 0);
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    S_row_ptr[i + 1] = S_row_ptr[i] + row_ptr[rows[i] + 1] - row_ptr[rows[i]];
   }
-  B.col_idx[B.nnz - 1] = std::get<0>(coo[B.nnz - 1]);
-  B.values[B.nnz - 1] = std::get<2>(coo[B.nnz - 1]);
-  return B;
+  S.nnz = S_row_ptr.back();
+  std::vector<uint32_t> S_col_idx;
+  std::vector<double> S_values;
+  S_col_idx.reserve(S.nnz);
+  S_values.reserve(S.nnz);
+  for (const auto row : rows) {
+    S_col_idx.insert(S_col_idx.end(), col_idx.begin() + row_ptr[row], col_idx.begin() + row_ptr[row + 1]);
+    S_values.insert(S_values.end(), values.begin() + row_ptr[row], values.begin() + row_ptr[row + 1]);
+  }
+  S.row_ptr = std::move(S_row_ptr);
+  S.col_idx = std::move(S_col_idx);
+  S.values = std::move(S_values);
+  return S;
+}
+
+std::vector<uint32_t> histograms_to_offsets(std::vector<std::vector<uint32_t>>& histograms,
+                                            uint32_t num_rows)
+{
+  std::vector<uint32_t> row_ptr(std::size_t{num_rows} + 1, 0);
+  parallel_blocks(num_rows, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i != end; ++i) {
+      uint32_t row_size = 0;
+      for (auto& histogram : histograms) {
+        const auto count = histogram[i];
+        histogram[i] = row_size;
+        row_size += count;
+      }
+      row_ptr[i] = row_size;
+    }
+  }, std::size_t{1} << 12);
+  parallel_exclusive_scan(row_ptr.data(), row_ptr.size());
+  parallel_blocks(num_rows, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (auto& histogram : histograms) {
+      for (std::size_t i = begin; i != end; ++i) {
+        histogram[i] += row_ptr[i];
+      }
+    }
+  }, std::size_t{1} << 12);
+  return row_ptr;
 }
 
 Spmat_Packed::Spmat_Packed() {
@@ -111,9 +180,126 @@ void Spmat_Packed::init(const Spmat_Csr& A) {
   }
 }
 
-void spGEMM_symbolic_phase(const Spmat_Csr& A, const Spmat_Csr& B, Spmat_Csr& C) {
+namespace {
+
+// rows with at least num_cols / symbolic_bitmap_max_sparsity products count
+// their columns in a bitmap of all the columns
+constexpr std::size_t symbolic_bitmap_max_sparsity {16};
+// rows whose rows of B have on average this many columns per 64-column set
+// merge the sets, the others count their columns in a hash table
+constexpr std::size_t symbolic_packed_min_set_size {4};
+
+// scratch space of the symbolic phase, allocated on first use
+struct Symbolic_Scratch {
+  std::vector<uint64_t> bitmap;
+  std::vector<uint32_t> hash_table;
+  std::vector<uint32_t> row_idx;
+  std::vector<uint32_t> row_end;
+  std::vector<std::pair<uint32_t, uint32_t>> heap;
+};
+
+uint32_t row_nnz_bitmap(const Spmat_Csr& A, const Spmat_Csr& B, uint32_t row,
+                        Symbolic_Scratch& scratch)
+{
+  auto& bitmap = scratch.bitmap;
+  if (bitmap.empty()) { bitmap.resize(div_ceil(std::size_t{B.num_cols}, std::size_t{64}) + 1); }
+  uint32_t count {0};
+  for (uint32_t j = A.row_ptr[row]; j < A.row_ptr[row+1]; ++j) {
+    for (uint32_t k = B.row_ptr[A.col_idx[j]]; k < B.row_ptr[A.col_idx[j] + 1]; ++k) {
+      const auto bit = uint64_t{1} << (B.col_idx[k] % 64);
+      auto& word = bitmap[B.col_idx[k] / 64];
+      count += (word & bit) == 0;
+      word |= bit;
+    }
+  }
+  // clear only the words that were set
+  for (uint32_t j = A.row_ptr[row]; j < A.row_ptr[row+1]; ++j) {
+    for (uint32_t k = B.row_ptr[A.col_idx[j]]; k < B.row_ptr[A.col_idx[j] + 1]; ++k) {
+      bitmap[B.col_idx[k] / 64] = 0;
+    }
+  }
+  return count;
+}
+
+uint32_t row_nnz_hash(const Spmat_Csr& A, const Spmat_Csr& B, uint32_t row,
+                      std::size_t flops, Symbolic_Scratch& scratch)
+{
+  // open addressing with linear probing, at most half full
+  const auto table_size = std::bit_ceil(2 * flops);
+  auto& table = scratch.hash_table;
+  if (table.size() < table_size) { table.resize(table_size); }
+  std::fill_n(table.begin(), table_size, UINT32_MAX);
+  const auto mask = table_size - 1;
+  uint32_t count {0};
+  for (uint32_t j = A.row_ptr[row]; j < A.row_ptr[row+1]; ++j) {
+    for (uint32_t k = B.row_ptr[A.col_idx[j]]; k < B.row_ptr[A.col_idx[j] + 1]; ++k) {
+      const auto col = B.col_idx[k];
+      // multiplicative hashing
+      auto slot = (std::size_t{col} * 2654435761U) & mask;
+      while (table[slot] != UINT32_MAX && table[slot] != col) {
+        slot = (slot + 1) & mask;
+      }
+      if (table[slot] == UINT32_MAX) {
+        table[slot] = col;
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+// merges the 64-column sets of the rows of B with a heap
+uint32_t row_nnz_packed(const Spmat_Csr& A, const Spmat_Packed& B_packed, uint32_t row,
+                        Symbolic_Scratch& scratch)
+{
   using pi = std::pair<uint32_t, uint32_t>;
-  
+  const auto row_size = A.row_ptr[row+1] - A.row_ptr[row];
+  auto& row_idx = scratch.row_idx;
+  auto& row_end = scratch.row_end;
+  if (row_idx.size() < row_size) {
+    row_idx.resize(row_size);
+    row_end.resize(row_size);
+  }
+  // min-heap of (column set index, row of B)
+  auto& heap = scratch.heap;
+  const auto heap_push = [&heap](pi elem) {
+    heap.push_back(elem);
+    std::ranges::push_heap(heap, std::greater{});
+  };
+  unsigned cur_idx = UINT_MAX;
+  unsigned counter = 0;
+  uint64_t cur_set = 0;
+  for (unsigned j = 0; j < row_size; ++j) {
+    row_idx[j] = B_packed.row_ptr[A.col_idx[A.row_ptr[row] + j]];
+    row_end[j] = B_packed.row_ptr[A.col_idx[A.row_ptr[row] + j] + 1];
+    if(row_idx[j] < row_end[j]) {
+      heap_push(std::make_pair(B_packed.col_set_idx[row_idx[j]], j));
+    }
+  }
+  while (!heap.empty()) {
+    std::ranges::pop_heap(heap, std::greater{});
+    const pi min = heap.back();
+    heap.pop_back();
+    if (min.first == cur_idx) {
+      cur_set |= B_packed.col_set[row_idx[min.second]];
+    } else {
+      if (cur_idx != UINT_MAX) {
+        counter += static_cast<unsigned>(std::popcount(cur_set));
+      }
+      cur_idx = min.first;
+      cur_set = B_packed.col_set[row_idx[min.second]];
+    }
+    ++row_idx[min.second];
+    if(row_idx[min.second] < row_end[min.second])
+      heap_push(std::make_pair(B_packed.col_set_idx[row_idx[min.second]], min.second));
+  }
+  counter += static_cast<unsigned>(std::popcount(cur_set));
+  return counter;
+}
+
+} // namespace
+
+void spGEMM_symbolic_phase(const Spmat_Csr& A, const Spmat_Csr& B, Spmat_Csr& C) {
   if (A.num_cols != B.num_rows) {
     throw std::runtime_error("matrices A and B don't have compatible dimensions");
   }
@@ -121,51 +307,46 @@ void spGEMM_symbolic_phase(const Spmat_Csr& A, const Spmat_Csr& B, Spmat_Csr& C)
   B_packed.init(B);
   C.num_rows = A.num_rows;
   C.num_cols = B.num_cols;
-  C.row_ptr = std::vector<uint32_t>(C.num_rows + 1);
-  unsigned max_row_size = 0;
-  for (unsigned i = 0; i < A.num_rows; ++i) {
-    if (max_row_size < A.row_ptr[i+1] - A.row_ptr[i])
-      max_row_size = A.row_ptr[i+1] - A.row_ptr[i];
-  }
-  std::vector<uint32_t> row_idx(max_row_size);
-  std::vector<uint32_t> row_end(max_row_size);
-
-  std::priority_queue<pi, std::vector<pi>, std::greater<pi>> heap;
-  C.row_ptr[0] = 0;
-  for (unsigned i = 0; i < A.num_rows; ++i) {
-    unsigned cur_idx = UINT_MAX;
-    unsigned counter = 0;
-    uint64_t cur_set = 0;
-    for (unsigned j = 0; j < A.row_ptr[i+1] - A.row_ptr[i]; ++j) {
-      row_idx[j] = B_packed.row_ptr[A.col_idx[A.row_ptr[i] + j]];
-      row_end[j] = B_packed.row_ptr[A.col_idx[A.row_ptr[i] + j] + 1];
-      if(row_idx[j] < row_end[j]) {
-        heap.push(std::make_pair(B_packed.col_set_idx[row_idx[j]], j));
+  std::vector<uint32_t> row_ptr(std::size_t{C.num_rows} + 1, 0);
+  // each row picks the cheapest way to count its columns from its number of
+  // products and of 64-column sets, and the rows are split in many more
+  // chunks than threads so that the rows with most products don't end up in
+  // a single thread. Each worker reuses its scratch space for all its chunks.
+  const auto num_chunks = num_parallel_blocks(A.num_rows, 256, 16 * num_threads());
+  const auto num_workers = std::min<std::size_t>(num_threads(), num_chunks);
+  std::vector<Symbolic_Scratch> worker_scratch(num_workers);
+  parallel_jobs(num_chunks, [&](std::size_t worker, std::size_t chunk) {
+    const auto begin = static_cast<uint32_t>(A.num_rows * chunk / num_chunks);
+    const auto end = static_cast<uint32_t>(A.num_rows * (chunk + 1) / num_chunks);
+    auto& scratch = worker_scratch[worker];
+    for (uint32_t i = begin; i < end; ++i) {
+      std::size_t flops {0};
+      std::size_t num_sets {0};
+      for (uint32_t j = A.row_ptr[i]; j < A.row_ptr[i+1]; ++j) {
+        flops += B.row_ptr[A.col_idx[j] + 1] - B.row_ptr[A.col_idx[j]];
+        num_sets += B_packed.row_ptr[A.col_idx[j] + 1] - B_packed.row_ptr[A.col_idx[j]];
       }
-    }
-    while (!heap.empty()) {
-      pi min = heap.top();
-      heap.pop();
-      if (min.first == cur_idx) {
-        cur_set |= B_packed.col_set[row_idx[min.second]];
+      if (flops == 0) {
+        row_ptr[i] = 0;
+      } else if (flops * symbolic_bitmap_max_sparsity >= B.num_cols) {
+        row_ptr[i] = row_nnz_bitmap(A, B, i, scratch);
+      } else if (num_sets * symbolic_packed_min_set_size <= flops) {
+        row_ptr[i] = row_nnz_packed(A, B_packed, i, scratch);
       } else {
-        if (cur_idx != UINT_MAX) {
-          counter += static_cast<unsigned>(std::popcount(cur_set));
-        }
-        cur_idx = min.first;
-        cur_set = B_packed.col_set[row_idx[min.second]];
+        row_ptr[i] = row_nnz_hash(A, B, i, flops, scratch);
       }
-      ++row_idx[min.second];
-      if(row_idx[min.second] < row_end[min.second])
-        heap.push(std::make_pair(B_packed.col_set_idx[row_idx[min.second]], min.second));
     }
-    counter += static_cast<unsigned>(std::popcount(cur_set));
-    C.row_ptr[i + 1] = C.row_ptr[i] + counter;
-  }
-  C.nnz = C.row_ptr.back();
+  }, num_workers);
+  parallel_exclusive_scan(row_ptr.data(), row_ptr.size());
+  C.row_ptr = std::move(row_ptr);
+  C.nnz = C.row_ptr[C.num_rows];
 }
 
-void print_spGEMM_stats(const Spmat_Csr& A, const Spmat_Csr& B, std::string_view out_path) {
+void print_spGEMM_stats(const Spmat_Csr& A, const Spmat_Csr& B, std::string_view out_path,
+                        const std::vector<std::size_t>& cache_sizes)
+{
+  // intervals of the B row references in which the working set is measured
+  constexpr std::size_t working_set_intervals = 32;
   Spmat_Csr C_symbolic_phase;
   spGEMM_symbolic_phase(A, B, C_symbolic_phase);
   std::size_t num_mults {0};
@@ -176,19 +357,23 @@ void print_spGEMM_stats(const Spmat_Csr& A, const Spmat_Csr& B, std::string_view
   std::size_t rows_to_process {0};
   std::size_t A_data_num_elements {0};
   std::size_t min_bytes_B_data {0};
-  std::unordered_set<uint32_t> B_row_set;
+  std::vector<bool> B_row_used(B.num_rows);
+  // B rows in the order of the preprocessed data
+  std::vector<std::pair<uint32_t, uint32_t>> B_row_ptr_end;
+  B_row_ptr_end.reserve(A.nnz);
 
   for (std::size_t i = 0; i < A.num_rows; ++i) {
     unsigned non_empty_rows {0};
     for (std::size_t j = A.row_ptr[i]; j < A.row_ptr[i + 1]; ++j) {
       const std::size_t B_row_size = B.row_ptr[A.col_idx[j] + 1] - B.row_ptr[A.col_idx[j]];
       if (B_row_size > 0) {
-         if (!B_row_set.contains(A.col_idx[j])) {
-          B_row_set.insert(A.col_idx[j]);
+        if (!B_row_used[A.col_idx[j]]) {
+          B_row_used[A.col_idx[j]] = true;
           min_bytes_B_data += B_row_size;
         }
         ++non_empty_rows;
         num_mults += B_row_size;
+        B_row_ptr_end.emplace_back(B.row_ptr[A.col_idx[j]], B.row_ptr[A.col_idx[j] + 1]);
       }
       B_max_row_size = std::max(B_max_row_size, B_row_size);
       B_min_row_size = std::min(B_min_row_size, B_row_size);
@@ -252,6 +437,45 @@ void print_spGEMM_stats(const Spmat_Csr& A, const Spmat_Csr& B, std::string_view
              static_cast<double>(num_mults) / static_cast<double>(A_bytes + B_max_bytes + C_bytes));
   fmt::print(*os, "operational intensity (full B row reuse): {:.4f} flops/byte\n",
              static_cast<double>(num_mults) / static_cast<double>(A_bytes + min_bytes_B_data + C_bytes));
+
+  const auto profile = B_Reuse_Profile::compute(B_row_ptr_end, working_set_intervals);
+  const auto to_MB = [](double blocks) { return blocks * static_cast<double>(block_size_bytes) * 1E-6; };
+  fmt::print(*os, "*---B Reuse---*\n");
+  fmt::print(*os, "B row references: {} ({} first uses)\n", profile.rows.num_refs,
+             profile.rows.cold_refs);
+  fmt::print(*os, "mean B row stack distance: {:.4f} MB\n", to_MB(profile.rows.mean_distance()));
+  fmt::print(*os, "B block references: {} ({} first uses)\n", profile.blocks.num_refs,
+             profile.blocks.cold_refs);
+  fmt::print(*os, "mean B block stack distance: {:.4f} MB\n",
+             to_MB(profile.blocks.mean_distance()));
+  // fully associative LRU caches of whole B rows, as the linked list cache,
+  // and of B blocks, as the fiber cache
+  fmt::print(*os, "*---B Miss Ratio Curve---*\n");
+  std::vector<std::size_t> sizes(cache_sizes);
+  const auto max_distance = std::max(profile.rows.max_distance(), profile.blocks.max_distance());
+  for (std::size_t size = 16 * 1024; ; size *= 2) {
+    sizes.push_back(size);
+    if (size / block_size_bytes >= max_distance) break;
+  }
+  std::ranges::sort(sizes);
+  const auto [last, end] = std::ranges::unique(sizes);
+  sizes.erase(last, end);
+  for (const auto size : sizes) {
+    const auto cache_blocks = size / block_size_bytes;
+    fmt::print(*os, "{} KB: B row miss ratio {:.4f}, B row traffic {:.4f} MB, "
+               "B block miss ratio {:.4f}, B block traffic {:.4f} MB\n",
+               size / 1024,
+               ratio(profile.rows.misses(cache_blocks), profile.rows.num_refs),
+               to_MB(profile.rows.miss_blocks(cache_blocks)),
+               ratio(profile.blocks.misses(cache_blocks), profile.blocks.num_refs),
+               to_MB(profile.blocks.miss_blocks(cache_blocks)));
+  }
+  fmt::print(*os, "*---B Working Set---*\n");
+  for (const auto& working_set : profile.working_sets) {
+    fmt::print(*os, "references {}-{}: {} B rows, {} B blocks ({:.4f} MB)\n",
+               working_set.begin_ref, working_set.end_ref, working_set.num_rows,
+               working_set.num_blocks, to_MB(static_cast<double>(working_set.num_blocks)));
+  }
 }
 
 } // namespace mergeforest_sim
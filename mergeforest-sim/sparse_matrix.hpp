@@ -1,25 +1,36 @@
 #ifndef MERGEFOREST_SIM_SP_MAT_HPP
 #define MERGEFOREST_SIM_SP_MAT_HPP
 
+#include <mergeforest-sim/csr_array.hpp>
+#include <mergeforest-sim/parallel.hpp>
+
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 namespace mergeforest_sim {
 
 struct Spmat_Csr {
   Spmat_Csr() = default;
-  explicit Spmat_Csr(const std::string& filename);
+  // loads a Matrix Market file through its binary cache (see matrix_IO.hpp)
+  explicit Spmat_Csr(const std::string& filename, bool use_cache = true);
 
-  Spmat_Csr transpose();
+  Spmat_Csr transpose() const;
+  // matrix with the rows [begin, end) of this matrix
+  Spmat_Csr row_slice(uint32_t begin, uint32_t end) const;
+  // matrix with the given rows of this matrix, in that order
+  Spmat_Csr row_permutation(const std::vector<uint32_t>& rows) const;
 
   uint32_t num_rows {0};
   uint32_t num_cols {0};
   std::size_t nnz {0};
-  std::vector<uint32_t> row_ptr;
-  std::vector<uint32_t> row_end;
-  std::vector<uint32_t> col_idx;
-  std::vector<double> values;
+  Csr_Array<uint32_t> row_ptr;
+  Csr_Array<uint32_t> row_end;
+  Csr_Array<uint32_t> col_idx;
+  Csr_Array<double> values;
 };
 
 struct Spmat_Packed {
@@ -33,9 +44,25 @@ struct Spmat_Packed {
   void init(const Spmat_Csr& A);
 };
 
+// Turns per-block row histograms in the insertion offsets of each block, so
+// that the entries of a block are placed after the ones of the previous
+// blocks, and returns the row pointers of the matrix (counting sort build).
+std::vector<uint32_t> histograms_to_offsets(std::vector<std::vector<uint32_t>>& histograms,
+                                            uint32_t num_rows);
+
+// Maximum number of blocks with a histogram of num_rows entries, so that the
+// histograms together don't take more memory than the entries of the matrix
+// whatever the number of threads.
+inline std::size_t max_histogram_blocks(std::size_t nnz, std::size_t num_rows) {
+  return std::clamp<std::size_t>(nnz / std::max<std::size_t>(num_rows, 1), 1, num_threads());
+}
+
 void spGEMM_symbolic_phase(const Spmat_Csr& A, const Spmat_Csr& B, Spmat_Csr& C);
 
-void print_spGEMM_stats(const Spmat_Csr& A, const Spmat_Csr& B, std::string_view out_path);
+// cache_sizes are the sizes in bytes at which the B traffic is predicted,
+// besides the powers of two up to the B data used
+void print_spGEMM_stats(const Spmat_Csr& A, const Spmat_Csr& B, std::string_view out_path,
+                        const std::vector<std::size_t>& cache_sizes = {});
   
 } // namespace mergeforest_sim
 
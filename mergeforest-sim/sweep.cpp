@@ -0,0 +1,205 @@
+#include <mergeforest-sim/sweep.hpp>
+#include <mergeforest-sim/host_metrics.hpp>
+#include <mergeforest-sim/matrix_IO.hpp>
+#include <mergeforest-sim/matrix_data.hpp>
+#include <mergeforest-sim/parallel.hpp>
+#include <mergeforest-sim/simulator.hpp>
+#include <mergeforest-sim/sparse_matrix.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <spdlog/spdlog.h>
+#include <toml.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace mergeforest_sim {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Stats_Row = std::vector<std::pair<std::string, std::string>>;
+
+// keeps the "name: value" lines of the stats output, where only the first
+// word of the value is kept (units and derived percentages are dropped)
+Stats_Row parse_stats(const std::string& stats) {
+  Stats_Row row;
+  std::istringstream is(stats);
+  std::string line;
+  while (std::getline(is, line)) {
+    const auto sep = line.find(": ");
+    if (sep == std::string::npos) { continue; }
+    auto name = std::string_view(line).substr(0, sep);
+    name = name.substr(0, name.find_last_not_of(' ') + 1);
+    auto value = std::string_view(line).substr(sep + 2);
+    value = value.substr(0, value.find(' '));
+    row.emplace_back(name, value);
+  }
+  return row;
+}
+
+std::string csv_field(const std::string& field) {
+  if (field.find_first_of(",\"\n") == std::string::npos) { return field; }
+  std::string quoted = "\"";
+  for (const char c : field) {
+    if (c == '"') { quoted += '"'; }
+    quoted += c;
+  }
+  return quoted + '"';
+}
+
+void write_table(const std::string& filename,
+                 const std::vector<std::string>& matrix_files,
+                 const std::vector<std::string>& config_files,
+                 const std::vector<std::string>& status,
+                 const std::vector<Stats_Row>& rows)
+{
+  // union of the stats of all architectures in order of appearance
+  std::vector<std::string> columns;
+  for (const auto& row : rows) {
+    for (const auto& [name, value] : row) {
+      if (std::ranges::find(columns, name) == columns.end()) {
+        columns.push_back(name);
+      }
+    }
+  }
+  std::ofstream of(filename);
+  if (!of) {
+    throw std::runtime_error("unable to open file \"" + filename + "\" for writing");
+  }
+  fmt::print(of, "matrix,config,status");
+  for (const auto& c : columns) { fmt::print(of, ",{}", csv_field(c)); }
+  fmt::print(of, "\n");
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    fmt::print(of, "{},{},{}", csv_field(matrix_files[i / config_files.size()]),
+               csv_field(config_files[i % config_files.size()]), status[i]);
+    for (const auto& c : columns) {
+      const auto it = std::ranges::find(rows[i], c, &Stats_Row::value_type::first);
+      fmt::print(of, ",{}", it != rows[i].end() ? csv_field(it->second) : "");
+    }
+    fmt::print(of, "\n");
+  }
+}
+
+} // namespace
+
+void run_sweep(const std::vector<std::string>& matrix_files,
+               const std::vector<std::string>& config_files,
+               const std::string& out_dir, const std::string& table_filename,
+               bool compute_result, bool use_matrix_cache, unsigned num_workers,
+               const std::string& preproc_cache_dir)
+{
+  // parse the configs first so that an invalid one fails before any matrix is loaded
+  for (const auto& config_file : config_files) {
+    const auto parsed_config = toml::parse(config_file);
+    toml::find<std::string>(parsed_config, "arch");
+  }
+  // the results of a simulation are named after the matrix and config stems,
+  // files with the same stems would overwrite each other's results
+  const auto num_sims = matrix_files.size() * config_files.size();
+  std::vector<std::string> out_filenames(num_sims);
+  std::set<std::string> used_filenames;
+  for (std::size_t sim = 0; sim < num_sims; ++sim) {
+    const auto& matrix_file = matrix_files[sim / config_files.size()];
+    const auto& config_file = config_files[sim % config_files.size()];
+    out_filenames[sim] = fs::path(matrix_file).stem().string() + '_'
+      + fs::path(config_file).stem().string() + "_sim_results.txt";
+    if (!used_filenames.insert(out_filenames[sim]).second) {
+      throw std::runtime_error("The simulation of " + matrix_file + " with " + config_file
+                               + " would overwrite the results in " + out_filenames[sim]
+                               + " of another simulation");
+    }
+  }
+  std::vector<Spmat_Csr> A(matrix_files.size());
+  std::vector<Spmat_Csr> A_transpose(matrix_files.size());
+  std::vector<double> load_times(matrix_files.size());
+  for (std::size_t i = 0; i < matrix_files.size(); ++i) {
+    const auto load_start = Host_Clock::now();
+    fmt::print("Loading matrix {}... ", matrix_files[i]);
+    fflush(stdout);
+    A[i] = load_matrix(matrix_files[i], use_matrix_cache);
+    if (A[i].num_rows != A[i].num_cols) {
+      A_transpose[i] = A[i].transpose();
+    }
+    load_times[i] = elapsed_seconds(load_start);
+    fmt::print("Done\n");
+  }
+  // B = A for square matrices and B = A^T otherwise, as in the simulate command
+  const auto matrix_B = [&](std::size_t matrix_idx) -> const Spmat_Csr& {
+    return A_transpose[matrix_idx].num_rows > 0 ? A_transpose[matrix_idx] : A[matrix_idx];
+  };
+  if (!preproc_cache_dir.empty()) {
+    // fill the cache first, otherwise the simulations of the same matrix
+    // would all miss it since they start at the same time
+    for (std::size_t i = 0; i < matrix_files.size(); ++i) {
+      fmt::print("Preprocessing matrix {}... ", matrix_files[i]);
+      fflush(stdout);
+      Matrix_Data matrix_data;
+      matrix_data.A = &A[i];
+      matrix_data.B = &matrix_B(i);
+      matrix_data.verbose = false;
+      matrix_data.preproc_cache_dir = preproc_cache_dir;
+      matrix_data.preprocess_mats();
+      fmt::print("Done\n");
+    }
+  }
+  fs::create_directories(out_dir);
+
+  std::vector<Stats_Row> rows(num_sims);
+  std::vector<std::string> status(num_sims, "ok");
+  // start with the biggest matrices, so that the longest simulations don't
+  // run alone at the end of the sweep
+  std::vector<std::size_t> order(num_sims);
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::ranges::stable_sort(order, std::greater{}, [&](std::size_t sim) {
+    return A[sim / config_files.size()].nnz;
+  });
+  std::mutex print_mutex;
+  std::size_t num_finished {};
+
+  if (num_workers == 0) { num_workers = num_threads(); }
+  const auto concurrent_runs = std::min<std::size_t>(num_workers, num_sims);
+  fmt::print("Running {} simulations...\n", num_sims);
+  parallel_jobs(num_sims, [&](std::size_t job) {
+    const auto sim = order[job];
+    const auto matrix_idx = sim / config_files.size();
+    const auto config_idx = sim % config_files.size();
+    const auto out_path = (fs::path(out_dir) / out_filenames[sim]).string();
+    try {
+      Simulator simulator(config_files[config_idx], out_path);
+      simulator.set_verbose(false);
+      simulator.set_preproc_cache_dir(preproc_cache_dir);
+      simulator.set_load_time(load_times[matrix_idx]);
+      simulator.set_concurrent_runs(concurrent_runs);
+      simulator.set_mats(A[matrix_idx], matrix_B(matrix_idx));
+      simulator.run_simulation(compute_result);
+      std::ostringstream stats;
+      simulator.print_stats(stats);
+      rows[sim] = parse_stats(stats.str());
+    } catch (const std::exception& e) {
+      status[sim] = "error";
+      spdlog::error("Simulation of {} with {} failed: {}", matrix_files[matrix_idx],
+                    config_files[config_idx], e.what());
+    }
+    std::lock_guard lock(print_mutex);
+    ++num_finished;
+    fmt::print("sweep: {}/{} simulations\r", num_finished, num_sims);
+    fflush(stdout);
+  }, num_workers);
+  fmt::print("\n");
+
+  write_table((fs::path(out_dir) / table_filename).string(), matrix_files,
+              config_files, status, rows);
+}
+
+} // namespace mergeforest_sim
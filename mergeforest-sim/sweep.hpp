@@ -0,0 +1,26 @@
+#ifndef MERGEFOREST_SIM_SWEEP_HPP
+#define MERGEFOREST_SIM_SWEEP_HPP
+
+#include <string>
+#include <vector>
+
+namespace mergeforest_sim {
+
+// Simulates every matrix with every config. Each matrix is loaded once and
+// shared read-only by its simulations, which run in parallel on num_workers
+// threads (0 uses all hardware threads). The results of each simulation are
+// written to out_dir as with the simulate command, and a table with one row
+// per simulation and one column per statistic is written to
+// out_dir/table_filename in CSV format. Throws before loading the matrices if
+// two simulations would write the same results file. If preproc_cache_dir is
+// not empty, each matrix is preprocessed once before the simulations start
+// and the simulations load the preprocessed data from the cache.
+void run_sweep(const std::vector<std::string>& matrix_files,
+               const std::vector<std::string>& config_files,
+               const std::string& out_dir, const std::string& table_filename,
+               bool compute_result = false, bool use_matrix_cache = true,
+               unsigned num_workers = 0, const std::string& preproc_cache_dir = {});
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_SWEEP_HPP
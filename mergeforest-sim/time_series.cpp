@@ -0,0 +1,312 @@
+#include <mergeforest-sim/time_series.hpp>
+#include <mergeforest-sim/mapped_file.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <fmt/ranges.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+#include <cstring>
+
+namespace mergeforest_sim {
+
+namespace {
+
+// File layout, all integers little endian:
+//   magic, version, number of columns, interval
+//   per column: cumulative flag, name size, name
+//   per block: number of rows, encoded size of each column, encoded columns
+constexpr char time_series_magic[8] = {'M', 'F', 'S', 'I', 'M', 'T', 'S', 'R'};
+constexpr uint32_t time_series_version = 1;
+
+template<typename T>
+void write_value(std::ofstream& file, T value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void encode_varint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// zigzag encoding of the wrapping difference, small decrements of the gauges
+// also take one byte
+uint64_t zigzag_delta(uint64_t value, uint64_t prev) {
+  const auto delta = static_cast<int64_t>(value - prev);
+  return (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+}
+
+uint64_t unzigzag_delta(uint64_t encoded, uint64_t prev) {
+  return prev + ((encoded >> 1) ^ (~(encoded & 1) + 1));
+}
+
+class Reader {
+public:
+  explicit Reader(const Mapped_File& file_) : file{file_} {}
+
+  bool finished() const { return pos == file.size(); }
+
+  template<typename T>
+  T read_value() {
+    T value;
+    read_bytes(&value, sizeof(T));
+    return value;
+  }
+
+  std::string read_string(std::size_t size) {
+    std::string str(size, '\0');
+    read_bytes(str.data(), size);
+    return str;
+  }
+
+  uint64_t read_varint(std::size_t end) {
+    uint64_t value {};
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (pos == end) { break; }
+      const auto byte = static_cast<uint8_t>(file.data()[pos++]);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) { return value; }
+    }
+    throw std::runtime_error("Corrupted time series column");
+  }
+
+  std::size_t pos {};
+private:
+  void read_bytes(void* dest, std::size_t size) {
+    if (file.size() - pos < size) {
+      throw std::runtime_error("Truncated time series file");
+    }
+    std::memcpy(dest, file.data() + pos, size);
+    pos += size;
+  }
+
+  const Mapped_File& file;
+};
+
+} // namespace
+
+Time_Series_Writer::~Time_Series_Writer() {
+  if (is_open()) {
+    {
+      std::lock_guard lock(mutex);
+      closing = true;
+    }
+    cond.notify_one();
+    writer.join();
+  }
+}
+
+void Time_Series_Writer::add_counter(std::string name, const std::size_t* counter,
+                                     std::size_t scale)
+{
+  add_column(std::move(name), counter, true, scale);
+}
+
+void Time_Series_Writer::add_gauge(std::string name, const std::size_t* gauge) {
+  add_column(std::move(name), gauge, false, 1);
+}
+
+void Time_Series_Writer::add_column(std::string name, const std::size_t* value,
+                                    bool cumulative_, std::size_t scale)
+{
+  if (is_open()) {
+    throw std::runtime_error("Time series columns must be added before opening the file");
+  }
+  names.push_back(column_prefix + name);
+  cumulative.push_back(cumulative_);
+  values.push_back(value);
+  scales.push_back(scale);
+}
+
+void Time_Series_Writer::open(const std::string& filename, std::size_t interval_) {
+  if (interval_ == 0) {
+    throw std::runtime_error("The time series interval must be positive");
+  }
+  file.open(filename, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error(fmt::format("Cannot open time series file {}", filename));
+  }
+  file.write(time_series_magic, sizeof(time_series_magic));
+  write_value(file, time_series_version);
+  write_value(file, static_cast<uint32_t>(names.size() + 1));
+  write_value<uint64_t>(file, interval_);
+  const std::string cycle_name = "cycle";
+  write_value(file, uint8_t{0});
+  write_value(file, static_cast<uint32_t>(cycle_name.size()));
+  file.write(cycle_name.data(), static_cast<std::streamsize>(cycle_name.size()));
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    write_value(file, cumulative[i]);
+    write_value(file, static_cast<uint32_t>(names[i].size()));
+    file.write(names[i].data(), static_cast<std::streamsize>(names[i].size()));
+  }
+  interval = interval_;
+  next_sample = interval;
+  last_sample = SIZE_MAX;
+  closing = false;
+  block.clear();
+  block.reserve(rows_per_block * (values.size() + 1));
+  writer = std::thread(&Time_Series_Writer::write_loop, this);
+}
+
+void Time_Series_Writer::close(std::size_t cycle) {
+  if (!is_open()) { return; }
+  // the last sample covers the cycles since the previous one
+  if (cycle != last_sample) { record(cycle); }
+  if (!block.empty()) { push_block(); }
+  {
+    std::lock_guard lock(mutex);
+    closing = true;
+  }
+  cond.notify_one();
+  writer.join();
+  file.close();
+  next_sample = SIZE_MAX;
+  full_blocks.clear();
+  free_blocks.clear();
+  if (!file) {
+    throw std::runtime_error("Error writing the time series file");
+  }
+}
+
+void Time_Series_Writer::record(std::size_t cycle) {
+  block.push_back(cycle);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    block.push_back(*values[i] * scales[i]);
+  }
+  last_sample = cycle;
+  // after skipping idle cycles several intervals may have passed
+  next_sample = (cycle / interval + 1) * interval;
+  if (block.size() == rows_per_block * (values.size() + 1)) {
+    push_block();
+  }
+}
+
+void Time_Series_Writer::push_block() {
+  std::vector<uint64_t> next_block;
+  {
+    std::lock_guard lock(mutex);
+    full_blocks.push_back(std::move(block));
+    if (!free_blocks.empty()) {
+      next_block = std::move(free_blocks.back());
+      free_blocks.pop_back();
+    }
+  }
+  cond.notify_one();
+  next_block.clear();
+  next_block.reserve(rows_per_block * (values.size() + 1));
+  block = std::move(next_block);
+}
+
+void Time_Series_Writer::write_loop() {
+  std::unique_lock lock(mutex);
+  for (;;) {
+    cond.wait(lock, [this] { return closing || !full_blocks.empty(); });
+    if (full_blocks.empty()) { break; }
+    auto full_block = std::move(full_blocks.front());
+    full_blocks.pop_front();
+    lock.unlock();
+    write_block(full_block);
+    lock.lock();
+    free_blocks.push_back(std::move(full_block));
+  }
+}
+
+void Time_Series_Writer::write_block(const std::vector<uint64_t>& full_block) {
+  const auto num_columns = values.size() + 1;
+  const auto num_rows = full_block.size() / num_columns;
+  encoded.clear();
+  column_sizes.clear();
+  // the deltas of each block start from zero, so the blocks can be decoded
+  // independently
+  for (std::size_t column = 0; column < num_columns; ++column) {
+    const auto begin = encoded.size();
+    uint64_t prev {};
+    for (std::size_t row = 0; row < num_rows; ++row) {
+      const auto value = full_block[row * num_columns + column];
+      encode_varint(encoded, zigzag_delta(value, prev));
+      prev = value;
+    }
+    column_sizes.push_back(static_cast<uint32_t>(encoded.size() - begin));
+  }
+  write_value(file, static_cast<uint32_t>(num_rows));
+  file.write(reinterpret_cast<const char*>(column_sizes.data()),
+             static_cast<std::streamsize>(column_sizes.size() * sizeof(uint32_t)));
+  file.write(reinterpret_cast<const char*>(encoded.data()),
+             static_cast<std::streamsize>(encoded.size()));
+}
+
+void open_time_series(Time_Series_Writer& writer, const toml::value& parsed_config,
+                      const std::string& out_path)
+{
+  const auto interval = toml::find_or<std::size_t>(parsed_config, "time_series", "interval", 0);
+  if (interval == 0) { return; }
+  auto filename = toml::find_or<std::string>(parsed_config, "time_series", "file", "");
+  if (filename.empty()) {
+    filename = out_path.empty() ? "time_series.ts"
+      : std::filesystem::path(out_path).replace_extension(".ts").string();
+  }
+  writer.open(filename, interval);
+}
+
+Time_Series read_time_series(const std::string& filename) {
+  const Mapped_File file(filename);
+  Reader reader(file);
+  char magic[sizeof(time_series_magic)];
+  for (auto& c : magic) { c = reader.read_value<char>(); }
+  if (std::memcmp(magic, time_series_magic, sizeof(magic)) != 0
+      || reader.read_value<uint32_t>() != time_series_version)
+  {
+    throw std::runtime_error(fmt::format("{} is not a time series file", filename));
+  }
+  Time_Series time_series;
+  const auto num_columns = reader.read_value<uint32_t>();
+  time_series.interval = reader.read_value<uint64_t>();
+  for (uint32_t i = 0; i < num_columns; ++i) {
+    time_series.cumulative.push_back(reader.read_value<uint8_t>() != 0);
+    time_series.names.push_back(reader.read_string(reader.read_value<uint32_t>()));
+  }
+  time_series.columns.resize(num_columns);
+  std::vector<uint32_t> column_sizes(num_columns);
+  while (!reader.finished()) {
+    const auto num_rows = reader.read_value<uint32_t>();
+    for (auto& size : column_sizes) { size = reader.read_value<uint32_t>(); }
+    for (uint32_t i = 0; i < num_columns; ++i) {
+      // the sizes come from the file, a column can't go past its end
+      if (column_sizes[i] > file.size() - reader.pos) {
+        throw std::runtime_error("Corrupted time series column");
+      }
+      const auto end = reader.pos + column_sizes[i];
+      auto& column = time_series.columns[i];
+      uint64_t prev {};
+      for (uint32_t row = 0; row < num_rows; ++row) {
+        prev = unzigzag_delta(reader.read_varint(end), prev);
+        column.push_back(prev);
+      }
+      if (reader.pos != end) {
+        throw std::runtime_error("Corrupted time series column");
+      }
+    }
+  }
+  return time_series;
+}
+
+void print_time_series_csv(const Time_Series& time_series, std::ostream& os) {
+  fmt::print(os, "{}\n", fmt::join(time_series.names, ","));
+  if (time_series.columns.empty()) { return; }
+  const auto num_rows = time_series.columns.front().size();
+  std::vector<uint64_t> row(time_series.columns.size());
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    for (std::size_t j = 0; j < row.size(); ++j) {
+      const auto& column = time_series.columns[j];
+      row[j] = time_series.cumulative[j] && i > 0 ? column[i] - column[i - 1] : column[i];
+    }
+    fmt::print(os, "{}\n", fmt::join(row, ","));
+  }
+}
+
+} // namespace mergeforest_sim
@@ -0,0 +1,108 @@
+#ifndef MERGEFOREST_SIM_TIME_SERIES_HPP
+#define MERGEFOREST_SIM_TIME_SERIES_HPP
+
+#include <toml.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+// Samples the counters of the simulated components every interval cycles
+// and stores them in a binary columnar file. Counters are cumulative, like
+// the number of memory reads, while gauges are the current value of a
+// quantity, like the number of active blocks. The samples are grouped
+// in blocks of rows_per_block rows, each block stores the cycle column
+// followed by one column per counter, and each column stores the zigzag
+// varint encoded deltas between consecutive samples, so the per-interval
+// values of the cumulative counters take one or two bytes.
+//
+// The simulation loop only copies the counters into the current block, the
+// encoding and the writes happen in a background thread.
+class Time_Series_Writer {
+public:
+  Time_Series_Writer() = default;
+  Time_Series_Writer(const Time_Series_Writer&) = delete;
+  Time_Series_Writer& operator=(const Time_Series_Writer&) = delete;
+  ~Time_Series_Writer();
+
+  // the counters must outlive the writer and be added before open. The samples
+  // of a counter are multiplied by scale, e.g. to record it in the units of
+  // the final stats
+  void add_counter(std::string name, const std::size_t* counter, std::size_t scale = 1);
+  void add_gauge(std::string name, const std::size_t* gauge);
+  // prepended to the names of the columns added next, to tell apart the
+  // columns of several instances of a component
+  void set_column_prefix(std::string prefix) { column_prefix = std::move(prefix); }
+  void open(const std::string& filename, std::size_t interval);
+  // records a sample if the cycle reached the next multiple of the interval
+  void sample(std::size_t cycle) {
+    if (cycle >= next_sample) { record(cycle); }
+  }
+  // records a last sample and waits until the file is written
+  void close(std::size_t cycle);
+  bool is_open() const { return writer.joinable(); }
+
+  static constexpr std::size_t rows_per_block = 4096;
+private:
+  void add_column(std::string name, const std::size_t* value, bool cumulative,
+                  std::size_t scale);
+  void record(std::size_t cycle);
+  void push_block();
+  void write_loop();
+  void write_block(const std::vector<uint64_t>& block);
+
+  std::vector<std::string> names;
+  std::string column_prefix;
+  std::vector<uint8_t> cumulative;
+  std::vector<const std::size_t*> values;
+  std::vector<std::size_t> scales;
+  std::size_t interval {};
+  std::size_t next_sample {SIZE_MAX};
+  std::size_t last_sample {SIZE_MAX};
+  // samples of the current block, one row after another
+  std::vector<uint64_t> block;
+
+  std::ofstream file;
+  std::thread writer;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<std::vector<uint64_t>> full_blocks;
+  std::vector<std::vector<uint64_t>> free_blocks;
+  bool closing {};
+  // only used by the writer thread
+  std::vector<uint8_t> encoded;
+  std::vector<uint32_t> column_sizes;
+};
+
+struct Time_Series {
+  std::size_t interval {};
+  // the first column is the cycle of each sample
+  std::vector<std::string> names;
+  std::vector<bool> cumulative;
+  std::vector<std::vector<uint64_t>> columns;
+};
+
+// opens writer if the config sets a positive time_series.interval. The file is
+// time_series.file or, by default, out_path with the .ts extension
+void open_time_series(Time_Series_Writer& writer, const toml::value& parsed_config,
+                      const std::string& out_path);
+
+Time_Series read_time_series(const std::string& filename);
+
+// one row per sample with the increment of each counter in the interval and
+// the value of each gauge at the end of it
+void print_time_series_csv(const Time_Series& time_series, std::ostream& os);
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_TIME_SERIES_HPP
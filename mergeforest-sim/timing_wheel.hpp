@@ -0,0 +1,94 @@
+#ifndef MERGEFOREST_SIM_TIMING_WHEEL_HPP
+#define MERGEFOREST_SIM_TIMING_WHEEL_HPP
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace mergeforest_sim {
+
+// Calendar queue of values keyed by the cycle in which they are ready. The
+// wheel has one slot per cycle, a power of two number of slots that doubles
+// when a value is pushed further in the future than the wheel covers, so a
+// wheel created with the maximum latency it holds never grows as long as it
+// is popped or advanced to the cycle of the pushes. Pushing and
+// popping a value are O(1), and the values ready in the same cycle are popped
+// in the order they were pushed.
+template<typename T>
+class Timing_Wheel {
+public:
+  explicit Timing_Wheel(std::size_t horizon = 64)
+    : slots(std::bit_ceil(std::max<std::size_t>(horizon, 2)))
+  {}
+
+  bool empty() const { return num_values == 0; }
+  std::size_t size() const { return num_values; }
+
+  void clear() {
+    for (auto& slot : slots) { slot.clear(); }
+    current = 0;
+    num_values = 0;
+  }
+
+  // values ready before the current cycle are popped in the next pop_ready
+  void push(std::size_t ready_cycle, T value) {
+    ready_cycle = std::max(ready_cycle, current);
+    if (ready_cycle - current >= slots.size()) { grow(ready_cycle - current + 1); }
+    slots[ready_cycle & mask()].push_back(std::move(value));
+    ++num_values;
+  }
+
+  // calls func with each value ready at or before cycle, in ready order
+  template<typename Func>
+  void pop_ready(std::size_t cycle, Func&& func) {
+    for (; current <= cycle && num_values > 0; ++current) {
+      auto& slot = slots[current & mask()];
+      for (auto& value : slot) { func(std::move(value)); }
+      num_values -= slot.size();
+      slot.clear();
+    }
+    current = std::max(current, cycle + 1);
+  }
+
+  // moves the first cycle of the wheel up to cycle without popping any value,
+  // e.g. after skipping cycles in which no value was ready
+  void advance(std::size_t cycle) {
+    if (num_values == 0) {
+      current = std::max(current, cycle);
+      return;
+    }
+    while (current < cycle && slots[current & mask()].empty()) { ++current; }
+  }
+
+  // cycle in which the next value is ready, SIZE_MAX if the wheel is empty
+  std::size_t next_ready() const {
+    if (num_values == 0) { return SIZE_MAX; }
+    // all the values are within a turn of the wheel from the current cycle
+    auto cycle = current;
+    while (slots[cycle & mask()].empty()) { ++cycle; }
+    return cycle;
+  }
+
+private:
+  std::size_t mask() const { return slots.size() - 1; }
+
+  void grow(std::size_t min_slots) {
+    std::vector<std::vector<T>> new_slots(std::bit_ceil(std::max(2 * slots.size(), min_slots)));
+    for (auto cycle = current; cycle != current + slots.size(); ++cycle) {
+      new_slots[cycle & (new_slots.size() - 1)] = std::move(slots[cycle & mask()]);
+    }
+    slots = std::move(new_slots);
+  }
+
+  std::vector<std::vector<T>> slots;
+  // first cycle that hasn't been popped yet
+  std::size_t current {};
+  std::size_t num_values {};
+};
+
+} // namespace mergeforest_sim
+
+#endif // MERGEFOREST_SIM_TIMING_WHEEL_HPP